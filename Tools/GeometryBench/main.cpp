@@ -0,0 +1,292 @@
+//***************************************************************************************
+// GeometryBench
+// Licensed under the MIT License.
+//
+// Headless benchmark for the procedural mesh generators in Geometry.h: reports the
+// vertices per second each generator produces for the common vertex types, and how
+// large terrains scale with inlined height functions and multiple threads.
+//***************************************************************************************
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Geometry.h"
+#include "ThreadPool.h"
+
+namespace
+{
+	struct Options
+	{
+		size_t vertexCount = 1000000;		// Approximate vertices generated per run
+		std::vector<UINT> terrainSizes = { 256, 512, 1024, 2048, 4096 };
+		unsigned int threadCount = 0;
+		int repeat = 5;
+		std::string filter;					// Non-empty: only run generators whose name contains it
+		std::string csvPath;				// Non-empty: append one row per case
+	};
+
+	void PrintUsage()
+	{
+		printf(
+			"Usage: GeometryBench [options]\n"
+			"  --vertices <n>      approximate vertices generated per run (default: 1000000)\n"
+			"  --terrain <list>    terrain grid sizes in quads per side, e.g. 256,4096\n"
+			"                      (default: 256,512,1024,2048,4096; 0 skips the terrain cases)\n"
+			"  -j <n>              threads for the parallel CreateTerrain cases (default: hardware threads)\n"
+			"  --repeat <n>        runs per case, the fastest is reported (default: 5)\n"
+			"  --filter <name>     only run generators whose name contains <name>\n"
+			"  --csv <file>        append results as CSV rows for regression tracking\n");
+	}
+
+	bool ParseList(const char* arg, std::vector<UINT>& values)
+	{
+		values.clear();
+		while (*arg)
+		{
+			char* end = nullptr;
+			unsigned long value = strtoul(arg, &end, 10);
+			if (end == arg || (*end && *end != ','))
+				return false;
+			if (value)
+				values.push_back((UINT)value);
+			arg = *end ? end + 1 : end;
+		}
+		return true;
+	}
+
+	bool ParseOptions(int argc, char* argv[], Options& options)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const char* arg = argv[i];
+			bool hasValue = i + 1 < argc;
+			if (!strcmp(arg, "--vertices") && hasValue)
+				options.vertexCount = (size_t)strtoull(argv[++i], nullptr, 10);
+			else if (!strcmp(arg, "--terrain") && hasValue)
+			{
+				if (!ParseList(argv[++i], options.terrainSizes))
+					return false;
+			}
+			else if (!strcmp(arg, "-j") && hasValue)
+				options.threadCount = (unsigned int)strtoul(argv[++i], nullptr, 10);
+			else if (!strcmp(arg, "--repeat") && hasValue)
+				options.repeat = atoi(argv[++i]);
+			else if (!strcmp(arg, "--filter") && hasValue)
+				options.filter = argv[++i];
+			else if (!strcmp(arg, "--csv") && hasValue)
+				options.csvPath = argv[++i];
+			else
+				return false;
+		}
+		for (UINT size : options.terrainSizes)
+		{
+			// The vertex count must fit the 32-bit index type
+			if (size > 32768)
+				return false;
+		}
+		if (options.threadCount == 0)
+			options.threadCount = ThreadPool::HardwareThreadCount();
+		return options.vertexCount >= 64 && options.repeat > 0;
+	}
+
+	// Keeps the generated meshes observable so the optimizer cannot drop the work
+	volatile size_t g_Sink = 0;
+
+	template<class VertexType, class IndexType>
+	size_t Consume(const Geometry::MeshData<VertexType, IndexType>& meshData)
+	{
+		g_Sink = g_Sink + meshData.indexVec.size();
+		return meshData.vertexVec.size();
+	}
+
+	struct CaseResult
+	{
+		double bestMs = 0.0;
+		size_t vertexCount = 0;
+	};
+
+	// run returns the number of vertices it generated
+	CaseResult RunCase(int repeat, const std::function<size_t()>& run)
+	{
+		CaseResult result;
+		for (int i = 0; i < repeat; ++i)
+		{
+			auto start = std::chrono::steady_clock::now();
+			size_t vertexCount = run();
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			if (i == 0 || ms < result.bestMs)
+				result.bestMs = ms;
+			result.vertexCount = vertexCount;
+		}
+		return result;
+	}
+
+	void Report(const Options& options, const char* generator, const char* vertexType, const CaseResult& r)
+	{
+		double seconds = r.bestMs / 1000.0;
+		double verticesPerSecond = seconds > 0.0 ? r.vertexCount / 1e6 / seconds : 0.0;
+		printf("  %-18s %-26s %10zu %10.2f %12.1f\n", generator, vertexType, r.vertexCount, r.bestMs, verticesPerSecond);
+
+		if (options.csvPath.empty())
+			return;
+		FILE* fp = fopen(options.csvPath.c_str(), "r");
+		bool newFile = !fp;
+		if (fp)
+			fclose(fp);
+		fp = fopen(options.csvPath.c_str(), "a");
+		if (!fp)
+			return;
+		if (newFile)
+			fputs("generator,vertex_type,vertices,ms,mvertices_per_s\n", fp);
+		fprintf(fp, "%s,%s,%zu,%.3f,%.3f\n", generator, vertexType, r.vertexCount, r.bestMs, verticesPerSecond);
+		fclose(fp);
+	}
+
+	// Runs every generator for one vertex type, sized so each produces about options.vertexCount vertices
+	template<class VertexType>
+	void RunVertexType(const Options& options, const char* vertexType)
+	{
+		using namespace DirectX;
+
+		UINT gridSlices = (std::max)((UINT)std::sqrt((double)options.vertexCount) - 1, 1u);
+		UINT ringSlices = (std::max)((UINT)(options.vertexCount / 4), 3u);
+		size_t boxCount = (std::max)(options.vertexCount / 24, (size_t)1);
+
+		auto run = [&](const char* generator, const std::function<size_t()>& func)
+		{
+			if (!options.filter.empty() && !strstr(generator, options.filter.c_str()))
+				return;
+			Report(options, generator, vertexType, RunCase(options.repeat, func));
+		};
+
+		run("CreateSphere", [&]()
+		{
+			return Consume(Geometry::CreateSphere<VertexType>(1.0f, gridSlices, gridSlices));
+		});
+		run("CreateBox", [&]()
+		{
+			size_t vertexCount = 0;
+			for (size_t i = 0; i < boxCount; ++i)
+				vertexCount += Consume(Geometry::CreateBox<VertexType>());
+			return vertexCount;
+		});
+		run("CreateCylinder", [&]()
+		{
+			return Consume(Geometry::CreateCylinder<VertexType>(1.0f, 2.0f, ringSlices));
+		});
+		run("CreateCone", [&]()
+		{
+			return Consume(Geometry::CreateCone<VertexType>(1.0f, 2.0f, ringSlices));
+		});
+		run("CreateTerrain", [&]()
+		{
+			return Consume(Geometry::CreateTerrain<VertexType>(100.0f, 100.0f, gridSlices, gridSlices, 1.0f, 1.0f,
+				[](float x, float z) { return 0.1f * (z * std::sin(0.1f * x) + x * std::cos(0.1f * z)); },
+				[](float x, float z) { return XMFLOAT3(-0.1f * (0.1f * z * std::cos(0.1f * x) + std::cos(0.1f * z)), 1.0f,
+					-0.1f * (std::sin(0.1f * x) - 0.1f * x * std::sin(0.1f * z))); }));
+		});
+	}
+
+	float TerrainHeight(float x, float z)
+	{
+		return 0.1f * (z * std::sin(0.1f * x) + x * std::cos(0.1f * z));
+	}
+
+	DirectX::XMFLOAT3 TerrainNormal(float x, float z)
+	{
+		return DirectX::XMFLOAT3(-0.1f * (0.1f * z * std::cos(0.1f * x) + std::cos(0.1f * z)), 1.0f,
+			-0.1f * (std::sin(0.1f * x) - 0.1f * x * std::sin(0.1f * z)));
+	}
+
+	DirectX::XMFLOAT4 TerrainColor(float, float)
+	{
+		return DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+	}
+
+	// Square terrains of increasing size: std::function overload vs. inlined functors, serial and parallel,
+	// and normals derived from a sampled heightmap instead of the analytic normal function
+	void RunTerrainSizes(const Options& options)
+	{
+		std::unique_ptr<ThreadPool> pool;
+		if (options.threadCount > 1)
+			pool = std::make_unique<ThreadPool>(options.threadCount - 1);
+
+		auto height = [](float x, float z) { return TerrainHeight(x, z); };
+		auto normal = [](float x, float z) { return TerrainNormal(x, z); };
+		auto color = [](float x, float z) { return TerrainColor(x, z); };
+
+		char threadsLabel[32];
+		snprintf(threadsLabel, sizeof(threadsLabel), "inline, %u threads", options.threadCount);
+		for (UINT size : options.terrainSizes)
+		{
+			char generator[32];
+			snprintf(generator, sizeof(generator), "Terrain %ux%u", size, size);
+			float extent = (float)size;
+
+			Report(options, generator, "std::function", RunCase(options.repeat, [&]()
+			{
+				return Consume(Geometry::CreateTerrain<VertexPosNormalTex>(extent, extent, size, size, 1.0f, 1.0f,
+					TerrainHeight, TerrainNormal, TerrainColor));
+			}));
+			Report(options, generator, "inline, 1 thread", RunCase(options.repeat, [&]()
+			{
+				return Consume(Geometry::CreateTerrain<VertexPosNormalTex>(extent, extent, size, size, 1.0f, 1.0f,
+					height, normal, color, nullptr));
+			}));
+			if (pool)
+			{
+				Report(options, generator, threadsLabel, RunCase(options.repeat, [&]()
+				{
+					return Consume(Geometry::CreateTerrain<VertexPosNormalTex>(extent, extent, size, size, 1.0f, 1.0f,
+						height, normal, color, pool.get()));
+				}));
+			}
+
+			// Sampling included: this replaces the analytic normal function entirely
+			Report(options, generator, "heightmap normals", RunCase(options.repeat, [&]()
+			{
+				std::vector<float> heights = Geometry::SampleHeightmap(extent, extent, size, size, height, pool.get());
+				return Consume(Geometry::CreateTerrainFromHeightmap<VertexPosNormalTex>(extent, extent, size, size,
+					heights.data(), 1.0f, 1.0f, DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), pool.get()));
+			}));
+			// Only the finite-difference mesh build, for an already sampled heightmap
+			std::vector<float> heights = Geometry::SampleHeightmap(extent, extent, size, size, height, pool.get());
+			Report(options, generator, "from heightmap", RunCase(options.repeat, [&]()
+			{
+				return Consume(Geometry::CreateTerrainFromHeightmap<VertexPosNormalTex>(extent, extent, size, size,
+					heights.data(), 1.0f, 1.0f, DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), pool.get()));
+			}));
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 2;
+	}
+
+	printf("GeometryBench: about %zu vertices per run, %u threads, best of %d runs\n",
+		options.vertexCount, options.threadCount, options.repeat);
+	printf("  %-18s %-26s %10s %10s %12s\n", "generator", "vertex type", "vertices", "ms", "Mvertices/s");
+	RunVertexType<VertexPos>(options, "VertexPos");
+	RunVertexType<VertexPosColor>(options, "VertexPosColor");
+	RunVertexType<VertexPosNormalTex>(options, "VertexPosNormalTex");
+	RunVertexType<VertexPosNormalTangentTex>(options, "VertexPosNormalTangentTex");
+	if (!options.terrainSizes.empty() && (options.filter.empty() || strstr("CreateTerrain", options.filter.c_str())))
+	{
+		printf("\n  CreateTerrain<VertexPosNormalTex>, std::function vs. inlined functors vs. heightmap normals\n");
+		RunTerrainSizes(options);
+	}
+	return 0;
+}
@@ -0,0 +1,566 @@
+//***************************************************************************************
+// ImportBench
+// Licensed under the MIT License.
+//
+// Headless benchmark for the import pipeline: generates synthetic .obj/.mtl files and
+// reports time, throughput, heap allocations and peak RSS of each loader stage.
+//***************************************************************************************
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+#include "ObjReader.h"
+#include "ThreadPool.h"
+
+#ifdef __linux__
+#include <sys/resource.h>
+#endif
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+namespace fs = std::filesystem;
+
+//
+// Heap allocation counters, updated by the replaced global operator new
+//
+
+namespace
+{
+	std::atomic<size_t> g_AllocCount(0);
+	std::atomic<size_t> g_AllocBytes(0);
+
+	void* CountedAlloc(size_t size)
+	{
+		g_AllocCount.fetch_add(1, std::memory_order_relaxed);
+		g_AllocBytes.fetch_add(size, std::memory_order_relaxed);
+		void* p = malloc(size ? size : 1);
+		if (!p)
+			throw std::bad_alloc();
+		return p;
+	}
+}
+
+void* operator new(size_t size) { return CountedAlloc(size); }
+void* operator new[](size_t size) { return CountedAlloc(size); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+namespace
+{
+	struct Options
+	{
+		fs::path workDir;					// Empty: a directory under the system temp path
+		std::vector<size_t> faceCounts = { 10000, 100000, 1000000, 10000000 };
+		std::vector<size_t> partCounts = { 1, 64 };
+		std::vector<double> dedupRatios = { 0.8 };
+		size_t materialCount = 1000;
+		unsigned int threadCount = 0;
+		int repeat = 3;
+		bool keepFiles = false;
+		fs::path csvPath;					// Non-empty: append one row per stage
+	};
+
+	// A regular grid reuses about 5 of every 6 face corners, the highest ratio the generator can produce
+	const double kMaxDedupRatio = 5.0 / 6.0;
+
+	void PrintUsage()
+	{
+		printf(
+			"Usage: ImportBench [options]\n"
+			"  --faces <list>      face counts per asset, e.g. 10000,1000000,10000000\n"
+			"                      (default: 10000,100000,1000000,10000000)\n"
+			"  --quick             leave 10000000 out of the default face counts; the ~1 GB\n"
+			"                      .obj takes minutes to generate and parse\n"
+			"  --parts <list>      o/usemtl groups per asset (default: 1,64)\n"
+			"  --dedup <list>      fraction of face corners that reuse an earlier vertex,\n"
+			"                      0 to %.2f (default: 0.8)\n"
+			"  --materials <n>     materials in the generated .mtl (default: 1000)\n"
+			"  -j <n>              threads for the parallel ReadObj stage (default: hardware threads)\n"
+			"  --repeat <n>        runs per stage, the fastest is reported (default: 3)\n"
+			"  --dir <dir>         where to generate the assets (default: system temp directory)\n"
+			"  --keep              keep the generated files\n"
+			"  --csv <file>        append results as CSV rows for regression tracking\n",
+			kMaxDedupRatio);
+	}
+
+	template<class T, class Parse>
+	bool ParseList(const char* arg, std::vector<T>& values, Parse parse)
+	{
+		values.clear();
+		while (*arg)
+		{
+			char* end = nullptr;
+			T value = parse(arg, &end);
+			if (end == arg || (*end && *end != ','))
+				return false;
+			values.push_back(value);
+			arg = *end ? end + 1 : end;
+		}
+		return !values.empty();
+	}
+
+	bool ParseOptions(int argc, char* argv[], Options& options)
+	{
+		auto parseSize = [](const char* s, char** end) { return (size_t)strtoull(s, end, 10); };
+		auto parseDouble = [](const char* s, char** end) { return strtod(s, end); };
+		bool facesGiven = false, quick = false;
+		for (int i = 1; i < argc; ++i)
+		{
+			const char* arg = argv[i];
+			bool hasValue = i + 1 < argc;
+			if (!strcmp(arg, "--faces") && hasValue)
+			{
+				if (!ParseList(argv[++i], options.faceCounts, parseSize))
+					return false;
+				facesGiven = true;
+			}
+			else if (!strcmp(arg, "--parts") && hasValue)
+			{
+				if (!ParseList(argv[++i], options.partCounts, parseSize))
+					return false;
+			}
+			else if (!strcmp(arg, "--dedup") && hasValue)
+			{
+				if (!ParseList(argv[++i], options.dedupRatios, parseDouble))
+					return false;
+			}
+			else if (!strcmp(arg, "--materials") && hasValue)
+				options.materialCount = (size_t)strtoull(argv[++i], nullptr, 10);
+			else if (!strcmp(arg, "-j") && hasValue)
+				options.threadCount = (unsigned int)strtoul(argv[++i], nullptr, 10);
+			else if (!strcmp(arg, "--repeat") && hasValue)
+				options.repeat = atoi(argv[++i]);
+			else if (!strcmp(arg, "--dir") && hasValue)
+				options.workDir = fs::u8path(argv[++i]);
+			else if (!strcmp(arg, "--quick"))
+				quick = true;
+			else if (!strcmp(arg, "--keep"))
+				options.keepFiles = true;
+			else if (!strcmp(arg, "--csv") && hasValue)
+				options.csvPath = fs::u8path(argv[++i]);
+			else
+				return false;
+		}
+
+		// An explicit --faces list is run as given
+		if (quick && !facesGiven)
+			options.faceCounts.pop_back();
+		for (size_t faces : options.faceCounts)
+		{
+			if (faces == 0)
+				return false;
+		}
+		for (size_t parts : options.partCounts)
+		{
+			if (parts == 0)
+				return false;
+		}
+		for (double ratio : options.dedupRatios)
+		{
+			if (ratio < 0.0 || ratio > kMaxDedupRatio)
+				return false;
+		}
+		if (options.materialCount == 0 || options.repeat <= 0)
+			return false;
+		if (options.threadCount == 0)
+			options.threadCount = ThreadPool::HardwareThreadCount();
+		if (options.workDir.empty())
+			options.workDir = fs::temp_directory_path() / "ImportBench";
+		return true;
+	}
+
+	//
+	// Synthetic assets
+	//
+
+	// Buffered text output, much faster than one fprintf per line for multi-GB files
+	class TextWriter
+	{
+	public:
+		explicit TextWriter(const fs::path& path) : m_File(fopen(path.u8string().c_str(), "wb")) { m_Buffer.reserve(kFlushSize + 256); }
+		~TextWriter() { Close(); }
+
+		bool IsOpen() const { return m_File != nullptr; }
+
+		template<class... Args>
+		void Print(const char* format, Args... args)
+		{
+			char line[256];
+			int length = snprintf(line, sizeof(line), format, args...);
+			m_Buffer.append(line, (size_t)length);
+			if (m_Buffer.size() >= kFlushSize)
+				Flush();
+		}
+
+		bool Close()
+		{
+			if (!m_File)
+				return false;
+			Flush();
+			bool succeeded = fclose(m_File) == 0 && m_Succeeded;
+			m_File = nullptr;
+			return succeeded;
+		}
+
+	private:
+		static const size_t kFlushSize = 1 << 20;
+
+		void Flush()
+		{
+			m_Succeeded &= fwrite(m_Buffer.data(), 1, m_Buffer.size(), m_File) == m_Buffer.size();
+			m_Buffer.clear();
+		}
+
+		FILE* m_File;
+		std::string m_Buffer;
+		bool m_Succeeded = true;
+	};
+
+	bool WriteMtl(const fs::path& path, size_t materialCount)
+	{
+		TextWriter out(path);
+		if (!out.IsOpen())
+			return false;
+		std::mt19937 rng(1);
+		std::uniform_real_distribution<float> color(0.0f, 1.0f);
+		out.Print("# ImportBench synthetic materials\n");
+		for (size_t i = 0; i < materialCount; ++i)
+		{
+			out.Print("newmtl mat%zu\n", i);
+			out.Print("Ns %.4f\n", 8.0f + 56.0f * color(rng));
+			out.Print("Ka %.4f %.4f %.4f\n", 0.2f * color(rng), 0.2f * color(rng), 0.2f * color(rng));
+			out.Print("Kd %.4f %.4f %.4f\n", color(rng), color(rng), color(rng));
+			out.Print("Ks %.4f %.4f %.4f\n", color(rng), color(rng), color(rng));
+			out.Print("d 1.0\n");
+			out.Print("map_Kd tex%zu.png\n\n", i % 16);
+		}
+		return out.Close();
+	}
+
+	// Each part is a displaced grid with its own positions, normals and texture coordinates.
+	// Corners of a regular grid reuse earlier v/vt/vn triples about 5 of 6 times; to lower the
+	// ratio, some corners get a fresh texture coordinate written just before their face
+	bool WriteObj(const fs::path& path, const std::string& mtlName, size_t faceCount, size_t partCount,
+		size_t materialCount, double dedupRatio)
+	{
+		TextWriter out(path);
+		if (!out.IsOpen())
+			return false;
+		std::mt19937 rng(2);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		// A fresh corner is one miss on its own, so each one lowers the ratio by 1/(3*faceCount)
+		double freshProbability = kMaxDedupRatio - dedupRatio;
+
+		out.Print("# ImportBench synthetic mesh: %zu faces, %zu parts\n", faceCount, partCount);
+		out.Print("mtllib %s\n", mtlName.c_str());
+		size_t vertexBase = 0, texCoordBase = 0;
+		for (size_t part = 0; part < partCount; ++part)
+		{
+			size_t partFaces = faceCount / partCount + (part < faceCount % partCount ? 1 : 0);
+			if (partFaces == 0)
+				continue;
+			// Grid of width x rows cells, two faces per cell, the last row may be partial
+			size_t width = (std::max)((size_t)std::sqrt(partFaces / 2.0), (size_t)1);
+			size_t cells = (partFaces + 1) / 2;
+			size_t rows = (cells + width - 1) / width;
+			size_t vertexCount = (width + 1) * (rows + 1);
+
+			out.Print("o part%zu\n", part);
+			out.Print("usemtl mat%zu\n", part % materialCount);
+			float offset = (float)part * 2.0f;
+			for (size_t y = 0; y <= rows; ++y)
+			{
+				for (size_t x = 0; x <= width; ++x)
+				{
+					float u = (float)x / width, v = (float)y / rows;
+					out.Print("v %.6f %.6f %.6f\n", offset + u, 0.05f * unit(rng), v);
+					out.Print("vt %.6f %.6f\n", u, v);
+					out.Print("vn %.6f %.6f %.6f\n", 0.0f, 1.0f, 0.0f);
+				}
+			}
+
+			size_t texCoordCount = vertexCount;
+			auto corner = [&](size_t x, size_t y, char* text, size_t size)
+			{
+				size_t index = vertexBase + y * (width + 1) + x + 1;
+				size_t texCoord = texCoordBase + y * (width + 1) + x + 1;
+				if (unit(rng) < freshProbability)
+				{
+					out.Print("vt %.6f %.6f\n", unit(rng), unit(rng));
+					texCoord = texCoordBase + ++texCoordCount;
+				}
+				snprintf(text, size, "%zu/%zu/%zu", index, texCoord, index);
+			};
+			char a[64], b[64], c[64];
+			for (size_t f = 0; f < partFaces; ++f)
+			{
+				size_t cell = f / 2;
+				size_t x = cell % width, y = cell / width;
+				if (f % 2 == 0)
+				{
+					corner(x, y, a, sizeof(a));
+					corner(x, y + 1, b, sizeof(b));
+					corner(x + 1, y, c, sizeof(c));
+				}
+				else
+				{
+					corner(x + 1, y, a, sizeof(a));
+					corner(x, y + 1, b, sizeof(b));
+					corner(x + 1, y + 1, c, sizeof(c));
+				}
+				out.Print("f %s %s %s\n", a, b, c);
+			}
+			vertexBase += vertexCount;
+			texCoordBase += texCoordCount;
+		}
+		return out.Close();
+	}
+
+	//
+	// Measurement
+	//
+
+	uintmax_t FileSize(const fs::path& path)
+	{
+		std::error_code ec;
+		uintmax_t size = fs::file_size(path, ec);
+		return ec ? 0 : size;
+	}
+
+	// Resets the peak resident set size so the next reading covers only the following stage.
+	// Returns false when the kernel does not support it; peaks are then process-wide
+	bool ResetPeakRss()
+	{
+#ifdef __GLIBC__
+		// Hand heap pages freed by earlier stages back to the kernel, otherwise they stay resident
+		// and inflate the baseline of whichever stage runs next
+		malloc_trim(0);
+#endif
+#ifdef __linux__
+		FILE* fp = fopen("/proc/self/clear_refs", "w");
+		if (!fp)
+			return false;
+		bool succeeded = fputs("5", fp) >= 0;
+		return fclose(fp) == 0 && succeeded;
+#else
+		return false;
+#endif
+	}
+
+	// Peak resident set size in bytes, 0 when unknown
+	size_t PeakRss()
+	{
+#ifdef __linux__
+		FILE* fp = fopen("/proc/self/status", "r");
+		if (fp)
+		{
+			char line[256];
+			size_t kb = 0;
+			while (fgets(line, sizeof(line), fp))
+			{
+				if (sscanf(line, "VmHWM: %zu kB", &kb) == 1)
+					break;
+			}
+			fclose(fp);
+			if (kb)
+				return kb * 1024;
+		}
+		rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage) == 0)
+			return (size_t)usage.ru_maxrss * 1024;
+#endif
+		return 0;
+	}
+
+	struct StageResult
+	{
+		bool succeeded = true;
+		double bestMs = 0.0;
+		size_t allocCount = 0;		// Of the first run
+		size_t allocBytes = 0;
+		size_t peakRss = 0;			// Highest over all runs
+	};
+
+	StageResult RunStage(int repeat, const std::function<bool()>& stage)
+	{
+		StageResult result;
+		for (int i = 0; i < repeat; ++i)
+		{
+			ResetPeakRss();
+			size_t allocCount = g_AllocCount.load(), allocBytes = g_AllocBytes.load();
+			auto start = std::chrono::steady_clock::now();
+			bool succeeded = stage();
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			result.succeeded &= succeeded;
+			if (i == 0)
+			{
+				result.bestMs = ms;
+				result.allocCount = g_AllocCount.load() - allocCount;
+				result.allocBytes = g_AllocBytes.load() - allocBytes;
+			}
+			result.bestMs = (std::min)(result.bestMs, ms);
+			result.peakRss = (std::max)(result.peakRss, PeakRss());
+		}
+		return result;
+	}
+
+	struct Case
+	{
+		size_t faceCount;
+		size_t partCount;
+		double dedupRatio;
+	};
+
+	void PrintHeader()
+	{
+		printf("  %-22s %10s %10s %10s %12s %10s %10s\n",
+			"stage", "ms", "MB/s", "Mfaces/s", "allocs", "alloc MB", "peak MB");
+	}
+
+	// faceCount is 0 for stages that do not process geometry
+	void Report(const Options& options, const Case& c, const char* stage, const StageResult& r, uintmax_t bytes, size_t faceCount)
+	{
+		double seconds = r.bestMs / 1000.0;
+		double mbPerSecond = seconds > 0.0 ? bytes / 1048576.0 / seconds : 0.0;
+		double facesPerSecond = seconds > 0.0 ? faceCount / 1e6 / seconds : 0.0;
+		char faces[32] = "-";
+		if (faceCount)
+			snprintf(faces, sizeof(faces), "%.2f", facesPerSecond);
+		printf("  %-22s %10.2f %10.1f %10s %12zu %10.1f %10.1f%s\n",
+			stage, r.bestMs, mbPerSecond, faces, r.allocCount, r.allocBytes / 1048576.0,
+			r.peakRss / 1048576.0, r.succeeded ? "" : "  FAILED");
+
+		if (options.csvPath.empty())
+			return;
+		bool newFile = !fs::exists(options.csvPath);
+		FILE* fp = fopen(options.csvPath.u8string().c_str(), "a");
+		if (!fp)
+			return;
+		if (newFile)
+			fputs("faces,parts,dedup,stage,ms,mb_per_s,mfaces_per_s,allocs,alloc_bytes,peak_rss_bytes,succeeded\n", fp);
+		fprintf(fp, "%zu,%zu,%.3f,%s,%.3f,%.2f,%.3f,%zu,%zu,%zu,%d\n",
+			c.faceCount, c.partCount, c.dedupRatio, stage, r.bestMs, mbPerSecond, facesPerSecond,
+			r.allocCount, r.allocBytes, r.peakRss, r.succeeded ? 1 : 0);
+		fclose(fp);
+	}
+
+	// Returns false when any stage failed
+	bool RunCase(const Options& options, const Case& c)
+	{
+		char name[96];
+		snprintf(name, sizeof(name), "bench_%zu_%zu_%03d", c.faceCount, c.partCount, (int)(c.dedupRatio * 100.0 + 0.5));
+		fs::path objPath = options.workDir / (std::string(name) + ".obj");
+		fs::path mtlPath = options.workDir / (std::string(name) + ".mtl");
+		fs::path mboPath = options.workDir / (std::string(name) + ".mbo");
+		fs::path compressedPath = options.workDir / (std::string(name) + "_c.mbo");
+
+		auto start = std::chrono::steady_clock::now();
+		if (!WriteMtl(mtlPath, options.materialCount) ||
+			!WriteObj(objPath, mtlPath.filename().u8string(), c.faceCount, c.partCount, options.materialCount, c.dedupRatio))
+		{
+			fprintf(stderr, "Cannot write %s\n", objPath.u8string().c_str());
+			return false;
+		}
+		double generateMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		std::wstring obj = objPath.wstring(), mtl = mtlPath.wstring();
+		std::wstring mbo = mboPath.wstring(), compressed = compressedPath.wstring();
+		uintmax_t objBytes = FileSize(objPath), mtlBytes = FileSize(mtlPath);
+
+		// The measured dedup ratio comes from the loader itself
+		ObjReader reader;
+		if (!reader.ReadObj(obj.c_str(), options.threadCount))
+		{
+			fprintf(stderr, "Cannot parse %s\n", objPath.u8string().c_str());
+			return false;
+		}
+		printf("\n%zu faces, %zu parts, dedup %.2f (measured %.3f): %.1f MB .obj, %.1f KB .mtl, generated in %.0f ms\n",
+			c.faceCount, c.partCount, c.dedupRatio, reader.GetVertexCacheHitRate(), objBytes / 1048576.0,
+			mtlBytes / 1024.0, generateMs);
+		PrintHeader();
+
+		bool succeeded = true;
+		auto stage = [&](const char* label, uintmax_t bytes, size_t faceCount, const std::function<bool()>& func)
+		{
+			StageResult r = RunStage(options.repeat, func);
+			Report(options, c, label, r, bytes, faceCount);
+			succeeded &= r.succeeded;
+		};
+
+		stage("ReadMtl", mtlBytes, 0, [&]() { MtlReader mtlReader; return mtlReader.ReadMtl(mtl.c_str()); });
+		stage("ReadObj (1 thread)", objBytes, c.faceCount, [&]() { ObjReader r; return r.ReadObj(obj.c_str(), 1); });
+		if (options.threadCount > 1)
+		{
+			char label[32];
+			snprintf(label, sizeof(label), "ReadObj (%u threads)", options.threadCount);
+			stage(label, objBytes, c.faceCount, [&]() { ObjReader r; return r.ReadObj(obj.c_str(), options.threadCount); });
+		}
+		stage("ReadObjStreaming", objBytes, c.faceCount, [&]()
+		{
+			ObjReader r;
+			return r.ReadObjStreaming(obj.c_str(), [](size_t, ObjReader::ObjPart&) { return true; });
+		});
+		stage("WriteMbo", reader.GetGeometryByteSize(), c.faceCount, [&]() { return reader.WriteMbo(mbo.c_str()); });
+		stage("WriteMbo (compressed)", reader.GetGeometryByteSize(), c.faceCount, [&]() { return reader.WriteMbo(compressed.c_str(), true); });
+		reader.ReleaseGeometry();
+		stage("ReadMbo", FileSize(mboPath), c.faceCount, [&]() { ObjReader r; return r.ReadMbo(mbo.c_str()); });
+		stage("ReadMbo (compressed)", FileSize(compressedPath), c.faceCount, [&]() { ObjReader r; return r.ReadMbo(compressed.c_str()); });
+		stage("MboView::Open", FileSize(mboPath), c.faceCount, [&]() { MboView view; return view.Open(mbo.c_str()); });
+
+		if (!options.keepFiles)
+		{
+			std::error_code ec;
+			for (const fs::path& path : { objPath, mtlPath, mboPath, compressedPath })
+				fs::remove(path, ec);
+		}
+		return succeeded;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 2;
+	}
+
+	std::error_code ec;
+	fs::create_directories(options.workDir, ec);
+	if (ec)
+	{
+		fprintf(stderr, "Cannot create %s: %s\n", options.workDir.u8string().c_str(), ec.message().c_str());
+		return 1;
+	}
+
+	bool peakPerStage = ResetPeakRss();
+	printf("ImportBench: %u threads, best of %d runs, %s\n", options.threadCount, options.repeat,
+		peakPerStage ? "peak RSS per stage" : "peak RSS per process");
+	printf("MB/s counts .obj/.mtl/.mbo file bytes, or CPU geometry bytes for WriteMbo\n");
+
+	size_t failedCount = 0;
+	for (size_t faces : options.faceCounts)
+	{
+		for (size_t parts : options.partCounts)
+		{
+			for (double ratio : options.dedupRatios)
+				failedCount += !RunCase(options, Case{ faces, parts, ratio });
+		}
+	}
+
+	return failedCount ? 1 : 0;
+}
@@ -0,0 +1,437 @@
+//***************************************************************************************
+// MboCooker
+// Licensed under the MIT License.
+//
+// Headless batch converter: cooks every .obj (+ .mtl) and .glb under a directory tree
+// into .mbo files in parallel. Needs no window or D3D device.
+//***************************************************************************************
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "MeshOptimizer.h"
+#include "ObjReader.h"
+#include "ThreadPool.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	struct Options
+	{
+		fs::path inputDir;
+		fs::path outputDir;			// Empty: write each .mbo next to its .obj
+		fs::path cacheDir;			// Non-empty: populate an MboCache instead
+		unsigned int threadCount = 0;
+		bool compressed = false;
+		bool optimized = true;
+		bool meshlets = true;
+		bool split = false;
+		bool merge = false;
+		std::vector<float> lodRatios;	// Empty: no LOD chain
+	};
+
+	struct AssetResult
+	{
+		bool succeeded = false;
+		double parseMs = 0.0;
+		double writeMs = 0.0;
+		uintmax_t objBytes = 0;
+		uintmax_t mboBytes = 0;
+		size_t vertexCount = 0;
+		size_t triangleCount = 0;
+		size_t lodCount = 0;		// Summed over parts
+		size_t meshletCount = 0;
+		size_t wideParts = 0;		// Parts written with 32-bit indices
+		MeshOptimizer::SplitStats split = {};
+		MeshOptimizer::MergeStats merge = {};
+		MeshOptimizer::LodStats lods = {};	// Summed over parts
+		// Vertex cache statistics weighted by triangle count, negative when not measured:
+		// the triangle order as parsed, after the vertex cache pass over whole parts, and the order written,
+		// which only differs from the whole-part result when meshlets confine the pass to each meshlet
+		float acmrSource = -1.0f, acmrOptimized = -1.0f, acmrAfter = -1.0f;
+		float atvrSource = -1.0f, atvrOptimized = -1.0f, atvrAfter = -1.0f;
+	};
+
+	void PrintUsage()
+	{
+		printf(
+			"Usage: MboCooker <input dir> [options]\n"
+			"  -o <dir>       write .mbo files to <dir>, mirroring the input tree\n"
+			"                 (default: next to each .obj)\n"
+			"  --cache <dir>  populate a content-addressed MboCache in <dir> instead\n"
+			"  -j <n>         number of assets cooked in parallel (default: hardware threads)\n"
+			"  --compress     quantize vertices and compress indices (not with --cache)\n"
+			"  --no-optimize  keep the source triangle and vertex order (not with --cache)\n"
+			"  --no-meshlets  do not split parts into culling clusters (not with --cache)\n"
+			"  --split        split parts over 65535 vertices into 16-bit index submeshes\n"
+			"                 (not with --cache)\n"
+			"  --merge        merge parts that share a material into one draw with a shared,\n"
+			"                 deduplicated vertex pool (not with --cache)\n"
+			"  --lods <list>  generate a LOD chain per part, e.g. 0.5,0.25,0.1 triangle ratios\n"
+			"                 (not with --cache, which always uses MboCache::lodRatios)\n");
+	}
+
+	// Parses a comma separated list of decreasing ratios in (0, 1)
+	bool ParseLodRatios(const char* arg, std::vector<float>& ratios)
+	{
+		ratios.clear();
+		while (*arg)
+		{
+			char* end = nullptr;
+			float ratio = strtof(arg, &end);
+			if (end == arg || ratio <= 0.0f || ratio >= 1.0f || (!ratios.empty() && ratio >= ratios.back()))
+				return false;
+			ratios.push_back(ratio);
+			arg = *end == ',' ? end + 1 : end;
+			if (*end && *end != ',')
+				return false;
+		}
+		return !ratios.empty();
+	}
+
+	bool ParseOptions(int argc, char* argv[], Options& options)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const char* arg = argv[i];
+			bool hasValue = i + 1 < argc;
+			if (!strcmp(arg, "-o") && hasValue)
+				options.outputDir = fs::u8path(argv[++i]);
+			else if (!strcmp(arg, "--cache") && hasValue)
+				options.cacheDir = fs::u8path(argv[++i]);
+			else if (!strcmp(arg, "-j") && hasValue)
+				options.threadCount = (unsigned int)strtoul(argv[++i], nullptr, 10);
+			else if (!strcmp(arg, "--compress"))
+				options.compressed = true;
+			else if (!strcmp(arg, "--no-optimize"))
+				options.optimized = false;
+			else if (!strcmp(arg, "--no-meshlets"))
+				options.meshlets = false;
+			else if (!strcmp(arg, "--split"))
+				options.split = true;
+			else if (!strcmp(arg, "--merge"))
+				options.merge = true;
+			else if (!strcmp(arg, "--lods") && hasValue)
+			{
+				if (!ParseLodRatios(argv[++i], options.lodRatios))
+					return false;
+			}
+			else if (arg[0] != '-' && options.inputDir.empty())
+				options.inputDir = fs::u8path(arg);
+			else
+				return false;
+		}
+		// Cache entries always use the default encoding, optimization, LOD chain, meshlets and no splitting or merging
+		if (options.inputDir.empty() || (!options.cacheDir.empty() &&
+			(options.compressed || !options.optimized || !options.meshlets || options.split || options.merge ||
+			!options.lodRatios.empty())))
+			return false;
+		if (options.threadCount == 0)
+			options.threadCount = ThreadPool::HardwareThreadCount();
+		return true;
+	}
+
+	double ElapsedMs(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	uintmax_t FileSize(const fs::path& path)
+	{
+		std::error_code ec;
+		uintmax_t size = fs::file_size(path, ec);
+		return ec ? 0 : size;
+	}
+
+	// Accumulate per-part statistics weighted by triangle count
+	void AddCacheStats(float& acmr, float& atvr, const MeshOptimizer::VertexCacheStats& stats,
+		size_t triangleCount, size_t totalTriangles)
+	{
+		if (acmr < 0.0f)
+			acmr = atvr = 0.0f;
+		float weight = totalTriangles ? (float)triangleCount / totalTriangles : 0.0f;
+		acmr += stats.acmr * weight;
+		atvr += stats.atvr * weight;
+	}
+
+	size_t TriangleCount(const ObjReader::ObjPart& part)
+	{
+		return (part.indices16.size() + part.indices32.size()) / 3;
+	}
+
+	MeshOptimizer::VertexCacheStats AnalyzePart(const ObjReader::ObjPart& part)
+	{
+		return !part.indices32.empty() ?
+			MeshOptimizer::AnalyzeVertexCache(part.indices32.data(), part.indices32.size(), part.vertices.size()) :
+			MeshOptimizer::AnalyzeVertexCache(part.indices16.data(), part.indices16.size(), part.vertices.size());
+	}
+
+	// ACMR/ATVR the vertex cache pass reaches on the part's triangles without meshlet boundaries
+	MeshOptimizer::VertexCacheStats AnalyzeUnconstrained(const ObjReader::ObjPart& part)
+	{
+		if (!part.indices32.empty())
+		{
+			std::vector<DWORD> indices(part.indices32);
+			MeshOptimizer::OptimizeVertexCache(indices.data(), indices.size(), part.vertices.size());
+			return MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), part.vertices.size());
+		}
+		std::vector<WORD> indices(part.indices16);
+		MeshOptimizer::OptimizeVertexCache(indices.data(), indices.size(), part.vertices.size());
+		return MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), part.vertices.size());
+	}
+
+	AssetResult CookAsset(const Options& options, const fs::path& objPath)
+	{
+		AssetResult result;
+		result.objBytes = FileSize(objPath);
+
+		ObjReader reader;
+		fs::path mboPath;
+		auto start = std::chrono::steady_clock::now();
+		if (!options.cacheDir.empty())
+		{
+			// Parses and stores the entry only when the cache has no up-to-date copy
+			MboCache cache(options.cacheDir.wstring().c_str());
+			if (!cache.Read(objPath.wstring().c_str(), reader))
+				return result;
+			result.parseMs = ElapsedMs(start);
+			mboPath = cache.GetCachePath(reader.sourceHash);
+		}
+		else
+		{
+			bool parsed = objPath.extension() == ".glb" ?
+				reader.ReadGlb(objPath.wstring().c_str()) : reader.ReadObj(objPath.wstring().c_str());
+			if (!parsed)
+				return result;
+			result.parseMs = ElapsedMs(start);
+
+			// Measured on the parsed parts, before any pass reorders their triangles
+			if (options.optimized)
+			{
+				size_t totalTriangles = 0;
+				for (auto& part : reader.objParts)
+					totalTriangles += TriangleCount(part);
+				for (auto& part : reader.objParts)
+					AddCacheStats(result.acmrSource, result.atvrSource, AnalyzePart(part), TriangleCount(part), totalTriangles);
+			}
+
+			// Merging comes first so parts that grow past 65535 vertices can still be split
+			if (options.merge)
+				MeshOptimizer::MergePartsByMaterial(reader.objParts, &result.merge);
+			// Splitting comes before every other pass so LODs and meshlets are built per submesh,
+			// leaving room for the vertices GenerateLods appends so the submeshes keep 16-bit indices
+			if (options.split)
+			{
+				MeshOptimizer::SplitLargeParts(reader.objParts, &result.split,
+					MeshOptimizer::LodVertexBudget(options.lodRatios.data(), options.lodRatios.size()));
+			}
+
+			// LODs come first so the optimization passes reorder them together with the base mesh
+			for (auto& part : reader.objParts)
+			{
+				MeshOptimizer::LodStats lods;
+				MeshOptimizer::GenerateLods(part, options.lodRatios.data(), options.lodRatios.size(), &lods);
+				result.lods.levelCount += lods.levelCount;
+				result.lods.appendedVertexCount += lods.appendedVertexCount;
+				result.lods.reusedVertexCount += lods.reusedVertexCount;
+			}
+			size_t totalTriangles = 0;
+			for (auto& part : reader.objParts)
+				totalTriangles += TriangleCount(part);
+			// Meshlets reorder the base triangles; the vertex cache pass then stays within each meshlet,
+			// so what the pass reaches on whole parts is measured on a copy beforehand
+			if (options.meshlets)
+			{
+				for (auto& part : reader.objParts)
+				{
+					if (options.optimized)
+						AddCacheStats(result.acmrOptimized, result.atvrOptimized, AnalyzeUnconstrained(part), TriangleCount(part), totalTriangles);
+					MeshOptimizer::BuildMeshlets(part);
+				}
+			}
+
+			if (options.optimized)
+			{
+				for (auto& part : reader.objParts)
+				{
+					MeshOptimizer::VertexCacheStats after;
+					MeshOptimizer::OptimizePart(part, nullptr, &after);
+					AddCacheStats(result.acmrAfter, result.atvrAfter, after, TriangleCount(part), totalTriangles);
+				}
+				if (!options.meshlets)
+				{
+					result.acmrOptimized = result.acmrAfter;
+					result.atvrOptimized = result.atvrAfter;
+				}
+			}
+
+			mboPath = objPath;
+			if (!options.outputDir.empty())
+				mboPath = options.outputDir / fs::relative(objPath, options.inputDir);
+			mboPath.replace_extension(".mbo");
+
+			std::error_code ec;
+			fs::create_directories(mboPath.parent_path(), ec);
+			start = std::chrono::steady_clock::now();
+			if (!reader.WriteMbo(mboPath.wstring().c_str(), options.compressed))
+				return result;
+			result.writeMs = ElapsedMs(start);
+		}
+
+		for (auto& part : reader.objParts)
+		{
+			result.vertexCount += part.vertices.size();
+			result.triangleCount += TriangleCount(part);
+			result.lodCount += part.lods.size();
+			result.meshletCount += part.meshlets.size();
+			result.wideParts += !part.indices32.empty();
+		}
+		if (result.acmrAfter < 0.0f)
+		{
+			// Only the final order is known (e.g. optimized inside the cache)
+			for (auto& part : reader.objParts)
+				AddCacheStats(result.acmrAfter, result.atvrAfter, AnalyzePart(part), TriangleCount(part), result.triangleCount);
+		}
+		result.mboBytes = FileSize(mboPath);
+		result.succeeded = true;
+		return result;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 2;
+	}
+
+	// Collect assets up front so the work can be distributed evenly
+	std::vector<fs::path> assets;
+	std::error_code ec;
+	for (fs::recursive_directory_iterator it(options.inputDir, ec), end; !ec && it != end; it.increment(ec))
+	{
+		if (it->is_regular_file() && (it->path().extension() == ".obj" || it->path().extension() == ".glb"))
+			assets.push_back(it->path());
+	}
+	if (ec)
+	{
+		fprintf(stderr, "Cannot scan %s: %s\n", options.inputDir.u8string().c_str(), ec.message().c_str());
+		return 1;
+	}
+	std::sort(assets.begin(), assets.end());
+
+	printf("Cooking %zu assets with %u threads\n", assets.size(), options.threadCount);
+
+	std::vector<AssetResult> results(assets.size());
+	std::mutex printMutex;
+	auto cook = [&](size_t i)
+	{
+		results[i] = CookAsset(options, assets[i]);
+		const AssetResult& r = results[i];
+
+		std::lock_guard<std::mutex> lock(printMutex);
+		if (!r.succeeded)
+		{
+			printf("FAILED  %s\n", assets[i].u8string().c_str());
+			return;
+		}
+		// Source order -> whole-part vertex cache pass; a second line gives the order written with meshlets
+		char source[32] = "    -     -";
+		if (r.acmrSource >= 0.0f)
+			snprintf(source, sizeof(source), "%5.3f %5.3f", r.acmrSource, r.atvrSource);
+		bool constrained = r.acmrOptimized >= 0.0f && r.meshletCount > 0;
+		int indent = printf("%8.1f ms parse %7.1f ms write  %9.1f KB -> %9.1f KB  %8zu verts %8zu tris %3zu LODs %6zu meshlets  ",
+			r.parseMs, r.writeMs, r.objBytes / 1024.0, r.mboBytes / 1024.0,
+			r.vertexCount, r.triangleCount, r.lodCount, r.meshletCount);
+		printf("ACMR/ATVR %s -> %5.3f %5.3f  %s\n", source,
+			constrained ? r.acmrOptimized : r.acmrAfter, constrained ? r.atvrOptimized : r.atvrAfter, assets[i].u8string().c_str());
+		if (constrained)
+			printf("%*sACMR/ATVR within meshlets %5.3f %5.3f\n", indent, "", r.acmrAfter, r.atvrAfter);
+	};
+
+	auto start = std::chrono::steady_clock::now();
+	if (options.threadCount > 1 && assets.size() > 1)
+	{
+		// The calling thread takes part as well
+		ThreadPool pool(options.threadCount - 1);
+		pool.ParallelFor(assets.size(), cook);
+	}
+	else
+	{
+		for (size_t i = 0; i < assets.size(); ++i)
+			cook(i);
+	}
+	double totalMs = ElapsedMs(start);
+
+	size_t failedCount = 0;
+	uintmax_t objBytes = 0, mboBytes = 0;
+	MeshOptimizer::SplitStats split = {};
+	MeshOptimizer::MergeStats merge = {};
+	MeshOptimizer::LodStats lods = {};
+	size_t wideParts = 0;
+	for (auto& r : results)
+	{
+		failedCount += !r.succeeded;
+		objBytes += r.objBytes;
+		mboBytes += r.mboBytes;
+		split.splitPartCount += r.split.splitPartCount;
+		split.submeshCount += r.split.submeshCount;
+		split.narrowedPartCount += r.split.narrowedPartCount;
+		split.vertexCountBefore += r.split.vertexCountBefore;
+		split.vertexCountAfter += r.split.vertexCountAfter;
+		split.indexBytesBefore += r.split.indexBytesBefore;
+		split.indexBytesAfter += r.split.indexBytesAfter;
+		merge.partCountBefore += r.merge.partCountBefore;
+		merge.partCountAfter += r.merge.partCountAfter;
+		merge.vertexCountBefore += r.merge.vertexCountBefore;
+		merge.vertexCountAfter += r.merge.vertexCountAfter;
+		lods.levelCount += r.lods.levelCount;
+		lods.appendedVertexCount += r.lods.appendedVertexCount;
+		lods.reusedVertexCount += r.lods.reusedVertexCount;
+		wideParts += r.wideParts;
+	}
+	printf("%zu cooked, %zu failed in %.1f ms: %.1f MB .obj -> %.1f MB .mbo (%.1f MB/s)\n",
+		assets.size() - failedCount, failedCount, totalMs, objBytes / 1048576.0, mboBytes / 1048576.0,
+		totalMs > 0.0 ? objBytes / 1048576.0 / (totalMs / 1000.0) : 0.0);
+	if (options.merge)
+	{
+		// Every part is one draw call in D3DObject::Draw
+		printf("Merged by material: %zu -> %zu draws (%.1f%% fewer), %zu -> %zu vertices (%.1f%% fewer)\n",
+			merge.partCountBefore, merge.partCountAfter,
+			merge.partCountBefore ? 100.0 * (merge.partCountBefore - merge.partCountAfter) / merge.partCountBefore : 0.0,
+			merge.vertexCountBefore, merge.vertexCountAfter,
+			merge.vertexCountBefore ? 100.0 * (merge.vertexCountBefore - merge.vertexCountAfter) / merge.vertexCountBefore : 0.0);
+	}
+	if (options.split)
+	{
+		// Index bytes of the base meshes, before LODs are added
+		printf("Split %zu parts into %zu submeshes, narrowed %zu parts to 16-bit indices: "
+			"%.1f KB -> %.1f KB of indices (%.1f KB saved), %zu -> %zu vertices\n",
+			split.splitPartCount, split.submeshCount, split.narrowedPartCount,
+			split.indexBytesBefore / 1024.0, split.indexBytesAfter / 1024.0,
+			((double)split.indexBytesBefore - (double)split.indexBytesAfter) / 1024.0,
+			split.vertexCountBefore, split.vertexCountAfter);
+		if (wideParts)
+			printf("warning: %zu parts still use 32-bit indices after splitting\n", wideParts);
+	}
+	if (!options.lodRatios.empty())
+	{
+		printf("Generated %zu LOD levels, appended %zu vertices for averaged normals\n",
+			lods.levelCount, lods.appendedVertexCount);
+		// Those wedges keep the base vertex's normal instead of widening the part to 32-bit indices
+		if (lods.reusedVertexCount)
+			printf("warning: %zu LOD vertices reuse the base normal, their 16-bit parts had no room left\n",
+				lods.reusedVertexCount);
+	}
+
+	return failedCount ? 1 : 0;
+}
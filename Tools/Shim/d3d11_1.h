@@ -0,0 +1,61 @@
+//***************************************************************************************
+// d3d11_1.h (shim)
+// Licensed under the MIT License.
+//
+// 非Windows平台下供命令行工具使用的最小替代头文件
+// 只提供导入代码(ObjReader、Vertex.h等)所需的基本类型，不包含任何D3D功能
+// Minimal stand-in for <d3d11_1.h> so the loader code builds on non-Windows hosts.
+//***************************************************************************************
+
+#ifndef D3D11_1_SHIM_H
+#define D3D11_1_SHIM_H
+
+#ifdef _WIN32
+#error "Use the Windows SDK <d3d11_1.h> on Windows"
+#endif
+
+#include <cstdint>
+#include <cstring>
+
+typedef uint8_t BYTE;
+typedef uint16_t WORD;
+typedef uint32_t DWORD;
+typedef unsigned int UINT;
+typedef int BOOL;
+typedef const char* LPCSTR;
+
+#ifndef MAX_PATH
+#define MAX_PATH 260
+#endif
+
+#define ZeroMemory(dst, size) memset((dst), 0, (size))
+#define ARRAYSIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+enum DXGI_FORMAT
+{
+	DXGI_FORMAT_UNKNOWN = 0,
+	DXGI_FORMAT_R32G32B32A32_FLOAT = 2,
+	DXGI_FORMAT_R32G32B32_FLOAT = 6,
+	DXGI_FORMAT_R32G32_FLOAT = 16,
+	DXGI_FORMAT_R32_UINT = 42,
+	DXGI_FORMAT_R16_UINT = 57,
+};
+
+enum D3D11_INPUT_CLASSIFICATION
+{
+	D3D11_INPUT_PER_VERTEX_DATA = 0,
+	D3D11_INPUT_PER_INSTANCE_DATA = 1,
+};
+
+struct D3D11_INPUT_ELEMENT_DESC
+{
+	LPCSTR SemanticName;
+	UINT SemanticIndex;
+	DXGI_FORMAT Format;
+	UINT InputSlot;
+	UINT AlignedByteOffset;
+	D3D11_INPUT_CLASSIFICATION InputSlotClass;
+	UINT InstanceDataStepRate;
+};
+
+#endif
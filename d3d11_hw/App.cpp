@@ -3,22 +3,39 @@
 #include "DXTrace.h"
 #include "FirstPersonCamera.h"
 #include "ThirdPersonCamera.h"
+#include <psapi.h>
+
+#pragma comment(lib, "psapi.lib")
 
 using namespace DirectX;
 
+// Print peak and current working set of the process to the debugger output
+static void ReportMemoryUsage(const wchar_t* stage)
+{
+	PROCESS_MEMORY_COUNTERS counters = {};
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return;
+	std::wstring msg = std::wstring(stage) +
+		L": peak working set " + std::to_wstring(counters.PeakWorkingSetSize >> 10) +
+		L" KB, current working set " + std::to_wstring(counters.WorkingSetSize >> 10) + L" KB\n";
+	OutputDebugStringW(msg.c_str());
+}
+
 
 App::App(HINSTANCE hInstance)
 	: D3DApp(hInstance),
-	m_CameraMode(CameraMode::FirstPerson)
+	m_CameraMode(CameraMode::FirstPerson),
+	m_ModelCache(L"Cache"),
+	m_MeshRegistry(&m_IndexCache)
 {
 	m_pCar = std::make_unique<CarModel>();
 	m_pRoad = std::make_unique<D3DObject>();
-	m_pGrass_l = std::make_unique<D3DObject>();
-	m_pGrass_r = std::make_unique<D3DObject>();
+	m_pTerrain = std::make_unique<Terrain>();
 	m_pHouse = std::make_unique<D3DObject>();
 	m_pTree = std::make_unique<D3DObject>();
 
 	m_pDaylight = std::make_unique<SkyRender>();
+	m_BaseCaption = m_MainWndCaption;
 
 	m_normalMat.ambient = XMFLOAT4(0.5f, 0.5f, 0.5f, 1.0f);
 	m_normalMat.diffuse = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
@@ -130,6 +147,25 @@ void App::UpdateScene(float dt)
 	m_BasicEffect.SetViewMatrix(m_pCamera->GetViewMatrixXM());
 	m_BasicEffect.SetEyePos(m_pCamera->GetPositionXM());
 
+	// Pick levels of detail whose simplification error stays below about two pixels
+	const float lodPixelError = 2.0f;
+	float lodErrorPerDistance = lodPixelError * 2.0f * tanf(XM_PI / 6) / m_ClientHeight;
+	m_pHouse->SelectLod(m_pCamera->GetPositionXM(), lodErrorPerDistance);
+	m_pTree->SelectLod(m_pCamera->GetPositionXM(), lodErrorPerDistance);
+	m_pTerrain->Update(*m_pCamera, lodErrorPerDistance);
+
+	// Shown with the frame rate by CalculateFrameStats
+	const TerrainQuadTree::Stats& terrainStats = m_pTerrain->GetStats();
+	m_MainWndCaption = m_BaseCaption + L"    Terrain: " +
+		std::to_wstring(terrainStats.drawnTiles) + L"/" + std::to_wstring(terrainStats.selectedTiles) + L" tiles, " +
+		std::to_wstring(terrainStats.drawnTriangles) + L" triangles (" +
+		std::to_wstring(terrainStats.fullDetailTriangles) + L" at full detail)";
+
+	// Skip clusters of the large static meshes that are off screen or facing away
+	XMMATRIX viewProj = m_pCamera->GetViewProjXM();
+	m_pHouse->CullMeshlets(m_pCamera->GetPositionXM(), viewProj);
+	m_pTree->CullMeshlets(m_pCamera->GetPositionXM(), viewProj);
+
 	// Reset scroll wheel value
 	m_pMouse->ResetScrollWheelValue();
 
@@ -181,8 +217,7 @@ void App::DrawScene()
 
 	m_pCar->Draw(m_pd3dImmediateContext.Get(), m_BasicEffect);
 	m_pRoad->Draw(m_pd3dImmediateContext.Get(), m_BasicEffect);
-	m_pGrass_l->Draw(m_pd3dImmediateContext.Get(), m_BasicEffect);
-	m_pGrass_r->Draw(m_pd3dImmediateContext.Get(), m_BasicEffect);
+	m_pTerrain->Draw(m_pd3dImmediateContext.Get(), m_BasicEffect);
 	m_pHouse->Draw(m_pd3dImmediateContext.Get(), m_BasicEffect);
 	m_pTree->Draw(m_pd3dImmediateContext.Get(), m_BasicEffect);
 
@@ -193,6 +228,9 @@ void App::DrawScene()
 	m_pCar->SetMaterial(m_shadowMat);
 	m_pHouse->SetMaterials(m_houseShadowMat);
 	m_pTree->SetMaterials(m_treeShadowMat);
+	// Shadows are flattened onto the ground and drawn without back face culling, so they need every cluster
+	m_pHouse->SetMeshletCulling(false);
+	m_pTree->SetMeshletCulling(false);
 
 	m_pCar->Draw(m_pd3dImmediateContext.Get(), m_BasicEffect);
 	m_pHouse->Draw(m_pd3dImmediateContext.Get(), m_BasicEffect);
@@ -202,6 +240,8 @@ void App::DrawScene()
 	m_pCar->SetMaterial(m_normalMat);
 	m_pHouse->SetMaterials(m_houseMat);
 	m_pTree->SetMaterials(m_treeMat);
+	m_pHouse->SetMeshletCulling(true);
+	m_pTree->SetMeshletCulling(true);
 
 	// 3. Draw sky box
 	m_SkyEffect.SetRenderDefault(m_pd3dImmediateContext.Get());
@@ -227,36 +267,45 @@ bool App::InitGameObjects()
 	// Initialize objects
 	// Car
 	m_pCar->SetMaterial(m_normalMat);
-	m_pCar->CreateCar(m_pd3dDevice.Get());
+	m_pCar->CreateCar(m_pd3dDevice.Get(), m_MeshRegistry);
 
 	// Ground
 	ComPtr<ID3D11ShaderResourceView> texture;
 	HR(CreateDDSTextureFromFile(m_pd3dDevice.Get(), L"Texture\\Ground\\road.dds", nullptr, texture.ReleaseAndGetAddressOf()));
 	m_pRoad->SetModel(Model(m_pd3dDevice.Get(),
-		Geometry::CreatePlane(XMFLOAT2(1000.0f, 50.0f), XMFLOAT2(100.0f, 2.0f))));
+		Geometry::CreatePlane(XMFLOAT2(1000.0f, 50.0f), XMFLOAT2(100.0f, 2.0f)).vertexVec,
+		m_IndexCache.GetPlane(m_pd3dDevice.Get())));
 	m_pRoad->SetWorldMatrix(XMMatrixTranslation(0.0f, -2.0f, 0.0f));
 	m_pRoad->SetTexture(texture.Get());
 	m_pRoad->SetMaterial(m_normalMat);
 
-	// Grass left
-	HR(CreateDDSTextureFromFile(m_pd3dDevice.Get(), L"Texture\\Ground\\grass.dds", nullptr, texture.ReleaseAndGetAddressOf()));
-	m_pGrass_l->SetModel(Model(m_pd3dDevice.Get(),
-		Geometry::CreatePlane(XMFLOAT2(1000.0f, 500.0f), XMFLOAT2(100.0f, 50.0f))));
-	m_pGrass_l->SetWorldMatrix(XMMatrixTranslation(0.0f, -2.0f, -275.0f));
-	m_pGrass_l->SetTexture(texture.Get());
-	m_pGrass_l->SetMaterial(m_normalMat);
-
-	// Grass right
+	// Grass terrain: flat just below the road and around the house and tree, rolling hills further out.
+	// 16x16 tiles of 32x32 quads, each level of the quadtree halves the resolution of the tiles far away
+	const float terrainSize = 1024.0f;
+	const UINT terrainTiles = 16, terrainTileQuads = 32;
+	auto terrainHeight = [](float x, float z) {
+		float t = (fabsf(z) - 100.0f) / 150.0f;
+		float blend = t <= 0.0f ? 0.0f : (t >= 1.0f ? 1.0f : t * t * (3.0f - 2.0f * t));
+		float hills = 12.0f * (sinf(0.013f * x) * cosf(0.011f * z) + 1.0f) + 1.5f * (sinf(0.05f * x + 0.03f * z) + 1.0f);
+		return -2.05f + blend * hills;
+	};
+	{
+		ThreadPool pool;
+		UINT terrainQuads = terrainTiles * terrainTileQuads;
+		std::vector<float> heights = Geometry::SampleHeightmap(terrainSize, terrainSize, terrainQuads, terrainQuads,
+			terrainHeight, &pool);
+		// Same texture density as the old 1000x500 grass planes
+		float texScale = terrainSize / 10.0f;
+		if (!m_pTerrain->Init(m_pd3dDevice.Get(), terrainSize, terrainSize, terrainTiles, terrainTileQuads,
+			heights.data(), texScale, texScale, &m_IndexCache, &pool))
+			return false;
+	}
 	HR(CreateDDSTextureFromFile(m_pd3dDevice.Get(), L"Texture\\Ground\\grass.dds", nullptr, texture.ReleaseAndGetAddressOf()));
-	m_pGrass_r->SetModel(Model(m_pd3dDevice.Get(),
-		Geometry::CreatePlane(XMFLOAT2(1000.0f, 500.0f), XMFLOAT2(100.0f, 50.0f))));
-	m_pGrass_r->SetWorldMatrix(XMMatrixTranslation(0.0f, -2.0f, 275.0f));
-	m_pGrass_r->SetTexture(texture.Get());
-	m_pGrass_r->SetMaterial(m_normalMat);
+	m_pTerrain->SetTexture(texture.Get());
+	m_pTerrain->SetMaterial(m_normalMat);
 
 	// House
-	m_ObjReader.Read(L"Model\\house.mbo", L"Model\\house.obj");
-	m_pHouse->SetModel(Model(m_pd3dDevice.Get(), m_ObjReader));
+	m_pHouse->SetModel(LoadModel(L"Model\\house.obj", L"Model\\house.mbo"));
 	m_pHouse->GetMaterials(m_houseMat);
 	m_houseShadowMat = std::vector<Material>{ m_houseMat.size(), m_shadowMat };
 
@@ -267,8 +316,7 @@ bool App::InitGameObjects()
 	m_pHouse->SetWorldMatrix(S * XMMatrixTranslation(-70.0f, -(houseBox.Center.y - houseBox.Extents.y + 1.0f) - 1.0f, 70.0f));
 
 	// Tree
-	m_ObjReader.Read(L"Model\\tree.mbo", L"Model\\tree.obj");
-	m_pTree->SetModel(Model(m_pd3dDevice.Get(), m_ObjReader));
+	m_pTree->SetModel(LoadModel(L"Model\\tree.obj", L"Model\\tree.mbo"));
 	m_pTree->GetMaterials(m_treeMat);
 	m_treeShadowMat = std::vector<Material>{ m_treeMat.size(), m_shadowMat };
 
@@ -278,9 +326,32 @@ bool App::InitGameObjects()
 
 	m_pTree->SetWorldMatrix(S * XMMatrixTranslation(-30.0f, -(treeBox.Center.y - treeBox.Extents.y + 1.0f) - 1.0f, -25.0f));
 
+	ReportMemoryUsage(L"Game objects loaded");
+
 	return true;
 }
 
+Model App::LoadModel(const wchar_t* objFileName, const wchar_t* mboFileName)
+{
+	// Create buffers straight from the mapped .mbo cache entry,
+	// the entry is rebuilt automatically when the .obj/.mtl files change,
+	// parsing the .obj on all hardware threads (threadCount 0)
+	MboView mboView;
+	if (m_ModelCache.Open(objFileName, mboView, 0))
+		return Model(m_pd3dDevice.Get(), mboView);
+
+	// No .obj source shipped: use the prebuilt .mbo file
+	if (mboView.Open(mboFileName))
+		return Model(m_pd3dDevice.Get(), mboView);
+
+	// Cache unavailable (e.g. read-only directory): stream the .obj file,
+	// each part is uploaded while the following parts are still being parsed
+	Model model;
+	if (!model.SetModelStreaming(m_pd3dDevice.Get(), objFileName))
+		OutputDebugStringW((std::wstring(objFileName) + L": failed to load\n").c_str());
+	return model;
+}
+
 void App::InitFirstPersonCamera()
 {
 	m_CameraMode = CameraMode::FirstPerson;
@@ -5,6 +5,7 @@
 #include "ObjReader.h"
 #include "D3DObject.h"
 #include "SkyRender.h"
+#include "Terrain.h"
 
 class Camera;
 
@@ -29,6 +30,7 @@ public:
 private:
 	bool InitResource();
 	bool InitGameObjects();
+	Model LoadModel(const wchar_t* objFileName, const wchar_t* mboFileName);
 	void InitFirstPersonCamera();
 	void InitEffects();
 	void InitLight();
@@ -37,8 +39,7 @@ private:
 	// Objects
 	std::unique_ptr<CarModel> m_pCar;             // Car model
 	std::unique_ptr<D3DObject> m_pRoad;           // Road
-	std::unique_ptr<D3DObject> m_pGrass_l;        // Grass left
-	std::unique_ptr<D3DObject> m_pGrass_r;        // Grass right
+	std::unique_ptr<Terrain> m_pTerrain;          // Grass terrain around the road
 	std::unique_ptr<D3DObject> m_pHouse;	      // House
 	std::unique_ptr<D3DObject> m_pTree;	          // Tree
 
@@ -54,12 +55,17 @@ private:
 	std::shared_ptr<Camera> m_pCamera;			  // Camera
 	CameraMode m_CameraMode;					  // Camera mode
 
-	// Model ObjReader
-	ObjReader m_ObjReader;						  // Model ObjReader
+	// Model cache
+	MboCache m_ModelCache;						  // Cooked .mbo files keyed by source content
+	IndexBufferCache m_IndexCache;				  // Index buffers shared by meshes of the same topology
+	MeshRegistry m_MeshRegistry;				  // Procedural meshes shared by objects with the same parameters
 
 	// Effect
 	BasicEffect m_BasicEffect;					  // Object rendering effects management
 	SkyEffect m_SkyEffect;		                  // Sky dffect
 	std::unique_ptr<SkyRender> m_pDaylight;		  // Sky box: day light
+
+	// Window caption without the per-frame terrain statistics
+	std::wstring m_BaseCaption;
 };
 
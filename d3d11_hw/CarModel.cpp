@@ -78,15 +78,15 @@ void CarModel::UpdateComponentsWorldMatrix()
 	}
 }
 
-void CarModel::CreateCar(ID3D11Device * device)
+void CarModel::CreateCar(ID3D11Device * device, MeshRegistry& meshRegistry)
 {
-	// Create each component of car
-	CreateCarBase(device);
-	CreateCarBody(device);
-	CreateFrontLeftWheel(device);
-	CreateFrontRightWheel(device);
-	CreateBackLeftWheel(device);
-	CreateBackRightWheel(device);
+	// Create each component of car; their models share the vertex and index buffers of the registry's meshes
+	CreateCarBase(device, meshRegistry);
+	CreateCarBody(device, meshRegistry);
+	CreateFrontLeftWheel(device, meshRegistry);
+	CreateFrontRightWheel(device, meshRegistry);
+	CreateBackLeftWheel(device, meshRegistry);
+	CreateBackRightWheel(device, meshRegistry);
 
 	// Update each component's world matrix
 	UpdateComponentsWorldMatrix();
@@ -184,10 +184,10 @@ void CarModel::SetStop()
 	m_car_state = MoveState::Stop;
 }
 
-void CarModel::CreateCarBase(ID3D11Device* device)
+void CarModel::CreateCarBase(ID3D11Device* device, MeshRegistry& meshRegistry)
 {
 	// Set model
-	m_car[0]->SetModel(Model(device, Geometry::CreateBox()));
+	m_car[0]->SetModel(meshRegistry.GetBox(device));
 
 	// Set local matrices
 	XMStoreFloat4x4(&m_car[0]->local_scale, XMMatrixScaling(4.0f, 0.5f, 2.0f));
@@ -199,10 +199,10 @@ void CarModel::CreateCarBase(ID3D11Device* device)
 	m_car[0]->SetTexture(texture.Get());
 }
 
-void CarModel::CreateCarBody(ID3D11Device * device)
+void CarModel::CreateCarBody(ID3D11Device * device, MeshRegistry& meshRegistry)
 {
 	// Set model
-	m_car[1]->SetModel(Model(device, Geometry::CreateBox()));
+	m_car[1]->SetModel(meshRegistry.GetBox(device));
 
 	// Set local matrices
 	XMStoreFloat4x4(&m_car[1]->local_scale, XMMatrixScaling(3.0f, 0.5f, 2.0f));
@@ -215,10 +215,10 @@ void CarModel::CreateCarBody(ID3D11Device * device)
 	m_car[1]->SetTexture(texture.Get());
 }
 
-void CarModel::CreateFrontLeftWheel(ID3D11Device * device)
+void CarModel::CreateFrontLeftWheel(ID3D11Device * device, MeshRegistry& meshRegistry)
 {
 	// Set model
-	m_car[2]->SetModel(Model(device, Geometry::CreateCylinder()));
+	m_car[2]->SetModel(meshRegistry.GetCylinder(device));
 
 	// Set local matrices
 	XMStoreFloat4x4(&m_car[2]->local_scale, XMMatrixScaling(0.8f, 0.25f, 0.8f));
@@ -232,10 +232,10 @@ void CarModel::CreateFrontLeftWheel(ID3D11Device * device)
 	m_car[2]->SetTexture(texture.Get());
 }
 
-void CarModel::CreateFrontRightWheel(ID3D11Device * device)
+void CarModel::CreateFrontRightWheel(ID3D11Device * device, MeshRegistry& meshRegistry)
 {
 	// Set model
-	m_car[3]->SetModel(Model(device, Geometry::CreateCylinder()));
+	m_car[3]->SetModel(meshRegistry.GetCylinder(device));
 
 	// Set local matrices
 	XMStoreFloat4x4(&m_car[3]->local_scale, XMMatrixScaling(0.8f, 0.25f, 0.8f));
@@ -249,10 +249,10 @@ void CarModel::CreateFrontRightWheel(ID3D11Device * device)
 	m_car[3]->SetTexture(texture.Get());
 }
 
-void CarModel::CreateBackLeftWheel(ID3D11Device * device)
+void CarModel::CreateBackLeftWheel(ID3D11Device * device, MeshRegistry& meshRegistry)
 {
 	// Set model
-	m_car[4]->SetModel(Model(device, Geometry::CreateCylinder()));
+	m_car[4]->SetModel(meshRegistry.GetCylinder(device));
 
 	// Set local matrices
 	XMStoreFloat4x4(&m_car[4]->local_scale, XMMatrixScaling(0.8f, 0.25f, 0.8f));
@@ -266,10 +266,10 @@ void CarModel::CreateBackLeftWheel(ID3D11Device * device)
 	m_car[4]->SetTexture(texture.Get());
 }
 
-void CarModel::CreateBackRightWheel(ID3D11Device * device)
+void CarModel::CreateBackRightWheel(ID3D11Device * device, MeshRegistry& meshRegistry)
 {
 	// Set model
-	m_car[5]->SetModel(Model(device, Geometry::CreateCylinder()));
+	m_car[5]->SetModel(meshRegistry.GetCylinder(device));
 
 	// Set local matrices
 	XMStoreFloat4x4(&m_car[5]->local_scale, XMMatrixScaling(0.8f, 0.25f, 0.8f));
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "D3DObject.h"
+#include "MeshRegistry.h"
 
 
 class CarModel
@@ -39,7 +40,8 @@ public:
 	DirectX::XMFLOAT3 GetPosition() const;          // Get postion
 	DirectX::XMFLOAT3 GetDirection() const;         // Get heading direction
 	void UpdateWorldMatrix();                       // Update world matrix
-	void CreateCar(ID3D11Device* device);           // Create Car Model
+	// Create Car Model; the box and wheel meshes come from meshRegistry and are shared by every car built with it
+	void CreateCar(ID3D11Device* device, MeshRegistry& meshRegistry);
 	void Move(float dt);                            // Move (forward or backward)
 	void Turn(float& totalDegree, float dt);        // Turn (left or right, only when moving)
 	void Draw(ID3D11DeviceContext * deviceContext, BasicEffect& effect);
@@ -49,12 +51,12 @@ public:
 	void SetStop();                                 // Set move state -- Stop
 
 private:
-	void CreateCarBase(ID3D11Device* device);
-	void CreateCarBody(ID3D11Device* device);
-	void CreateFrontLeftWheel(ID3D11Device* device);
-	void CreateFrontRightWheel(ID3D11Device* device);
-	void CreateBackLeftWheel(ID3D11Device* device);
-	void CreateBackRightWheel(ID3D11Device* device);
+	void CreateCarBase(ID3D11Device* device, MeshRegistry& meshRegistry);
+	void CreateCarBody(ID3D11Device* device, MeshRegistry& meshRegistry);
+	void CreateFrontLeftWheel(ID3D11Device* device, MeshRegistry& meshRegistry);
+	void CreateFrontRightWheel(ID3D11Device* device, MeshRegistry& meshRegistry);
+	void CreateBackLeftWheel(ID3D11Device* device, MeshRegistry& meshRegistry);
+	void CreateBackRightWheel(ID3D11Device* device, MeshRegistry& meshRegistry);
 	void UpdateComponentsWorldMatrix();             // Update component's world matrix
 
 private:
@@ -1,4 +1,5 @@
 #include "D3DObject.h"
+#include "d3dUtil.h"
 
 using namespace DirectX;
 
@@ -7,7 +8,8 @@ D3DObject::D3DObject()
 	: m_position(XMFLOAT3(0.0f, 0.0f, 0.0f)),
 	m_IndexCount(),
 	m_VertexStride(),
-	m_bIsSetMaterial(false)
+	m_bIsSetMaterial(false),
+	m_bMeshletCulling(false)
 {
 	XMStoreFloat4x4(&m_world, XMMatrixIdentity());
 }
@@ -67,6 +69,46 @@ void D3DObject::SetModel(const Model & model)
 	m_model = model;
 }
 
+void XM_CALLCONV D3DObject::SelectLod(DirectX::FXMVECTOR eyePos, float errorPerDistance)
+{
+	// Distance from the eye to the world space bounding box, 0 when inside
+	BoundingBox box = GetLocalBoundingBox();
+	XMVECTOR center = XMLoadFloat3(&box.Center);
+	XMVECTOR extents = XMLoadFloat3(&box.Extents);
+	XMVECTOR closest = XMVectorClamp(eyePos, center - extents, center + extents);
+	float distance = XMVectorGetX(XMVector3Length(eyePos - closest));
+
+	// LOD errors are stored in model space, so undo the largest scale of the world matrix
+	XMMATRIX world = XMLoadFloat4x4(&m_world);
+	float scale = XMVectorGetX(XMVectorMax(XMVector3Length(world.r[0]),
+		XMVectorMax(XMVector3Length(world.r[1]), XMVector3Length(world.r[2]))));
+	float maxError = scale > 0.0f ? distance * errorPerDistance / scale : 0.0f;
+
+	for (auto& part : m_model.modelParts) {
+		part.lodIndex = part.SelectLod(maxError);
+	}
+}
+
+void XM_CALLCONV D3DObject::CullMeshlets(DirectX::FXMVECTOR eyePos, DirectX::CXMMATRIX viewProj)
+{
+	// Clusters are stored in model space, so bring the eye and the frustum planes there.
+	// Planes extracted from world * view * proj are already in model space
+	XMMATRIX world = XMLoadFloat4x4(&m_world);
+	XMVECTOR localEye = XMVector3TransformCoord(eyePos, XMMatrixInverse(nullptr, world));
+	XMVECTOR planes[6];
+	ExtractFrustumPlanes(world * viewProj, planes);
+
+	for (auto& part : m_model.modelParts) {
+		part.CullMeshlets(localEye, planes);
+	}
+	m_bMeshletCulling = true;
+}
+
+void D3DObject::SetMeshletCulling(bool enabled)
+{
+	m_bMeshletCulling = enabled;
+}
+
 DirectX::BoundingBox D3DObject::GetLocalBoundingBox() const
 {
 	BoundingBox box;
@@ -94,6 +136,16 @@ void D3DObject::Draw(ID3D11DeviceContext * deviceContext, BasicEffect& effect)
 
 	for (auto& part : m_model.modelParts)
 	{
+		if (m_bMeshletCulling && !part.visible) {
+			continue;
+		}
+
+		// Clusters only cover the full detail mesh
+		bool culled = m_bMeshletCulling && part.lodIndex == 0 && !part.meshlets.empty();
+		if (culled && part.visibleRanges.empty()) {
+			continue;
+		}
+
 		// Set vertex buffer and index buffer
 		deviceContext->IASetVertexBuffers(0, 1, part.vertexBuffer.GetAddressOf(), &strides, &offsets);
 		deviceContext->IASetIndexBuffer(part.indexBuffer.Get(), part.indexFormat, 0);
@@ -115,7 +167,18 @@ void D3DObject::Draw(ID3D11DeviceContext * deviceContext, BasicEffect& effect)
 
 		effect.Apply(deviceContext);
 
-		deviceContext->DrawIndexed(part.indexCount, 0, 0);
+		if (culled) {
+			for (auto& range : part.visibleRanges) {
+				deviceContext->DrawIndexed(range.indexCount, range.startIndex, 0);
+			}
+		}
+		else if (part.lods.empty()) {
+			deviceContext->DrawIndexed(part.indexCount, 0, 0);
+		}
+		else {
+			const ModelPart::Lod& lod = part.lods[part.lodIndex];
+			deviceContext->DrawIndexed(lod.indexCount, lod.startIndex, 0);
+		}
 	}
 }
 
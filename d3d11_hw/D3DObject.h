@@ -21,6 +21,16 @@ public:
 	void SetModel(Model&& model);                              // Set Model
 	void SetModel(const Model& model);
 
+	// Select each part's level of detail from its distance to the eye.
+	// errorPerDistance is the world space error allowed at distance 1 (e.g. one pixel's footprint)
+	void XM_CALLCONV SelectLod(DirectX::FXMVECTOR eyePos, float errorPerDistance);
+
+	// Cull whole parts whose bounding volumes are outside the view frustum, then the clusters of each
+	// remaining part's full detail mesh that are outside the frustum or facing away from the eye.
+	// Draw only renders the remaining parts and clusters until meshlet culling is disabled
+	void XM_CALLCONV CullMeshlets(DirectX::FXMVECTOR eyePos, DirectX::CXMMATRIX viewProj);
+	void SetMeshletCulling(bool enabled);
+
 	// Get and set materials for model's parts
 	void GetMaterials(std::vector<Material>& vOut) const;      // Get materials of model parts
 	void SetMaterials(const std::vector<Material>& v);         // Set materials of model parts
@@ -45,5 +55,6 @@ private:
 	UINT m_IndexCount;						       // Indexed array size of object
 
 	bool m_bIsSetMaterial;                         // Check if to use m_material or model's own material
+	bool m_bMeshletCulling;                        // Check if to draw only the clusters kept by CullMeshlets
 };
 
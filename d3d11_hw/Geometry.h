@@ -10,10 +10,11 @@
 #define GEOMETRY_H_
 
 #include <vector>
-#include <string>
-#include <map>
 #include <functional>
+#include <type_traits>
+#include <utility>
 #include "Vertex.h"
+#include "ThreadPool.h"
 
 namespace Geometry
 {
@@ -81,14 +82,44 @@ namespace Geometry
 	MeshData<VertexType, IndexType> CreateTerrain(const DirectX::XMFLOAT2& terrainSize,
 		const DirectX::XMUINT2& slices = { 10, 10 }, const DirectX::XMFLOAT2 & maxTexCoord = { 1.0f, 1.0f },
 		const std::function<float(float, float)>& heightFunc = [](float x, float z) { return 0.0f; },
-		const std::function<DirectX::XMFLOAT3(float, float)>& normalFunc = [](float x, float z) { return XMFLOAT3(0.0f, 1.0f, 0.0f); },
-		const std::function<DirectX::XMFLOAT4(float, float)>& colorFunc = [](float x, float z) { return XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f); });
+		const std::function<DirectX::XMFLOAT3(float, float)>& normalFunc = [](float x, float z) { return DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f); },
+		const std::function<DirectX::XMFLOAT4(float, float)>& colorFunc = [](float x, float z) { return DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f); });
 	template<class VertexType = VertexPosNormalTex, class IndexType = DWORD>
 	MeshData<VertexType, IndexType> CreateTerrain(float width = 10.0f, float depth = 10.0f,
 		UINT slicesX = 10, UINT slicesZ = 10, float texU = 1.0f, float texV = 1.0f,
 		const std::function<float(float, float)>& heightFunc = [](float x, float z) { return 0.0f; },
-		const std::function<DirectX::XMFLOAT3(float, float)>& normalFunc = [](float x, float z) { return XMFLOAT3(0.0f, 1.0f, 0.0f); },
-		const std::function<DirectX::XMFLOAT4(float, float)>& colorFunc = [](float x, float z) { return XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f); });
+		const std::function<DirectX::XMFLOAT3(float, float)>& normalFunc = [](float x, float z) { return DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f); },
+		const std::function<DirectX::XMFLOAT4(float, float)>& colorFunc = [](float x, float z) { return DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f); });
+	// 高度、法向量和颜色可以是任意可调用对象(如lambda)，调用会被内联展开，不经过std::function
+	// pool不为nullptr时按行分配到线程池中并行生成，此时这三个函数会被多个线程同时调用，需保证线程安全
+	template<class VertexType = VertexPosNormalTex, class IndexType = DWORD, class HeightFunc, class NormalFunc, class ColorFunc>
+	MeshData<VertexType, IndexType> CreateTerrain(float width, float depth, UINT slicesX, UINT slicesZ, float texU, float texV,
+		HeightFunc&& heightFunc, NormalFunc&& normalFunc, ColorFunc&& colorFunc, ThreadPool* pool);
+
+	// 在地形的(slicesX + 1) * (slicesZ + 1)个网格顶点处采样高度，按行(z从小到大)存放，供CreateTerrainFromHeightmap使用
+	template<class HeightFunc>
+	std::vector<float> SampleHeightmap(float width, float depth, UINT slicesX, UINT slicesZ,
+		HeightFunc&& heightFunc, ThreadPool* pool = nullptr);
+
+	// 由高度图创建地形，法向量和切线由相邻高度的中心差分求得(边界处用单侧差分)，不需要提供法向量函数
+	// heights需按行(z从小到大)存放(slicesX + 1) * (slicesZ + 1)个高度值，顶点位置和纹理坐标的布局与CreateTerrain相同
+	template<class VertexType = VertexPosNormalTex, class IndexType = DWORD>
+	MeshData<VertexType, IndexType> CreateTerrainFromHeightmap(float width, float depth, UINT slicesX, UINT slicesZ,
+		const float* heights, float texU = 1.0f, float texV = 1.0f,
+		const DirectX::XMFLOAT4& color = { 1.0f, 1.0f, 1.0f, 1.0f }, ThreadPool* pool = nullptr);
+
+	//
+	// 只生成索引
+	// 与同名几何体方法生成的索引完全相同，只取决于细分参数，可通过IndexBufferCache在多个网格之间共享
+	//
+
+	template<class IndexType = DWORD>
+	std::vector<IndexType> CreateSphereIndices(UINT levels = 20, UINT slices = 20);
+	template<class IndexType = DWORD>
+	std::vector<IndexType> CreatePlaneIndices();
+	// CreateTerrain与CreateTerrainFromHeightmap的索引
+	template<class IndexType = DWORD>
+	std::vector<IndexType> CreateTerrainIndices(UINT slicesX = 10, UINT slicesZ = 10);
 }
 
 
@@ -112,29 +143,176 @@ namespace Geometry
 			DirectX::XMFLOAT2 tex;
 		};
 
+		//
+		// 顶点属性特性
+		// 在编译期按成员名(pos/normal/tangent/color/tex)判断顶点类型包含哪些属性，
+		// 生成顶点时直接写入对应成员，不需要在运行时查找输入布局；新的顶点类型沿用这些成员名即可
+		//
+
+		template<class VertexType, class = void>
+		struct HasPos : std::false_type {};
+		template<class VertexType>
+		struct HasPos<VertexType, decltype(void(std::declval<VertexType&>().pos))> : std::true_type {};
+
+		template<class VertexType, class = void>
+		struct HasNormal : std::false_type {};
+		template<class VertexType>
+		struct HasNormal<VertexType, decltype(void(std::declval<VertexType&>().normal))> : std::true_type {};
+
+		template<class VertexType, class = void>
+		struct HasTangent : std::false_type {};
+		template<class VertexType>
+		struct HasTangent<VertexType, decltype(void(std::declval<VertexType&>().tangent))> : std::true_type {};
+
+		template<class VertexType, class = void>
+		struct HasColor : std::false_type {};
+		template<class VertexType>
+		struct HasColor<VertexType, decltype(void(std::declval<VertexType&>().color))> : std::true_type {};
+
+		template<class VertexType, class = void>
+		struct HasTex : std::false_type {};
+		template<class VertexType>
+		struct HasTex<VertexType, decltype(void(std::declval<VertexType&>().tex))> : std::true_type {};
+
+		// 以下重载按顶点类型是否有对应成员在编译期选择，没有该成员时不做任何事
+		template<class VertexType>
+		inline void SetPos(VertexType& vertex, const DirectX::XMFLOAT3& pos, std::true_type) { vertex.pos = pos; }
+		template<class VertexType>
+		inline void SetPos(VertexType&, const DirectX::XMFLOAT3&, std::false_type) {}
+
+		template<class VertexType>
+		inline void SetNormal(VertexType& vertex, const DirectX::XMFLOAT3& normal, std::true_type) { vertex.normal = normal; }
+		template<class VertexType>
+		inline void SetNormal(VertexType&, const DirectX::XMFLOAT3&, std::false_type) {}
+
+		template<class VertexType>
+		inline void SetTangent(VertexType& vertex, const DirectX::XMFLOAT4& tangent, std::true_type) { vertex.tangent = tangent; }
+		template<class VertexType>
+		inline void SetTangent(VertexType&, const DirectX::XMFLOAT4&, std::false_type) {}
+
+		template<class VertexType>
+		inline void SetColor(VertexType& vertex, const DirectX::XMFLOAT4& color, std::true_type) { vertex.color = color; }
+		template<class VertexType>
+		inline void SetColor(VertexType&, const DirectX::XMFLOAT4&, std::false_type) {}
+
+		template<class VertexType>
+		inline void SetTex(VertexType& vertex, const DirectX::XMFLOAT2& tex, std::true_type) { vertex.tex = tex; }
+		template<class VertexType>
+		inline void SetTex(VertexType&, const DirectX::XMFLOAT2&, std::false_type) {}
+
 		// 根据目标顶点类型选择性将数据插入
+		// 内联展开后只剩对顶点已有成员的直接赋值
 		template<class VertexType>
 		inline void InsertVertexElement(VertexType& vertexDst, const VertexData& vertexSrc)
 		{
-			static std::string semanticName;
-			static const std::map<std::string, std::pair<size_t, size_t>> semanticSizeMap = {
-				{"POSITION", std::pair<size_t, size_t>(0, 12)},
-				{"NORMAL", std::pair<size_t, size_t>(12, 24)},
-				{"TANGENT", std::pair<size_t, size_t>(24, 40)},
-				{"COLOR", std::pair<size_t, size_t>(40, 56)},
-				{"TEXCOORD", std::pair<size_t, size_t>(56, 64)}
-			};
-
-			for (size_t i = 0; i < ARRAYSIZE(VertexType::inputLayout); i++)
+			static_assert(HasPos<VertexType>::value, "VertexType must have a pos member!");
+			SetPos(vertexDst, vertexSrc.pos, HasPos<VertexType>());
+			SetNormal(vertexDst, vertexSrc.normal, HasNormal<VertexType>());
+			SetTangent(vertexDst, vertexSrc.tangent, HasTangent<VertexType>());
+			SetColor(vertexDst, vertexSrc.color, HasColor<VertexType>());
+			SetTex(vertexDst, vertexSrc.tex, HasTex<VertexType>());
+		}
+
+		// 批量计算角度start + i * step(i = 0, 1, ..., count - 1)的正弦和余弦值
+		// 每次用XMVectorSinCos同时处理4个角度，避免在生成顶点的循环中逐个调用sinf/cosf
+		// 输出数组的长度会向上对齐到4的倍数
+		inline void ComputeSinCos(UINT count, float start, float step, std::vector<float>& sinVec, std::vector<float>& cosVec)
+		{
+			using namespace DirectX;
+
+			UINT alignedCount = (count + 3) & ~3u;
+			sinVec.resize(alignedCount);
+			cosVec.resize(alignedCount);
+
+			XMVECTOR laneOffsets = XMVectorSet(0.0f, 1.0f, 2.0f, 3.0f);
+			XMVECTOR stepVec = XMVectorReplicate(step);
+			XMVECTOR startVec = XMVectorReplicate(start);
+			XMVECTOR sinV, cosV;
+			for (UINT i = 0; i < alignedCount; i += 4)
 			{
-				semanticName = VertexType::inputLayout[i].SemanticName;
-				const auto& range = semanticSizeMap.at(semanticName);
-				memcpy_s(reinterpret_cast<char*>(&vertexDst) + VertexType::inputLayout[i].AlignedByteOffset,
-					range.second - range.first,
-					reinterpret_cast<const char*>(&vertexSrc) + range.first,
-					range.second - range.first);
+				// 每个角度都直接由序号算出，而不是逐步累加，避免误差积累
+				XMVECTOR indices = XMVectorAdd(XMVectorReplicate(static_cast<float>(i)), laneOffsets);
+				XMVectorSinCos(&sinV, &cosV, XMVectorMultiplyAdd(indices, stepVec, startVec));
+				XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(sinVec.data() + i), sinV);
+				XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(cosVec.data() + i), cosV);
 			}
 		}
+
+		// 放入地形第z行网格(以第z行顶点为下边)的索引
+		template<class IndexType>
+		inline void FillTerrainRowIndices(IndexType* indices, UINT slicesX, UINT z)
+		{
+			UINT iIndex = 6 * slicesX * z;
+			for (UINT j = 0; j < slicesX; ++j)
+			{
+				indices[iIndex++] = z * (slicesX + 1) + j;
+				indices[iIndex++] = (z + 1) * (slicesX + 1) + j;
+				indices[iIndex++] = (z + 1) * (slicesX + 1) + j + 1;
+
+				indices[iIndex++] = (z + 1) * (slicesX + 1) + j + 1;
+				indices[iIndex++] = z * (slicesX + 1) + j + 1;
+				indices[iIndex++] = z * (slicesX + 1) + j;
+			}
+		}
+
+		// 放入球体的索引，顶点布局为顶端点、levels - 1圈各slices + 1个顶点、底端点
+		template<class IndexType>
+		inline void FillSphereIndices(IndexType* indices, UINT levels, UINT slices)
+		{
+			UINT iIndex = 0;
+			if (levels > 1)
+			{
+				for (UINT j = 1; j <= slices; ++j)
+				{
+					indices[iIndex++] = 0;
+					indices[iIndex++] = j + 1;
+					indices[iIndex++] = j;
+				}
+			}
+
+			for (UINT i = 1; i < levels - 1; ++i)
+			{
+				for (UINT j = 1; j <= slices; ++j)
+				{
+					indices[iIndex++] = (i - 1) * (slices + 1) + j;
+					indices[iIndex++] = (i - 1) * (slices + 1) + j + 1;
+					indices[iIndex++] = i * (slices + 1) + j + 1;
+
+					indices[iIndex++] = i * (slices + 1) + j + 1;
+					indices[iIndex++] = i * (slices + 1) + j;
+					indices[iIndex++] = (i - 1) * (slices + 1) + j;
+				}
+			}
+
+			// 逐渐放入索引
+			if (levels > 1)
+			{
+				for (UINT j = 1; j <= slices; ++j)
+				{
+					indices[iIndex++] = (levels - 2) * (slices + 1) + j;
+					indices[iIndex++] = (levels - 2) * (slices + 1) + j + 1;
+					indices[iIndex++] = (levels - 1) * (slices + 1) + 1;
+				}
+			}
+		}
+
+		// 读取一行高度中从first开始的4个值，超出[0, last]的下标取边界值
+		inline DirectX::XMVECTOR LoadHeightsClamped(const float* rowHeights, int first, UINT last)
+		{
+			using namespace DirectX;
+
+			if (first >= 0 && static_cast<UINT>(first) + 3 <= last)
+				return XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(rowHeights + first));
+
+			float values[4];
+			for (int i = 0; i < 4; ++i)
+			{
+				int index = first + i;
+				index = index < 0 ? 0 : (static_cast<UINT>(index) > last ? static_cast<int>(last) : index);
+				values[i] = rowHeights[index];
+			}
+			return XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(values));
+		}
 	}
 	
 	//
@@ -153,12 +331,16 @@ namespace Geometry
 		meshData.indexVec.resize(indexCount);
 
 		Internal::VertexData vertexData;
-		IndexType vIndex = 0, iIndex = 0;
+		IndexType vIndex = 0;
 
 		float phi = 0.0f, theta = 0.0f;
 		float per_phi = XM_PI / levels;
 		float per_theta = XM_2PI / slices;
-		float x, y, z;
+
+		// 每一层的phi和每一列的theta的正余弦值只需计算一次，各层共用同一圈theta的结果
+		std::vector<float> sinPhi, cosPhi, sinTheta, cosTheta;
+		Internal::ComputeSinCos(levels, 0.0f, per_phi, sinPhi, cosPhi);
+		Internal::ComputeSinCos(slices + 1, 0.0f, per_theta, sinTheta, cosTheta);
 
 		// 放入顶端点
 		vertexData = { XMFLOAT3(0.0f, radius, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT4(1.0f, 0.0f, 0.0f, 1.0f), color, XMFLOAT2(0.0f, 0.0f) };
@@ -167,18 +349,16 @@ namespace Geometry
 		for (UINT i = 1; i < levels; ++i)
 		{
 			phi = per_phi * i;
+			float ringRadius = sinPhi[i], ringY = cosPhi[i];
 			// 需要slices + 1个顶点是因为 起点和终点需为同一点，但纹理坐标值不一致
 			for (UINT j = 0; j <= slices; ++j)
 			{
 				theta = per_theta * j;
-				x = radius * sinf(phi) * cosf(theta);
-				y = radius * cosf(phi);
-				z = radius * sinf(phi) * sinf(theta);
-				// 计算出局部坐标、法向量、Tangent向量和纹理坐标
-				XMFLOAT3 pos = XMFLOAT3(x, y, z), normal;
-				XMStoreFloat3(&normal, XMVector3Normalize(XMLoadFloat3(&pos)));
-
-				vertexData = { pos, normal, XMFLOAT4(-sinf(theta), 0.0f, cosf(theta), 1.0f), color, XMFLOAT2(theta / XM_2PI, phi / XM_PI) };
+				// 单位球面上的点即为法向量，乘以半径得到局部坐标
+				XMFLOAT3 normal = XMFLOAT3(ringRadius * cosTheta[j], ringY, ringRadius * sinTheta[j]);
+				XMFLOAT3 pos = XMFLOAT3(radius * normal.x, radius * normal.y, radius * normal.z);
+
+				vertexData = { pos, normal, XMFLOAT4(-sinTheta[j], 0.0f, cosTheta[j], 1.0f), color, XMFLOAT2(theta / XM_2PI, phi / XM_PI) };
 				Internal::InsertVertexElement(meshData.vertexVec[vIndex++], vertexData);
 			}
 		}
@@ -190,42 +370,7 @@ namespace Geometry
 
 
 		// 放入索引
-		if (levels > 1)
-		{
-			for (UINT j = 1; j <= slices; ++j)
-			{
-				meshData.indexVec[iIndex++] = 0;
-				meshData.indexVec[iIndex++] = j % (slices + 1) + 1;
-				meshData.indexVec[iIndex++] = j;
-			}
-		}
-
-
-		for (UINT i = 1; i < levels - 1; ++i)
-		{
-			for (UINT j = 1; j <= slices; ++j)
-			{
-				meshData.indexVec[iIndex++] = (i - 1) * (slices + 1) + j;
-				meshData.indexVec[iIndex++] = (i - 1) * (slices + 1) + j % (slices + 1) + 1;
-				meshData.indexVec[iIndex++] = i * (slices + 1) + j % (slices + 1) + 1;
-
-				meshData.indexVec[iIndex++] = i * (slices + 1) + j % (slices + 1) + 1;
-				meshData.indexVec[iIndex++] = i * (slices + 1) + j;
-				meshData.indexVec[iIndex++] = (i - 1) * (slices + 1) + j;
-			}
-		}
-
-		// 逐渐放入索引
-		if (levels > 1)
-		{
-			for (UINT j = 1; j <= slices; ++j)
-			{
-				meshData.indexVec[iIndex++] = (levels - 2) * (slices + 1) + j;
-				meshData.indexVec[iIndex++] = (levels - 2) * (slices + 1) + j % (slices + 1) + 1;
-				meshData.indexVec[iIndex++] = (levels - 1) * (slices + 1) + 1;
-			}
-		}
-
+		Internal::FillSphereIndices(meshData.indexVec.data(), levels, slices);
 
 		return meshData;
 	}
@@ -338,13 +483,15 @@ namespace Geometry
 		meshData.indexVec.resize(indexCount);
 
 		float h2 = height / 2;
-		float theta = 0.0f;
 		float per_theta = XM_2PI / slices;
 
 		IndexType vIndex = 2 * (slices + 1), iIndex = 6 * slices;
 		IndexType offset = 2 * (slices + 1);
 		Internal::VertexData vertexData;
 
+		std::vector<float> sinTheta, cosTheta;
+		Internal::ComputeSinCos(slices + 1, 0.0f, per_theta, sinTheta, cosTheta);
+
 		// 放入顶端圆心
 		vertexData = { XMFLOAT3(0.0f, h2, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f),
 			XMFLOAT4(1.0f, 0.0f, 0.0f, 1.0f), color, XMFLOAT2(0.5f, 0.5f) };
@@ -353,9 +500,8 @@ namespace Geometry
 		// 放入顶端圆上各点
 		for (UINT i = 0; i <= slices; ++i)
 		{
-			theta = i * per_theta;
-			vertexData = { XMFLOAT3(radius * cosf(theta), h2, radius * sinf(theta)), XMFLOAT3(0.0f, 1.0f, 0.0f),
-				XMFLOAT4(1.0f, 0.0f, 0.0f, 1.0f), color, XMFLOAT2(cosf(theta) / 2 + 0.5f, sinf(theta) / 2 + 0.5f) };
+			vertexData = { XMFLOAT3(radius * cosTheta[i], h2, radius * sinTheta[i]), XMFLOAT3(0.0f, 1.0f, 0.0f),
+				XMFLOAT4(1.0f, 0.0f, 0.0f, 1.0f), color, XMFLOAT2(cosTheta[i] / 2 + 0.5f, sinTheta[i] / 2 + 0.5f) };
 			Internal::InsertVertexElement(meshData.vertexVec[vIndex++], vertexData);
 		}
 
@@ -367,9 +513,8 @@ namespace Geometry
 		// 放入底部圆上各点
 		for (UINT i = 0; i <= slices; ++i)
 		{
-			theta = i * per_theta;
-			vertexData = { XMFLOAT3(radius * cosf(theta), -h2, radius * sinf(theta)), XMFLOAT3(0.0f, -1.0f, 0.0f),
-				XMFLOAT4(-1.0f, 0.0f, 0.0f, 1.0f), color, XMFLOAT2(cosf(theta) / 2 + 0.5f, sinf(theta) / 2 + 0.5f) };
+			vertexData = { XMFLOAT3(radius * cosTheta[i], -h2, radius * sinTheta[i]), XMFLOAT3(0.0f, -1.0f, 0.0f),
+				XMFLOAT4(-1.0f, 0.0f, 0.0f, 1.0f), color, XMFLOAT2(cosTheta[i] / 2 + 0.5f, sinTheta[i] / 2 + 0.5f) };
 			Internal::InsertVertexElement(meshData.vertexVec[vIndex++], vertexData);
 		}
 
@@ -379,7 +524,7 @@ namespace Geometry
 		for (UINT i = 1; i <= slices; ++i)
 		{
 			meshData.indexVec[iIndex++] = offset;
-			meshData.indexVec[iIndex++] = offset + i % (slices + 1) + 1;
+			meshData.indexVec[iIndex++] = offset + i + 1;
 			meshData.indexVec[iIndex++] = offset + i;
 		}
 
@@ -389,7 +534,7 @@ namespace Geometry
 		{
 			meshData.indexVec[iIndex++] = offset;
 			meshData.indexVec[iIndex++] = offset + i;
-			meshData.indexVec[iIndex++] = offset + i % (slices + 1) + 1;
+			meshData.indexVec[iIndex++] = offset + i + 1;
 		}
 
 		return meshData;
@@ -412,23 +557,21 @@ namespace Geometry
 
 		Internal::VertexData vertexData;
 
-		// 放入侧面顶端点
+		// 顶端和底端两圈顶点共用同一组正余弦值
+		std::vector<float> sinTheta, cosTheta;
+		Internal::ComputeSinCos(slices + 1, 0.0f, per_theta, sinTheta, cosTheta);
+
+		// 同时放入侧面顶端点和底端点
 		for (UINT i = 0; i <= slices; ++i)
 		{
 			theta = i * per_theta;
-			vertexData = { XMFLOAT3(radius * cosf(theta), h2, radius * sinf(theta)), XMFLOAT3(cosf(theta), 0.0f, sinf(theta)),
-				XMFLOAT4(-sinf(theta), 0.0f, cosf(theta), 1.0f), color, XMFLOAT2(theta / XM_2PI, 0.0f) };
+			vertexData = { XMFLOAT3(radius * cosTheta[i], h2, radius * sinTheta[i]), XMFLOAT3(cosTheta[i], 0.0f, sinTheta[i]),
+				XMFLOAT4(-sinTheta[i], 0.0f, cosTheta[i], 1.0f), color, XMFLOAT2(theta / XM_2PI, 0.0f) };
 			Internal::InsertVertexElement(meshData.vertexVec[i], vertexData);
-		}
 
-		// 放入侧面底端点
-		for (UINT i = 0; i <= slices; ++i)
-		{
-			theta = i * per_theta;
-			vertexData = { XMFLOAT3(radius * cosf(theta), -h2, radius * sinf(theta)), XMFLOAT3(cosf(theta), 0.0f, sinf(theta)),
-				XMFLOAT4(-sinf(theta), 0.0f, cosf(theta), 1.0f), color, XMFLOAT2(theta / XM_2PI, 1.0f) };
-			UINT vIndex = (slices + 1) + i;
-			Internal::InsertVertexElement(meshData.vertexVec[vIndex], vertexData);
+			vertexData.pos.y = -h2;
+			vertexData.tex.y = 1.0f;
+			Internal::InsertVertexElement(meshData.vertexVec[(slices + 1) + i], vertexData);
 		}
 
 		// 放入索引
@@ -461,18 +604,19 @@ namespace Geometry
 		meshData.indexVec.resize(indexCount);
 		
 		float h2 = height / 2;
-		float theta = 0.0f;
 		float per_theta = XM_2PI / slices;
 		UINT iIndex = 3 * slices;
 		UINT vIndex = 2 * slices;
 		Internal::VertexData vertexData;
 
+		std::vector<float> sinTheta, cosTheta;
+		Internal::ComputeSinCos(slices, 0.0f, per_theta, sinTheta, cosTheta);
+
 		// 放入圆锥底面顶点
 		for (UINT i = 0; i < slices; ++i)
 		{
-			theta = i * per_theta;
-			vertexData = { XMFLOAT3(radius * cosf(theta), -h2, radius * sinf(theta)), XMFLOAT3(0.0f, -1.0f, 0.0f),
-				XMFLOAT4(-1.0f, 0.0f, 0.0f, 1.0f), color, XMFLOAT2(cosf(theta) / 2 + 0.5f, sinf(theta) / 2 + 0.5f) };
+			vertexData = { XMFLOAT3(radius * cosTheta[i], -h2, radius * sinTheta[i]), XMFLOAT3(0.0f, -1.0f, 0.0f),
+				XMFLOAT4(-1.0f, 0.0f, 0.0f, 1.0f), color, XMFLOAT2(cosTheta[i] / 2 + 0.5f, sinTheta[i] / 2 + 0.5f) };
 			Internal::InsertVertexElement(meshData.vertexVec[vIndex++], vertexData);
 		}
 		// 放入圆锥底面圆心
@@ -485,8 +629,8 @@ namespace Geometry
 		for (UINT i = 0; i < slices; ++i)
 		{
 			meshData.indexVec[iIndex++] = offset + slices;
-			meshData.indexVec[iIndex++] = offset + i % slices;
-			meshData.indexVec[iIndex++] = offset + (i + 1) % slices;
+			meshData.indexVec[iIndex++] = offset + i;
+			meshData.indexVec[iIndex++] = offset + (i + 1 < slices ? i + 1 : 0);
 		}
 
 		return meshData;
@@ -504,28 +648,31 @@ namespace Geometry
 		meshData.indexVec.resize(indexCount);
 
 		float h2 = height / 2;
-		float theta = 0.0f;
 		float per_theta = XM_2PI / slices;
 		float len = sqrtf(height * height + radius * radius);
 		UINT iIndex = 0;
 		UINT vIndex = 0;
 		Internal::VertexData vertexData;
 
+		// 尖端顶点位于各扇区的中间角度，底部顶点位于扇区的起始角度
+		std::vector<float> sinMid, cosMid, sinTheta, cosTheta;
+		Internal::ComputeSinCos(slices, per_theta / 2, per_theta, sinMid, cosMid);
+		Internal::ComputeSinCos(slices, 0.0f, per_theta, sinTheta, cosTheta);
+		float normalXZ = radius / len, normalY = height / len;
+
 		// 放入圆锥尖端顶点(每个顶点位置相同，但包含不同的法向量和切线向量)
 		for (UINT i = 0; i < slices; ++i)
 		{
-			theta = i * per_theta + per_theta / 2;
-			vertexData = { XMFLOAT3(0.0f, h2, 0.0f), XMFLOAT3(radius * cosf(theta) / len, height / len, radius * sinf(theta) / len),
-				XMFLOAT4(-sinf(theta), 0.0f, cosf(theta), 1.0f), color, XMFLOAT2(0.5f, 0.5f) };
+			vertexData = { XMFLOAT3(0.0f, h2, 0.0f), XMFLOAT3(normalXZ * cosMid[i], normalY, normalXZ * sinMid[i]),
+				XMFLOAT4(-sinMid[i], 0.0f, cosMid[i], 1.0f), color, XMFLOAT2(0.5f, 0.5f) };
 			Internal::InsertVertexElement(meshData.vertexVec[vIndex++], vertexData);
 		}
 
 		// 放入圆锥侧面底部顶点
 		for (UINT i = 0; i < slices; ++i)
 		{
-			theta = i * per_theta;
-			vertexData = { XMFLOAT3(radius * cosf(theta), -h2, radius * sinf(theta)), XMFLOAT3(radius * cosf(theta) / len, height / len, radius * sinf(theta) / len),
-				XMFLOAT4(-sinf(theta), 0.0f, cosf(theta), 1.0f), color, XMFLOAT2(cosf(theta) / 2 + 0.5f, sinf(theta) / 2 + 0.5f) };
+			vertexData = { XMFLOAT3(radius * cosTheta[i], -h2, radius * sinTheta[i]), XMFLOAT3(normalXZ * cosTheta[i], normalY, normalXZ * sinTheta[i]),
+				XMFLOAT4(-sinTheta[i], 0.0f, cosTheta[i], 1.0f), color, XMFLOAT2(cosTheta[i] / 2 + 0.5f, sinTheta[i] / 2 + 0.5f) };
 			Internal::InsertVertexElement(meshData.vertexVec[vIndex++], vertexData);
 		}
 
@@ -533,8 +680,8 @@ namespace Geometry
 		for (UINT i = 0; i < slices; ++i)
 		{
 			meshData.indexVec[iIndex++] = i;
-			meshData.indexVec[iIndex++] = slices + (i + 1) % slices;
-			meshData.indexVec[iIndex++] = slices + i % slices;
+			meshData.indexVec[iIndex++] = slices + (i + 1 < slices ? i + 1 : 0);
+			meshData.indexVec[iIndex++] = slices + i;
 		}
 
 		return meshData;
@@ -573,7 +720,7 @@ namespace Geometry
 			XMFLOAT4(1.0f, 0.0f, 0.0f, 1.0f), color, XMFLOAT2(1.0f, 1.0f) };
 		Internal::InsertVertexElement(meshData.vertexVec[vIndex++], vertexData);
 
-		meshData.indexVec = { 0, 1, 2, 2, 3, 0 };
+		meshData.indexVec = CreatePlaneIndices<IndexType>();
 		return meshData;
 	}
 
@@ -611,7 +758,7 @@ namespace Geometry
 			XMFLOAT4(1.0f, 0.0f, 0.0f, 1.0f), color, XMFLOAT2(texU, texV) };
 		Internal::InsertVertexElement(meshData.vertexVec[vIndex++], vertexData);
 
-		meshData.indexVec = { 0, 1, 2, 2, 3, 0 };
+		meshData.indexVec = CreatePlaneIndices<IndexType>();
 		return meshData;
 	}
 	template<class VertexType, class IndexType>
@@ -629,6 +776,14 @@ namespace Geometry
 		float texU, float texV, const std::function<float(float, float)>& heightFunc,
 		const std::function<DirectX::XMFLOAT3(float, float)>& normalFunc,
 		const std::function<DirectX::XMFLOAT4(float, float)>& colorFunc)
+	{
+		return CreateTerrain<VertexType, IndexType>(width, depth, slicesX, slicesZ, texU, texV,
+			heightFunc, normalFunc, colorFunc, nullptr);
+	}
+
+	template<class VertexType, class IndexType, class HeightFunc, class NormalFunc, class ColorFunc>
+	MeshData<VertexType, IndexType> CreateTerrain(float width, float depth, UINT slicesX, UINT slicesZ, float texU, float texV,
+		HeightFunc&& heightFunc, NormalFunc&& normalFunc, ColorFunc&& colorFunc, ThreadPool* pool)
 	{
 		using namespace DirectX;
 
@@ -638,29 +793,33 @@ namespace Geometry
 		meshData.vertexVec.resize(vertexCount);
 		meshData.indexVec.resize(indexCount);
 
-		Internal::VertexData vertexData;
-		UINT vIndex = 0;
-		UINT iIndex = 0;
-
 		float sliceWidth = width / slicesX;
-		float sliceDepth = width / slicesZ;
+		float sliceDepth = depth / slicesZ;
 		float leftBottomX = -width / 2;
 		float leftBottomZ = -depth / 2;
-		float posX, posZ;
 		float sliceTexWidth = texU / slicesX;
 		float sliceTexDepth = texV / slicesZ;
 
-		XMFLOAT3 normal;
-		XMFLOAT4 tangent;
-		// 创建网格顶点
+		VertexType* vertices = meshData.vertexVec.data();
+		IndexType* indices = meshData.indexVec.data();
+
+		// 生成第z行顶点，以及以该行为下边的一行网格的索引(最上面一行顶点没有对应的网格)
+		// 每行写入的顶点和索引区间都是固定的，各行之间互不影响，可以并行执行
 		//  __ __
 		// | /| /|
 		// |/_|/_|
 		// | /| /| 
 		// |/_|/_|
-		for (UINT z = 0; z <= slicesZ; ++z)
+		auto generateRow = [&](size_t row)
 		{
-			posZ = leftBottomZ + z * sliceDepth;
+			UINT z = static_cast<UINT>(row);
+			float posZ = leftBottomZ + z * sliceDepth;
+			float posX;
+			Internal::VertexData vertexData;
+			XMFLOAT3 normal;
+			XMFLOAT4 tangent;
+
+			UINT vIndex = z * (slicesX + 1);
 			for (UINT x = 0; x <= slicesX; ++x)
 			{
 				posX = leftBottomX + x * sliceWidth;
@@ -672,28 +831,178 @@ namespace Geometry
 
 				vertexData = { XMFLOAT3(posX, heightFunc(posX, posZ), posZ),
 					normal, tangent, colorFunc(posX, posZ), XMFLOAT2(x * sliceTexWidth, texV - z * sliceTexDepth) };
-				Internal::InsertVertexElement(meshData.vertexVec[vIndex++], vertexData);
+				Internal::InsertVertexElement(vertices[vIndex++], vertexData);
 			}
+
+			// 放入索引
+			if (z < slicesZ)
+				Internal::FillTerrainRowIndices(indices, slicesX, z);
+		};
+
+		if (pool)
+			pool->ParallelFor(slicesZ + 1, generateRow);
+		else
+		{
+			for (UINT z = 0; z <= slicesZ; ++z)
+				generateRow(z);
 		}
-		// 放入索引
-		for (UINT i = 0; i < slicesZ; ++i)
+
+		return meshData;
+	}
+
+	template<class HeightFunc>
+	std::vector<float> SampleHeightmap(float width, float depth, UINT slicesX, UINT slicesZ,
+		HeightFunc&& heightFunc, ThreadPool* pool)
+	{
+		std::vector<float> heights((slicesX + 1) * (slicesZ + 1));
+
+		float sliceWidth = width / slicesX;
+		float sliceDepth = depth / slicesZ;
+		float leftBottomX = -width / 2;
+		float leftBottomZ = -depth / 2;
+
+		auto sampleRow = [&](size_t row)
 		{
-			for (UINT j = 0; j < slicesX; ++j)
-			{
-				meshData.indexVec[iIndex++] = i * (slicesX + 1) + j;
-				meshData.indexVec[iIndex++] = (i + 1) * (slicesX + 1) + j;
-				meshData.indexVec[iIndex++] = (i + 1) * (slicesX + 1) + j + 1;
+			UINT z = static_cast<UINT>(row);
+			float posZ = leftBottomZ + z * sliceDepth;
+			float* rowHeights = heights.data() + z * (slicesX + 1);
+			for (UINT x = 0; x <= slicesX; ++x)
+				rowHeights[x] = heightFunc(leftBottomX + x * sliceWidth, posZ);
+		};
+
+		if (pool)
+			pool->ParallelFor(slicesZ + 1, sampleRow);
+		else
+		{
+			for (UINT z = 0; z <= slicesZ; ++z)
+				sampleRow(z);
+		}
+
+		return heights;
+	}
+
+	template<class VertexType, class IndexType>
+	MeshData<VertexType, IndexType> CreateTerrainFromHeightmap(float width, float depth, UINT slicesX, UINT slicesZ,
+		const float* heights, float texU, float texV, const DirectX::XMFLOAT4& color, ThreadPool* pool)
+	{
+		using namespace DirectX;
+
+		MeshData<VertexType, IndexType> meshData;
+		UINT vertexCount = (slicesX + 1) * (slicesZ + 1);
+		UINT indexCount = 6 * slicesX * slicesZ;
+		meshData.vertexVec.resize(vertexCount);
+		meshData.indexVec.resize(indexCount);
 
-				meshData.indexVec[iIndex++] = (i + 1) * (slicesX + 1) + j + 1;
-				meshData.indexVec[iIndex++] = i * (slicesX + 1) + j + 1;
-				meshData.indexVec[iIndex++] = i * (slicesX + 1) + j;
+		float sliceWidth = width / slicesX;
+		float sliceDepth = depth / slicesZ;
+		float leftBottomX = -width / 2;
+		float leftBottomZ = -depth / 2;
+		float sliceTexWidth = texU / slicesX;
+		float sliceTexDepth = texV / slicesZ;
+
+		VertexType* vertices = meshData.vertexVec.data();
+		IndexType* indices = meshData.indexVec.data();
+
+		// 每次处理一行中连续的4个顶点：高度的x、z方向偏导数由左右、前后相邻高度的差分求得，
+		// 法向量为(-dh/dx, 1, -dh/dz)，切线沿+x方向为(1, dh/dx, 0)，二者都在4个通道上同时归一化
+		auto generateRow = [&](size_t row)
+		{
+			UINT z = static_cast<UINT>(row);
+			UINT rowPitch = slicesX + 1;
+			const float* rowHeights = heights + z * rowPitch;
+			const float* prevRow = z > 0 ? rowHeights - rowPitch : rowHeights;
+			const float* nextRow = z < slicesZ ? rowHeights + rowPitch : rowHeights;
+			float posZ = leftBottomZ + z * sliceDepth;
+			float texY = texV - z * sliceTexDepth;
+
+			XMVECTOR invSpanZ = XMVectorReplicate((z > 0 && z < slicesZ ? 0.5f : 1.0f) / sliceDepth);
+			XMVECTOR invSpanXInner = XMVectorReplicate(0.5f / sliceWidth);
+			XMVECTOR one = XMVectorReplicate(1.0f);
+			float heightLanes[4], normalXLanes[4], normalYLanes[4], normalZLanes[4], tangentXLanes[4], tangentYLanes[4];
+			Internal::VertexData vertexData;
+			vertexData.color = color;
+
+			for (UINT x = 0; x <= slicesX; x += 4)
+			{
+				int first = static_cast<int>(x);
+				XMVECTOR center = Internal::LoadHeightsClamped(rowHeights, first, slicesX);
+				XMVECTOR left = Internal::LoadHeightsClamped(rowHeights, first - 1, slicesX);
+				XMVECTOR right = Internal::LoadHeightsClamped(rowHeights, first + 1, slicesX);
+				XMVECTOR prev = Internal::LoadHeightsClamped(prevRow, first, slicesX);
+				XMVECTOR next = Internal::LoadHeightsClamped(nextRow, first, slicesX);
+
+				// 行首和行尾的顶点只有一侧有相邻高度，差分跨度为一个网格
+				XMVECTOR invSpanX = invSpanXInner;
+				if (x == 0 || x + 3 >= slicesX)
+				{
+					float spans[4];
+					for (UINT i = 0; i < 4; ++i)
+						spans[i] = (x + i == 0 || x + i >= slicesX ? 1.0f : 0.5f) / sliceWidth;
+					invSpanX = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(spans));
+				}
+
+				XMVECTOR dhdx = XMVectorMultiply(XMVectorSubtract(right, left), invSpanX);
+				XMVECTOR dhdz = XMVectorMultiply(XMVectorSubtract(next, prev), invSpanZ);
+				XMVECTOR dhdx2 = XMVectorMultiply(dhdx, dhdx);
+				XMVECTOR invNormalLength = XMVectorReciprocalSqrt(XMVectorMultiplyAdd(dhdz, dhdz, XMVectorAdd(dhdx2, one)));
+				XMVECTOR invTangentLength = XMVectorReciprocalSqrt(XMVectorAdd(dhdx2, one));
+
+				XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(heightLanes), center);
+				XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(normalXLanes), XMVectorNegate(XMVectorMultiply(dhdx, invNormalLength)));
+				XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(normalYLanes), invNormalLength);
+				XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(normalZLanes), XMVectorNegate(XMVectorMultiply(dhdz, invNormalLength)));
+				XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(tangentXLanes), invTangentLength);
+				XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(tangentYLanes), XMVectorMultiply(dhdx, invTangentLength));
+
+				UINT laneCount = slicesX + 1 - x < 4 ? slicesX + 1 - x : 4;
+				for (UINT i = 0; i < laneCount; ++i)
+				{
+					vertexData.pos = XMFLOAT3(leftBottomX + (x + i) * sliceWidth, heightLanes[i], posZ);
+					vertexData.normal = XMFLOAT3(normalXLanes[i], normalYLanes[i], normalZLanes[i]);
+					vertexData.tangent = XMFLOAT4(tangentXLanes[i], tangentYLanes[i], 0.0f, 1.0f);
+					vertexData.tex = XMFLOAT2((x + i) * sliceTexWidth, texY);
+					Internal::InsertVertexElement(vertices[z * rowPitch + x + i], vertexData);
+				}
 			}
+
+			// 放入索引
+			if (z < slicesZ)
+				Internal::FillTerrainRowIndices(indices, slicesX, z);
+		};
+
+		if (pool)
+			pool->ParallelFor(slicesZ + 1, generateRow);
+		else
+		{
+			for (UINT z = 0; z <= slicesZ; ++z)
+				generateRow(z);
 		}
 
 		return meshData;
 	}
 
+	template<class IndexType>
+	inline std::vector<IndexType> CreateSphereIndices(UINT levels, UINT slices)
+	{
+		std::vector<IndexType> indices(6 * (levels - 1) * slices);
+		Internal::FillSphereIndices(indices.data(), levels, slices);
+		return indices;
+	}
+
+	template<class IndexType>
+	inline std::vector<IndexType> CreatePlaneIndices()
+	{
+		return { 0, 1, 2, 2, 3, 0 };
+	}
 
+	template<class IndexType>
+	inline std::vector<IndexType> CreateTerrainIndices(UINT slicesX, UINT slicesZ)
+	{
+		std::vector<IndexType> indices(6 * slicesX * slicesZ);
+		for (UINT z = 0; z < slicesZ; ++z)
+			Internal::FillTerrainRowIndices(indices.data(), slicesX, z);
+		return indices;
+	}
 }
 
 
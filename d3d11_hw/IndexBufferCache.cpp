@@ -0,0 +1,61 @@
+#include "IndexBufferCache.h"
+#include "d3dUtil.h"
+#include "DXTrace.h"
+
+IndexBufferCache::IndexBufferCache()
+	: m_Buffers(), m_Stats()
+{
+}
+
+void IndexBufferCache::Clear()
+{
+	m_Buffers.clear();
+}
+
+Microsoft::WRL::ComPtr<ID3D11Buffer> IndexBufferCache::CreateIndexBuffer(ID3D11Device * device,
+	const void* indices, UINT indexCount, DXGI_FORMAT indexFormat)
+{
+	D3D11_BUFFER_DESC ibd;
+	ZeroMemory(&ibd, sizeof(ibd));
+	ibd.Usage = D3D11_USAGE_IMMUTABLE;
+	ibd.ByteWidth = indexCount * (indexFormat == DXGI_FORMAT_R16_UINT ? (UINT)sizeof(WORD) : (UINT)sizeof(DWORD));
+	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	ibd.CPUAccessFlags = 0;
+	D3D11_SUBRESOURCE_DATA InitData;
+	ZeroMemory(&InitData, sizeof(InitData));
+	InitData.pSysMem = indices;
+	ComPtr<ID3D11Buffer> buffer;
+	HR(device->CreateBuffer(&ibd, &InitData, buffer.GetAddressOf()));
+	return buffer;
+}
+
+size_t IndexBufferCache::KeyHash::operator()(const Key& key) const
+{
+	size_t hash = (size_t)key.topology;
+	hash = hash * 31 + key.param0;
+	hash = hash * 31 + key.param1;
+	hash = hash * 31 + (size_t)key.indexFormat;
+	return hash;
+}
+
+const IndexBufferCache::SharedIndexBuffer* IndexBufferCache::Find(const Key& key)
+{
+	auto it = m_Buffers.find(key);
+	if (it == m_Buffers.end())
+		return nullptr;
+	++m_Stats.hits;
+	m_Stats.bytesShared += it->second.indexCount * (key.indexFormat == DXGI_FORMAT_R16_UINT ? sizeof(WORD) : sizeof(DWORD));
+	return &it->second;
+}
+
+const IndexBufferCache::SharedIndexBuffer& IndexBufferCache::Insert(ID3D11Device * device, const Key& key,
+	const void* indices, UINT indexCount)
+{
+	SharedIndexBuffer& entry = m_Buffers[key];
+	entry.buffer = CreateIndexBuffer(device, indices, indexCount, key.indexFormat);
+	entry.indexCount = indexCount;
+	entry.indexFormat = key.indexFormat;
+	++m_Stats.misses;
+	m_Stats.bytesCreated += indexCount * (key.indexFormat == DXGI_FORMAT_R16_UINT ? sizeof(WORD) : sizeof(DWORD));
+	return entry;
+}
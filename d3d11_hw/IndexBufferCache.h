@@ -0,0 +1,136 @@
+//***************************************************************************************
+// IndexBufferCache.h
+// Licensed under the MIT License.
+//
+// 按拓扑共享的不可变索引缓冲区：索引只取决于生成方法与细分参数的网格共用同一个缓冲区
+// Shared immutable index buffers keyed by generator topology and slice parameters.
+//***************************************************************************************
+
+#ifndef INDEXBUFFERCACHE_H
+#define INDEXBUFFERCACHE_H
+
+#include <unordered_map>
+#include <vector>
+#include <wrl/client.h>
+#include "Geometry.h"
+
+// 缓存只对应一个设备，不是线程安全的
+// 缓冲区创建后不再修改，已分发的缓冲区由持有者的引用保持有效，Clear之后也可以继续使用
+class IndexBufferCache
+{
+public:
+	template <class T>
+	using ComPtr = Microsoft::WRL::ComPtr<T>;
+
+	// 生成索引的方法，与细分参数、索引格式一起作为键
+	enum class Topology : UINT
+	{
+		Plane,			// Geometry::CreatePlane与Create2DShow，无参数
+		Terrain,		// Geometry::CreateTerrain与CreateTerrainFromHeightmap，参数为slicesX, slicesZ
+		Sphere,			// Geometry::CreateSphere，参数为levels, slices
+		TerrainStitch	// TerrainQuadTree::CreateStitchIndices，参数为tileQuads
+	};
+
+	struct SharedIndexBuffer
+	{
+		ComPtr<ID3D11Buffer> buffer;
+		UINT indexCount;
+		DXGI_FORMAT indexFormat;
+	};
+
+	struct Stats
+	{
+		UINT hits;				// 直接返回已有缓冲区的次数
+		UINT misses;			// 生成索引并创建缓冲区的次数
+		UINT64 bytesCreated;	// 创建的索引缓冲区总大小
+		UINT64 bytesShared;		// 命中时省去的索引缓冲区总大小
+	};
+
+	IndexBufferCache();
+
+	IndexBufferCache(const IndexBufferCache&) = delete;
+	IndexBufferCache& operator=(const IndexBufferCache&) = delete;
+
+	template<class IndexType = DWORD>
+	SharedIndexBuffer GetPlane(ID3D11Device * device);
+	template<class IndexType = DWORD>
+	SharedIndexBuffer GetTerrain(ID3D11Device * device, UINT slicesX, UINT slicesZ);
+	template<class IndexType = DWORD>
+	SharedIndexBuffer GetSphere(ID3D11Device * device, UINT levels, UINT slices);
+
+	// 未命中时才调用generateIndices()生成索引(返回std::vector<IndexType>)并创建缓冲区
+	template<class IndexType, class Func>
+	SharedIndexBuffer GetOrCreate(ID3D11Device * device, Topology topology, UINT param0, UINT param1, Func&& generateIndices);
+
+	// 释放缓存持有的引用
+	void Clear();
+	const Stats& GetStats() const { return m_Stats; }
+
+	// 不经过缓存直接创建不可变的索引缓冲区
+	static ComPtr<ID3D11Buffer> CreateIndexBuffer(ID3D11Device * device, const void* indices, UINT indexCount, DXGI_FORMAT indexFormat);
+
+private:
+	struct Key
+	{
+		Topology topology;
+		UINT param0;
+		UINT param1;
+		DXGI_FORMAT indexFormat;
+
+		bool operator==(const Key& other) const
+		{
+			return topology == other.topology && param0 == other.param0 &&
+				param1 == other.param1 && indexFormat == other.indexFormat;
+		}
+	};
+
+	struct KeyHash
+	{
+		size_t operator()(const Key& key) const;
+	};
+
+	// 命中时更新统计并返回缓冲区，否则返回nullptr
+	const SharedIndexBuffer* Find(const Key& key);
+	const SharedIndexBuffer& Insert(ID3D11Device * device, const Key& key, const void* indices, UINT indexCount);
+
+	std::unordered_map<Key, SharedIndexBuffer, KeyHash> m_Buffers;
+	Stats m_Stats;
+};
+
+template<class IndexType>
+inline IndexBufferCache::SharedIndexBuffer IndexBufferCache::GetPlane(ID3D11Device * device)
+{
+	return GetOrCreate<IndexType>(device, Topology::Plane, 0, 0,
+		[]() { return Geometry::CreatePlaneIndices<IndexType>(); });
+}
+
+template<class IndexType>
+inline IndexBufferCache::SharedIndexBuffer IndexBufferCache::GetTerrain(ID3D11Device * device, UINT slicesX, UINT slicesZ)
+{
+	return GetOrCreate<IndexType>(device, Topology::Terrain, slicesX, slicesZ,
+		[=]() { return Geometry::CreateTerrainIndices<IndexType>(slicesX, slicesZ); });
+}
+
+template<class IndexType>
+inline IndexBufferCache::SharedIndexBuffer IndexBufferCache::GetSphere(ID3D11Device * device, UINT levels, UINT slices)
+{
+	return GetOrCreate<IndexType>(device, Topology::Sphere, levels, slices,
+		[=]() { return Geometry::CreateSphereIndices<IndexType>(levels, slices); });
+}
+
+template<class IndexType, class Func>
+inline IndexBufferCache::SharedIndexBuffer IndexBufferCache::GetOrCreate(ID3D11Device * device, Topology topology,
+	UINT param0, UINT param1, Func&& generateIndices)
+{
+	static_assert(sizeof(IndexType) == 2 || sizeof(IndexType) == 4, "The size of IndexType must be 2 bytes or 4 bytes!");
+	static_assert(std::is_unsigned<IndexType>::value, "IndexType must be unsigned integer!");
+
+	Key key = { topology, param0, param1, sizeof(IndexType) == 2 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT };
+	if (const SharedIndexBuffer* cached = Find(key))
+		return *cached;
+
+	std::vector<IndexType> indices = generateIndices();
+	return Insert(device, key, indices.data(), (UINT)indices.size());
+}
+
+#endif
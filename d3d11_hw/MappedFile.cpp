@@ -0,0 +1,173 @@
+#include "MappedFile.h"
+#include <utility>
+#include <string>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+	: m_hFile(), m_hMapping(), m_pData(), m_Size()
+{
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+	: m_hFile(other.m_hFile), m_hMapping(other.m_hMapping), m_pData(other.m_pData), m_Size(other.m_Size)
+{
+	other.m_hFile = other.m_hMapping = nullptr;
+	other.m_pData = nullptr;
+	other.m_Size = 0;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this != &other)
+	{
+		Close();
+		std::swap(m_hFile, other.m_hFile);
+		std::swap(m_hMapping, other.m_hMapping);
+		std::swap(m_pData, other.m_pData);
+		std::swap(m_Size, other.m_Size);
+	}
+	return *this;
+}
+
+const char* MappedFile::Discard(const char* beg, const char* end) const
+{
+	if (!m_pData || beg >= end)
+		return beg;
+
+	// 只处理范围内完整的页，首尾不足一页的部分保持不变
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	size_t pageSize = info.dwPageSize;
+#else
+	size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+#endif
+	size_t first = ((size_t)(beg - m_pData) + pageSize - 1) / pageSize * pageSize;
+	size_t last = (size_t)(end - m_pData) / pageSize * pageSize;
+	if (first >= last)
+		return beg;
+
+#ifdef _WIN32
+	// 对未锁定的页调用VirtualUnlock会将其移出工作集，函数本身返回失败，忽略即可
+	VirtualUnlock(const_cast<char*>(m_pData) + first, last - first);
+#else
+	madvise(const_cast<char*>(m_pData) + first, last - first, MADV_DONTNEED);
+#endif
+	return m_pData + last;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const wchar_t* fileName)
+{
+	Close();
+
+	HANDLE hFile = CreateFileW(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+	m_hFile = hFile;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(hFile, &fileSize) || fileSize.QuadPart == 0 || (unsigned long long)fileSize.QuadPart > SIZE_MAX)
+	{
+		Close();
+		return false;
+	}
+
+	m_hMapping = CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!m_hMapping)
+	{
+		Close();
+		return false;
+	}
+
+	m_pData = static_cast<const char*>(MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0));
+	if (!m_pData)
+	{
+		Close();
+		return false;
+	}
+	m_Size = (size_t)fileSize.QuadPart;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (m_pData)
+		UnmapViewOfFile(m_pData);
+	if (m_hMapping)
+		CloseHandle(m_hMapping);
+	if (m_hFile)
+		CloseHandle(m_hFile);
+	m_hFile = m_hMapping = nullptr;
+	m_pData = nullptr;
+	m_Size = 0;
+}
+
+#else
+
+bool MappedFile::Open(const wchar_t* fileName)
+{
+	Close();
+
+	// 以UTF-8编码文件名
+	std::string path;
+	for (const wchar_t* p = fileName; *p; ++p)
+	{
+		unsigned int c = (unsigned int)*p;
+		if (c < 0x80)
+			path.push_back((char)c);
+		else if (c < 0x800)
+			path += { (char)(0xC0 | (c >> 6)), (char)(0x80 | (c & 0x3F)) };
+		else if (c < 0x10000)
+			path += { (char)(0xE0 | (c >> 12)), (char)(0x80 | ((c >> 6) & 0x3F)), (char)(0x80 | (c & 0x3F)) };
+		else
+			path += { (char)(0xF0 | (c >> 18)), (char)(0x80 | ((c >> 12) & 0x3F)),
+				(char)(0x80 | ((c >> 6) & 0x3F)), (char)(0x80 | (c & 0x3F)) };
+	}
+
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size <= 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	void* data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		return false;
+
+	m_pData = static_cast<const char*>(data);
+	m_Size = (size_t)st.st_size;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (m_pData)
+		munmap(const_cast<char*>(m_pData), m_Size);
+	m_hFile = m_hMapping = nullptr;
+	m_pData = nullptr;
+	m_Size = 0;
+}
+
+#endif
@@ -0,0 +1,46 @@
+//***************************************************************************************
+// MappedFile.h
+// Licensed under the MIT License.
+//
+// 只读的内存映射文件
+// Read-only memory-mapped file.
+//***************************************************************************************
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	// 以只读方式映射整个文件，空文件视为失败
+	bool Open(const wchar_t* fileName);
+	void Close();
+
+	// 将[beg, end)内完整的页移出进程的工作集，适合顺序读取时丢弃已读完的部分
+	// 映射是只读的，之后再次访问会重新从文件(或系统缓存)载入，内容不变
+	// 返回已处理到的位置(页边界)，下一次可以从这里继续
+	const char* Discard(const char* beg, const char* end) const;
+
+	bool IsOpen() const { return m_pData != nullptr; }
+	const char* GetData() const { return m_pData; }
+	size_t GetSize() const { return m_Size; }
+
+private:
+	void* m_hFile;			// 文件句柄(仅Windows)
+	void* m_hMapping;		// 文件映射对象句柄(仅Windows)
+	const char* m_pData;
+	size_t m_Size;
+};
+
+#endif
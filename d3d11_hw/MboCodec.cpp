@@ -0,0 +1,171 @@
+#include "MboCodec.h"
+#include <cstddef>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace Mbo
+{
+	void EncodeVertices(const VertexPosNormalTex* vertices, size_t count,
+		const XMFLOAT3& vMin, const XMFLOAT3& vMax, QuantizedVertex* out)
+	{
+		XMVECTOR minVec = XMLoadFloat3(&vMin);
+		XMVECTOR extent = XMVectorSubtract(XMLoadFloat3(&vMax), minVec);
+		// 厚度为0的轴上所有顶点都位于vMin
+		XMVECTOR invExtent = XMVectorSelect(XMVectorReciprocal(extent), g_XMZero,
+			XMVectorLessOrEqual(extent, g_XMZero));
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			const VertexPosNormalTex& vertex = vertices[i];
+			QuantizedVertex& quantized = out[i];
+
+			XMVECTOR pos = XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(&vertex.pos), minVec), invExtent);
+			XMUSHORTN4 pos4;
+			XMStoreUShortN4(&pos4, pos);
+			quantized.pos[0] = pos4.x;
+			quantized.pos[1] = pos4.y;
+			quantized.pos[2] = pos4.z;
+
+			// 将单位球面投影到八面体|x|+|y|+|z|=1上，下半球沿对角线折叠到上半球的外侧
+			const XMFLOAT3& n = vertex.normal;
+			float l1 = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+			float x = l1 > 0.0f ? n.x / l1 : 0.0f;
+			float y = l1 > 0.0f ? n.y / l1 : 0.0f;
+			if (n.z < 0.0f)
+			{
+				float foldX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+				float foldY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+				x = foldX;
+				y = foldY;
+			}
+			XMStoreShortN2(&quantized.normal, XMVectorSet(x, y, 0.0f, 0.0f));
+
+			XMStoreHalf2(&quantized.tex, XMLoadFloat2(&vertex.tex));
+		}
+	}
+
+	void DecodeVertices(const QuantizedVertex* vertices, size_t count,
+		const XMFLOAT3& vMin, const XMFLOAT3& vMax, VertexPosNormalTex* out)
+	{
+		// 位置与法向量按4个顶点一组写入：转置后每个顶点一次写入pos与normal.x，再写入normal.yz
+		static_assert(offsetof(VertexPosNormalTex, normal) == sizeof(XMFLOAT3) &&
+			offsetof(VertexPosNormalTex, tex) == 2 * sizeof(XMFLOAT3), "Unexpected VertexPosNormalTex layout");
+		if (count == 0)
+			return;
+
+		// 纹理坐标整批由半精度转换，不参与分组
+		XMConvertHalfToFloatStream(&out[0].tex.x, sizeof(VertexPosNormalTex), &vertices[0].tex.x, sizeof(QuantizedVertex), count);
+		XMConvertHalfToFloatStream(&out[0].tex.y, sizeof(VertexPosNormalTex), &vertices[0].tex.y, sizeof(QuantizedVertex), count);
+
+		XMVECTOR minVec = XMLoadFloat3(&vMin);
+		XMVECTOR scale = XMVectorScale(XMVectorSubtract(XMLoadFloat3(&vMax), minVec), 1.0f / 65535.0f);
+		XMVECTOR minX = XMVectorSplatX(minVec), minY = XMVectorSplatY(minVec), minZ = XMVectorSplatZ(minVec);
+		XMVECTOR scaleX = XMVectorSplatX(scale), scaleY = XMVectorSplatY(scale), scaleZ = XMVectorSplatZ(scale);
+		XMVECTOR normalScale = XMVectorReplicate(1.0f / 32767.0f);
+		XMVECTOR negOne = XMVectorNegate(g_XMOne);
+
+		for (size_t i = 0; i < count; i += 4)
+		{
+			// 将一组顶点的各分量整理为SoA，每个向量的4个分量分别属于4个顶点，不足4个时以0补齐
+			size_t n = count - i < 4 ? count - i : 4;
+			XMUINT4 px = {}, py = {}, pz = {};
+			XMINT4 nx = {}, ny = {};
+			uint32_t* pxLanes = &px.x;
+			uint32_t* pyLanes = &py.x;
+			uint32_t* pzLanes = &pz.x;
+			int32_t* nxLanes = &nx.x;
+			int32_t* nyLanes = &ny.x;
+			for (size_t j = 0; j < n; ++j)
+			{
+				const QuantizedVertex& quantized = vertices[i + j];
+				pxLanes[j] = quantized.pos[0];
+				pyLanes[j] = quantized.pos[1];
+				pzLanes[j] = quantized.pos[2];
+				nxLanes[j] = quantized.normal.x;
+				nyLanes[j] = quantized.normal.y;
+			}
+
+			XMVECTOR x = XMVectorMultiplyAdd(XMLoadUInt4(&px), scaleX, minX);
+			XMVECTOR y = XMVectorMultiplyAdd(XMLoadUInt4(&py), scaleY, minY);
+			XMVECTOR z = XMVectorMultiplyAdd(XMLoadUInt4(&pz), scaleZ, minZ);
+
+			// SNORM16的-32768与-32767都表示-1
+			// z = 1 - |x| - |y|，z < 0时x -= sign(x) * (-z)，y同理，不需要分支
+			XMVECTOR normalX = XMVectorMax(XMVectorMultiply(XMLoadSInt4(&nx), normalScale), negOne);
+			XMVECTOR normalY = XMVectorMax(XMVectorMultiply(XMLoadSInt4(&ny), normalScale), negOne);
+			XMVECTOR normalZ = XMVectorSubtract(XMVectorSubtract(g_XMOne, XMVectorAbs(normalX)), XMVectorAbs(normalY));
+			XMVECTOR fold = XMVectorMax(XMVectorNegate(normalZ), g_XMZero);
+			normalX = XMVectorAdd(normalX, XMVectorSelect(fold, XMVectorNegate(fold), XMVectorGreaterOrEqual(normalX, g_XMZero)));
+			normalY = XMVectorAdd(normalY, XMVectorSelect(fold, XMVectorNegate(fold), XMVectorGreaterOrEqual(normalY, g_XMZero)));
+			// 八面体上的点满足|x| + |y| + |z| = 1，长度不小于1/sqrt(3)，可以直接取倒数
+			XMVECTOR invLength = XMVectorReciprocalSqrt(XMVectorMultiplyAdd(normalX, normalX,
+				XMVectorMultiplyAdd(normalY, normalY, XMVectorMultiply(normalZ, normalZ))));
+			normalX = XMVectorMultiply(normalX, invLength);
+			normalY = XMVectorMultiply(normalY, invLength);
+			normalZ = XMVectorMultiply(normalZ, invLength);
+
+			// 转置后第j行为第j个顶点的(pos.x, pos.y, pos.z, normal.x)与(normal.y, normal.z, 0, 0)
+			XMMATRIX posNormalX = XMMatrixTranspose(XMMATRIX(x, y, z, normalX));
+			XMMATRIX normalYZ = XMMatrixTranspose(XMMATRIX(normalY, normalZ, g_XMZero, g_XMZero));
+			for (size_t j = 0; j < n; ++j)
+			{
+				VertexPosNormalTex& vertex = out[i + j];
+				XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&vertex.pos), posNormalX.r[j]);
+				XMStoreFloat2(reinterpret_cast<XMFLOAT2*>(&vertex.normal.y), normalYZ.r[j]);
+			}
+		}
+	}
+
+	void EncodeIndices(const void* indices, size_t count, uint32_t indexSize, std::vector<uint8_t>& out)
+	{
+		uint32_t prev = 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			uint32_t index = indexSize == sizeof(uint32_t) ?
+				static_cast<const uint32_t*>(indices)[i] : static_cast<const uint16_t*>(indices)[i];
+			uint32_t delta = index - prev;
+			uint32_t value = (delta << 1) ^ (0u - (delta >> 31));
+			prev = index;
+
+			while (value >= 0x80)
+			{
+				out.push_back((uint8_t)(value | 0x80));
+				value >>= 7;
+			}
+			out.push_back((uint8_t)value);
+		}
+	}
+
+	bool DecodeIndices(const uint8_t* data, size_t size, size_t count, uint32_t indexSize, void* out)
+	{
+		const uint8_t* p = data;
+		const uint8_t* end = data + size;
+		const uint32_t maxIndex = indexSize == sizeof(uint32_t) ? 0xFFFFFFFF : 0xFFFF;
+		uint32_t prev = 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			uint32_t value = 0;
+			for (uint32_t shift = 0; ; shift += 7)
+			{
+				// 32位的值最多占用5个字节
+				if (p == end || shift > 28)
+					return false;
+				uint8_t byte = *p++;
+				value |= (uint32_t)(byte & 0x7F) << shift;
+				if (byte < 0x80)
+					break;
+			}
+
+			uint32_t index = prev + ((value >> 1) ^ (0u - (value & 1)));
+			if (index > maxIndex)
+				return false;
+			if (indexSize == sizeof(uint32_t))
+				static_cast<uint32_t*>(out)[i] = index;
+			else
+				static_cast<uint16_t*>(out)[i] = (uint16_t)index;
+			prev = index;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,32 @@
+//***************************************************************************************
+// MboCodec.h
+// Licensed under the MIT License.
+//
+// .mbo顶点与索引数据的量化、压缩编码
+// Quantization and compression of .mbo vertex and index streams.
+//***************************************************************************************
+
+#ifndef MBOCODEC_H
+#define MBOCODEC_H
+
+#include <vector>
+#include "MboFormat.h"
+#include "Vertex.h"
+
+namespace Mbo
+{
+	// 位置按AABB盒[vMin, vMax]量化为3个16位整数，法向量八面体映射为2个16位整数，纹理坐标使用半精度浮点
+	void EncodeVertices(const VertexPosNormalTex* vertices, size_t count,
+		const DirectX::XMFLOAT3& vMin, const DirectX::XMFLOAT3& vMax, QuantizedVertex* out);
+	// 每4个顶点一组，以SoA形式使用DirectXMath的向量运算还原，纹理坐标整批转换；vMin与vMax需要与编码时相同
+	void DecodeVertices(const QuantizedVertex* vertices, size_t count,
+		const DirectX::XMFLOAT3& vMin, const DirectX::XMFLOAT3& vMax, VertexPosNormalTex* out);
+
+	// 索引与前一个索引作差，经zigzag映射为无符号数后以varint(每字节7位)追加到out
+	// 三角形的索引通常相距不远，大部分索引只需要1个字节
+	void EncodeIndices(const void* indices, size_t count, uint32_t indexSize, std::vector<uint8_t>& out);
+	// 从[data, data + size)中解码count个索引，数据不足或索引超出indexSize的表示范围时返回false
+	bool DecodeIndices(const uint8_t* data, size_t size, size_t count, uint32_t indexSize, void* out);
+}
+
+#endif
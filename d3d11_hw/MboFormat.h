@@ -0,0 +1,153 @@
+//***************************************************************************************
+// MboFormat.h
+// Licensed under the MIT License.
+//
+// .mbo模型二进制文件的磁盘格式定义
+// On-disk layout of the .mbo binary model format.
+//***************************************************************************************
+
+#ifndef MBOFORMAT_H
+#define MBOFORMAT_H
+
+#include <cstdint>
+#include <DirectXPackedVector.h>
+#include "LightHelper.h"
+
+namespace Mbo
+{
+	//
+	// v2文件布局(小端序)：
+	// [FileHeader]
+	// [SectionEntry] * sectionCount
+	// [各节数据]，每节及每个部分的顶点/索引数据的起始位置均按kAlignment对齐
+	//
+	// 各部分的顶点与索引数据在文件中是连续、已对齐的数组，
+	// 可以不经逐字段解析直接作为缓冲区的初始数据使用
+	//
+	// v1文件没有文件头，以4字节的部分数目开头，读取时通过魔数区分
+	//
+	// 部分可以选择压缩编码(见PartEncoding)，此时对应数据需要解码后才能创建缓冲区
+	//
+	// 部分的LOD链记录在可选的LOD节中，各级索引引用所属部分的顶点(LOD使用的顶点追加在部分顶点的末尾)，
+	// 索引数据紧随所属部分的索引之后，宽度与编码方式与所属部分相同；未压缩时中间没有填充，
+	// 原始网格与各级LOD的索引构成一段连续的数组，可以整段作为索引缓冲区的初始数据；
+	// 不认识LOD节的读取器只会使用原始网格
+	//
+	// 原始网格的三角形可以按簇(meshlet)排列，可选的簇节记录每簇在所属部分索引中的连续范围、
+	// 包围球与法线锥，用于在CPU端剔除视锥外或整体背向观察者的簇；簇不包含额外的索引数据
+	//
+	// 可选的包围体节按部分顺序记录每个部分的包围盒与包围球，没有该节的文件在读取时由顶点计算
+	//
+
+	static const uint32_t kMagic = 0x324F424D;			// "MBO2"
+	static const uint32_t kVersion = 2;
+	static const uint32_t kAlignment = 16;
+	static const uint32_t kNoString = 0xFFFFFFFF;
+
+	enum SectionType : uint32_t
+	{
+		SectionParts = 1,		// PartDesc数组
+		SectionStrings = 2,		// 字符串表，以'\0'结尾的UTF-8字符串紧密排列，相同的字符串只存一份
+		SectionVertices = 3,	// 所有部分的顶点数据
+		SectionIndices = 4,		// 所有部分的索引数据
+		SectionSource = 5,		// SourceInfo，可选，由MboCache写入
+		SectionLods = 6,		// LodDesc数组，可选，同一部分的LOD由细到粗排列
+		SectionMeshlets = 7,	// MeshletDesc数组，可选，同一部分的簇按索引顺序排列
+		SectionBounds = 8,		// BoundsDesc数组，可选，与PartDesc一一对应
+	};
+
+	// PartDesc::encoding的标志位，0表示原始数据
+	enum PartEncoding : uint32_t
+	{
+		EncodingQuantizedVertices = 0x1,	// 顶点为QuantizedVertex，位置相对于文件头中的AABB盒
+		EncodingVarintIndices = 0x2,		// 索引为与前一索引之差经zigzag映射后的varint序列
+	};
+
+	struct FileHeader
+	{
+		uint32_t magic;					// kMagic
+		uint32_t version;				// kVersion
+		uint32_t headerSize;			// sizeof(FileHeader)
+		uint32_t sectionCount;			// 紧随文件头的SectionEntry数目
+		DirectX::XMFLOAT3 vMin;			// AABB盒顶点
+		DirectX::XMFLOAT3 vMax;
+		uint64_t fileSize;				// 文件总字节数，用于检测截断
+	};
+
+	struct SectionEntry
+	{
+		uint32_t type;					// SectionType
+		uint32_t flags;					// 保留
+		uint64_t offset;				// 从文件开头算起的字节偏移
+		uint64_t size;					// 字节数
+	};
+
+	struct PartDesc
+	{
+		Material material;
+		uint32_t texDiffuse;			// 漫射光纹理文件名在字符串表中的偏移，kNoString表示没有
+		uint32_t vertexCount;
+		uint32_t vertexStride;			// 顶点字节数，sizeof(VertexPosNormalTex)或sizeof(QuantizedVertex)
+		uint32_t indexCount;
+		uint32_t indexSize;				// 解码后的索引字节数，2或4，与顶点数无关
+		uint32_t encoding;				// PartEncoding的组合，旧文件中为0
+		uint64_t vertexOffset;			// 从文件开头算起的字节偏移
+		uint64_t indexOffset;
+	};
+
+	struct LodDesc
+	{
+		uint32_t partIndex;				// 所属部分在PartDesc数组中的位置
+		uint32_t indexCount;
+		uint64_t indexOffset;			// 从文件开头算起的字节偏移
+		float error;					// 相对原始网格的近似最大偏差(模型空间)
+		uint32_t reserved;
+	};
+
+	struct MeshletDesc
+	{
+		uint32_t partIndex;				// 所属部分在PartDesc数组中的位置
+		uint32_t startIndex;			// 在所属部分(解码后的)索引中的起始位置
+		uint32_t indexCount;
+		uint32_t reserved;
+		DirectX::XMFLOAT3 center;		// 包围球(模型空间)
+		float radius;
+		DirectX::XMFLOAT3 coneAxis;		// 法线锥的单位轴向
+		float coneCutoff;				// 各三角形法向量与轴向夹角余弦的最小值，不大于0表示无法剔除
+	};
+
+	struct BoundsDesc
+	{
+		DirectX::XMFLOAT3 vMin;			// AABB盒顶点(模型空间)，已包含量化误差
+		DirectX::XMFLOAT3 vMax;
+		DirectX::XMFLOAT3 center;		// 包围球
+		float radius;
+	};
+
+	// 生成该文件的源数据信息
+	struct SourceInfo
+	{
+		uint64_t contentHash;			// .obj及其引用的.mtl文件的内容哈希(已混入导入器版本)
+		uint32_t importerVersion;
+		uint32_t reserved;
+	};
+
+	// 量化后的顶点，14字节，各字段按2字节对齐
+	struct QuantizedVertex
+	{
+		uint16_t pos[3];							// 在AABB盒内的归一化位置(UNORM16)
+		DirectX::PackedVector::XMSHORTN2 normal;	// 八面体映射后的单位法向量
+		DirectX::PackedVector::XMHALF2 tex;
+	};
+
+	static_assert(sizeof(FileHeader) == 48, "Unexpected Mbo::FileHeader size");
+	static_assert(sizeof(SectionEntry) == 24, "Unexpected Mbo::SectionEntry size");
+	static_assert(sizeof(PartDesc) == 104, "Unexpected Mbo::PartDesc size");
+	static_assert(sizeof(LodDesc) == 24, "Unexpected Mbo::LodDesc size");
+	static_assert(sizeof(MeshletDesc) == 48, "Unexpected Mbo::MeshletDesc size");
+	static_assert(sizeof(BoundsDesc) == 40, "Unexpected Mbo::BoundsDesc size");
+	static_assert(sizeof(SourceInfo) == 16, "Unexpected Mbo::SourceInfo size");
+	static_assert(sizeof(QuantizedVertex) == 14, "Unexpected Mbo::QuantizedVertex size");
+}
+
+#endif
@@ -0,0 +1,1496 @@
+#include "MeshOptimizer.h"
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <queue>
+#include <unordered_map>
+
+using namespace DirectX;
+
+namespace
+{
+	template<class IndexType>
+	MeshOptimizer::VertexCacheStats AnalyzeVertexCacheImpl(const IndexType* indices, size_t indexCount,
+		size_t vertexCount, UINT cacheSize)
+	{
+		// 顶点的时间戳为其进入缓存时的变换计数，计数与时间戳之差小于缓存大小即为命中
+		// 计数从cacheSize开始，使初始时间戳为0的顶点都不在缓存中
+		std::vector<size_t> timestamps(vertexCount, 0);
+		size_t time = cacheSize;
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			IndexType v = indices[i];
+			if (v < vertexCount && time - timestamps[v] >= cacheSize)
+				timestamps[v] = ++time;
+		}
+
+		size_t transformCount = time - cacheSize;
+		MeshOptimizer::VertexCacheStats stats;
+		stats.acmr = indexCount >= 3 ? (float)transformCount / (indexCount / 3) : 0.0f;
+		stats.atvr = vertexCount ? (float)transformCount / vertexCount : 0.0f;
+		return stats;
+	}
+
+	template<class IndexType>
+	void OptimizeVertexCacheImpl(IndexType* indices, size_t indexCount, size_t vertexCount, UINT cacheSize)
+	{
+		size_t triangleCount = indexCount / 3;
+		if (triangleCount == 0 || vertexCount == 0)
+			return;
+
+		// 顶点到三角形的邻接表(CSR形式)，liveCounts为每个顶点尚未输出的三角形数目
+		std::vector<UINT> liveCounts(vertexCount, 0);
+		for (size_t i = 0; i < triangleCount * 3; ++i)
+			++liveCounts[indices[i]];
+		std::vector<UINT> offsets(vertexCount + 1, 0);
+		for (size_t v = 0; v < vertexCount; ++v)
+			offsets[v + 1] = offsets[v] + liveCounts[v];
+		std::vector<UINT> adjacency(offsets[vertexCount]);
+		{
+			std::vector<UINT> cursor(offsets.begin(), offsets.end() - 1);
+			for (size_t t = 0; t < triangleCount; ++t)
+				for (int j = 0; j < 3; ++j)
+					adjacency[cursor[indices[t * 3 + j]]++] = (UINT)t;
+		}
+
+		std::vector<size_t> timestamps(vertexCount, 0);
+		std::vector<bool> emitted(triangleCount, false);
+		std::vector<UINT> deadEnd;			// 最近使用过的顶点，用于在走入死角时回退
+		std::vector<UINT> candidates;
+		std::vector<IndexType> result;
+		result.reserve(triangleCount * 3);
+
+		size_t time = cacheSize + 1;
+		size_t cursor = 0;					// 按输入顺序寻找仍有剩余三角形的顶点
+		long long fanning = 0;
+		while (fanning >= 0)
+		{
+			// 输出当前顶点周围所有未输出的三角形
+			candidates.clear();
+			for (UINT k = offsets[(size_t)fanning]; k < offsets[(size_t)fanning + 1]; ++k)
+			{
+				UINT t = adjacency[k];
+				if (emitted[t])
+					continue;
+				for (int j = 0; j < 3; ++j)
+				{
+					IndexType v = indices[t * 3 + j];
+					result.push_back(v);
+					deadEnd.push_back((UINT)v);
+					candidates.push_back((UINT)v);
+					--liveCounts[v];
+					if (time - timestamps[v] > cacheSize)
+						timestamps[v] = time++;
+				}
+				emitted[t] = true;
+			}
+
+			// 在候选顶点中选择仍在缓存中、且剩余三角形能在被移出前输出完的最旧顶点
+			fanning = -1;
+			long long bestPriority = -1;
+			for (UINT v : candidates)
+			{
+				if (liveCounts[v] == 0)
+					continue;
+				long long priority = 0;
+				if (time - timestamps[v] + 2 * liveCounts[v] <= cacheSize)
+					priority = (long long)(time - timestamps[v]);
+				if (priority > bestPriority)
+				{
+					bestPriority = priority;
+					fanning = v;
+				}
+			}
+
+			// 没有合适的候选时，先从最近使用过的顶点中回退，再按输入顺序继续
+			while (fanning < 0 && !deadEnd.empty())
+			{
+				UINT v = deadEnd.back();
+				deadEnd.pop_back();
+				if (liveCounts[v] > 0)
+					fanning = v;
+			}
+			for (; fanning < 0 && cursor < vertexCount; ++cursor)
+			{
+				if (liveCounts[cursor] > 0)
+					fanning = (long long)cursor;
+			}
+		}
+
+		std::copy(result.begin(), result.end(), indices);
+	}
+
+	template<class IndexType>
+	void OptimizeVertexFetchImpl(std::vector<VertexPosNormalTex>& vertices, IndexType* indices, size_t indexCount)
+	{
+		const IndexType kUnused = (IndexType)~(IndexType)0;
+		std::vector<IndexType> remap(vertices.size(), kUnused);
+		std::vector<VertexPosNormalTex> result;
+		result.reserve(vertices.size());
+
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			IndexType& v = remap[indices[i]];
+			if (v == kUnused)
+			{
+				v = (IndexType)result.size();
+				result.push_back(vertices[indices[i]]);
+			}
+			indices[i] = v;
+		}
+
+		vertices.swap(result);
+	}
+
+	template<class IndexType>
+	void OptimizePartImpl(std::vector<VertexPosNormalTex>& vertices, std::vector<IndexType>& indices,
+		std::vector<ObjReader::ObjLod>& lods, std::vector<IndexType> ObjReader::ObjLod::* lodIndices,
+		const std::vector<ObjReader::ObjMeshlet>& meshlets,
+		MeshOptimizer::VertexCacheStats* before, MeshOptimizer::VertexCacheStats* after)
+	{
+		if (before)
+			*before = MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), vertices.size());
+		if (meshlets.empty())
+		{
+			MeshOptimizer::OptimizeVertexCache(indices.data(), indices.size(), vertices.size());
+		}
+		else
+		{
+			// 三角形只能在所属的簇内移动
+			// 每簇先按首次出现的顺序映射为局部顶点编号再优化，开销只与簇的大小有关，与整个网格的顶点数无关
+			const DWORD kUnmapped = UINT_MAX;
+			std::vector<DWORD> localOf(vertices.size(), kUnmapped);
+			std::vector<IndexType> globalOf;
+			std::vector<DWORD> localIndices;
+			for (const auto& meshlet : meshlets)
+			{
+				IndexType* meshletIndices = indices.data() + meshlet.startIndex;
+				globalOf.clear();
+				localIndices.resize(meshlet.indexCount);
+				for (UINT i = 0; i < meshlet.indexCount; ++i)
+				{
+					DWORD& local = localOf[meshletIndices[i]];
+					if (local == kUnmapped)
+					{
+						local = (DWORD)globalOf.size();
+						globalOf.push_back(meshletIndices[i]);
+					}
+					localIndices[i] = local;
+				}
+				MeshOptimizer::OptimizeVertexCache(localIndices.data(), localIndices.size(), globalOf.size());
+				for (UINT i = 0; i < meshlet.indexCount; ++i)
+					meshletIndices[i] = globalOf[localIndices[i]];
+				for (IndexType v : globalOf)
+					localOf[v] = kUnmapped;
+			}
+		}
+		if (lods.empty())
+		{
+			MeshOptimizer::OptimizeVertexFetch(vertices, indices.data(), indices.size());
+		}
+		else
+		{
+			// 各级LOD共用顶点，拼接后一起重排，原始网格在前，使其引用的顶点排在最前面
+			std::vector<IndexType> combined(indices);
+			for (auto& lod : lods)
+			{
+				std::vector<IndexType>& lodIndexArray = lod.*lodIndices;
+				MeshOptimizer::OptimizeVertexCache(lodIndexArray.data(), lodIndexArray.size(), vertices.size());
+				combined.insert(combined.end(), lodIndexArray.begin(), lodIndexArray.end());
+			}
+			MeshOptimizer::OptimizeVertexFetch(vertices, combined.data(), combined.size());
+
+			auto it = combined.begin();
+			std::copy(it, it + indices.size(), indices.begin());
+			it += indices.size();
+			for (auto& lod : lods)
+			{
+				std::vector<IndexType>& lodIndexArray = lod.*lodIndices;
+				std::copy(it, it + lodIndexArray.size(), lodIndexArray.begin());
+				it += lodIndexArray.size();
+			}
+		}
+		if (after)
+			*after = MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), vertices.size());
+	}
+
+	//
+	// 二次误差度量的网格简化
+	//
+
+	// 以对称4x4矩阵表示的平面距离平方之和，weight为累计的权重(面积)
+	struct Quadric
+	{
+		double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+		double weight;
+	};
+
+	struct Vector3d
+	{
+		double x, y, z;
+	};
+
+	inline Vector3d ToVector3d(const XMFLOAT3& v)
+	{
+		return { v.x, v.y, v.z };
+	}
+
+	inline Vector3d Subtract(const Vector3d& a, const Vector3d& b)
+	{
+		return { a.x - b.x, a.y - b.y, a.z - b.z };
+	}
+
+	inline Vector3d Cross(const Vector3d& a, const Vector3d& b)
+	{
+		return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+	}
+
+	inline double Dot(const Vector3d& a, const Vector3d& b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	inline Vector3d MultiplyAdd(const Vector3d& a, const Vector3d& b, double s)
+	{
+		return { a.x + b.x * s, a.y + b.y * s, a.z + b.z * s };
+	}
+
+	// 点p到三角形abc的距离平方(Ericson, Real-Time Collision Detection 5.1.5)
+	double PointTriangleDistanceSq(const Vector3d& p, const Vector3d& a, const Vector3d& b, const Vector3d& c)
+	{
+		auto distanceSq = [&p](const Vector3d& q) { Vector3d d = Subtract(p, q); return Dot(d, d); };
+		Vector3d ab = Subtract(b, a), ac = Subtract(c, a), ap = Subtract(p, a);
+		double d1 = Dot(ab, ap), d2 = Dot(ac, ap);
+		if (d1 <= 0.0 && d2 <= 0.0)
+			return distanceSq(a);
+		Vector3d bp = Subtract(p, b);
+		double d3 = Dot(ab, bp), d4 = Dot(ac, bp);
+		if (d3 >= 0.0 && d4 <= d3)
+			return distanceSq(b);
+		double vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+			return distanceSq(MultiplyAdd(a, ab, d1 / (d1 - d3)));
+		Vector3d cp = Subtract(p, c);
+		double d5 = Dot(ab, cp), d6 = Dot(ac, cp);
+		if (d6 >= 0.0 && d5 <= d6)
+			return distanceSq(c);
+		double vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+			return distanceSq(MultiplyAdd(a, ac, d2 / (d2 - d6)));
+		double va = d3 * d6 - d5 * d4;
+		if (va <= 0.0 && d4 - d3 >= 0.0 && d5 - d6 >= 0.0)
+			return distanceSq(MultiplyAdd(b, Subtract(c, b), (d4 - d3) / ((d4 - d3) + (d5 - d6))));
+		double denom = va + vb + vc;
+		if (denom <= 0.0)
+			return distanceSq(a);
+		return distanceSq(MultiplyAdd(MultiplyAdd(a, ab, vb / denom), ac, vc / denom));
+	}
+
+	// 累加平面n·p + d = 0的二次误差，n需为单位向量
+	void AddPlane(Quadric& q, const Vector3d& n, double d, double weight)
+	{
+		q.a2 += n.x * n.x * weight;
+		q.ab += n.x * n.y * weight;
+		q.ac += n.x * n.z * weight;
+		q.ad += n.x * d * weight;
+		q.b2 += n.y * n.y * weight;
+		q.bc += n.y * n.z * weight;
+		q.bd += n.y * d * weight;
+		q.c2 += n.z * n.z * weight;
+		q.cd += n.z * d * weight;
+		q.d2 += d * d * weight;
+		q.weight += weight;
+	}
+
+	void AddQuadric(Quadric& q, const Quadric& r)
+	{
+		q.a2 += r.a2; q.ab += r.ab; q.ac += r.ac; q.ad += r.ad;
+		q.b2 += r.b2; q.bc += r.bc; q.bd += r.bd;
+		q.c2 += r.c2; q.cd += r.cd; q.d2 += r.d2;
+		q.weight += r.weight;
+	}
+
+	// 点到各平面距离平方的加权平均
+	double QuadricError(const Quadric& q, const Vector3d& p)
+	{
+		double e = q.a2 * p.x * p.x + q.b2 * p.y * p.y + q.c2 * p.z * p.z +
+			2.0 * (q.ab * p.x * p.y + q.ac * p.x * p.z + q.bc * p.y * p.z) +
+			2.0 * (q.ad * p.x + q.bd * p.y + q.cd * p.z) + q.d2;
+		return q.weight > 0.0 ? std::fabs(e) / q.weight : 0.0;
+	}
+
+	// 按位比较的顶点键，位置键的纹理坐标部分为0
+	struct WeldKey
+	{
+		uint32_t bits[5];
+
+		bool operator==(const WeldKey& other) const
+		{
+			return memcmp(bits, other.bits, sizeof(bits)) == 0;
+		}
+	};
+
+	struct WeldKeyHash
+	{
+		size_t operator()(const WeldKey& key) const
+		{
+			// FNV-1a
+			uint64_t h = 14695981039346656037ull;
+			for (uint32_t b : key.bits)
+				h = (h ^ b) * 1099511628211ull;
+			return (size_t)h;
+		}
+	};
+
+	inline uint32_t FloatBits(float f)
+	{
+		// 加0.0f使-0.0f与0.0f得到相同的键
+		f += 0.0f;
+		uint32_t bits;
+		memcpy(&bits, &f, sizeof(bits));
+		return bits;
+	}
+
+	// 半边折叠简化：位置u折叠到相邻的位置v，v保持不动，因此不产生新的位置与纹理坐标
+	// 折叠以位置为单位进行，位置上的每个焊接顶点(wedge)映射到v上与之共边的wedge，
+	// 找不到唯一对应时(如折叠方向穿过UV接缝)折叠不合法，由此保证接缝不被破坏
+	class QuadricSimplifier
+	{
+	public:
+		// 位置与纹理坐标都相同的原始顶点焊接为一个wedge
+		struct Wedge
+		{
+			UINT position;
+			UINT source;				// 第一个焊接到此的原始顶点
+			XMFLOAT3 normalSum;
+			bool uniformNormal;			// 焊接到此的原始顶点法向量全部相同
+		};
+
+		QuadricSimplifier(const std::vector<VertexPosNormalTex>& vertices, const DWORD* indices, size_t indexCount);
+
+		// 按误差从小到大执行合法的折叠，直到三角形数不超过targetCount或无法继续
+		void Simplify(size_t targetCount);
+		size_t GetTriangleCount() const { return m_TriangleCount; }
+		// 被折叠掉的位置到其最终所在位置两环邻域内三角形的最大距离，作为相对原始网格偏差的保守估计
+		float ComputeError();
+		// 输出当前网格，索引为wedge编号
+		void GetTriangles(std::vector<UINT>& wedgeIndices) const;
+		const std::vector<Wedge>& GetWedges() const { return m_Wedges; }
+
+	private:
+		struct Collapse
+		{
+			double cost;
+			UINT from, to;
+			UINT fromVersion, toVersion;
+
+			bool operator>(const Collapse& other) const
+			{
+				if (cost != other.cost)
+					return cost > other.cost;
+				return from != other.from ? from > other.from : to > other.to;
+			}
+		};
+
+		UINT CornerPosition(UINT t, int j) const { return m_Wedges[m_Triangles[t * 3 + j]].position; }
+		bool HasPosition(UINT t, UINT p) const
+		{
+			return CornerPosition(t, 0) == p || CornerPosition(t, 1) == p || CornerPosition(t, 2) == p;
+		}
+		// 收集位置p周围仍存活的三角形中的其他位置(去重)
+		void GatherNeighbors(UINT p, std::vector<UINT>& neighbors) const;
+
+		void PushCollapse(UINT from, UINT to);
+		void PushCollapses(UINT p);
+		bool TryCollapse(const Collapse& collapse);
+
+		std::vector<Wedge> m_Wedges;
+		std::vector<Vector3d> m_Positions;
+		std::vector<Quadric> m_Quadrics;
+		std::vector<std::vector<UINT>> m_PositionTriangles;	// 位置到三角形的邻接表，可能含已删除的三角形
+		std::vector<UINT> m_Versions;						// 位置的二次误差或邻域改变时递增，用于丢弃过期的折叠
+		std::vector<uint8_t> m_Alive, m_Border, m_Locked;
+		std::vector<UINT> m_Triangles;						// 每三个wedge编号构成一个三角形
+		std::vector<uint8_t> m_TriangleAlive;
+		std::vector<UINT> m_CollapsedTo;					// 位置被折叠到的位置，存活的位置指向自身
+		size_t m_TriangleCount;
+		// 新产生的折叠先放入m_Deferred，直到队列中的代价超过其中的最小代价时才并入队列，
+		// 使代价相同的折叠按原有顺序执行，避免平坦区域沿同一方向连续折叠到少数位置上
+		std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> m_Queue;
+		std::vector<Collapse> m_Deferred;
+		double m_DeferredMinCost;
+
+		// TryCollapse使用的临时数组
+		std::vector<UINT> m_Shared, m_Moved, m_NeighborsFrom, m_NeighborsTo, m_Opposite;
+		std::vector<std::pair<UINT, UINT>> m_WedgeMap;
+	};
+
+	QuadricSimplifier::QuadricSimplifier(const std::vector<VertexPosNormalTex>& vertices, const DWORD* indices, size_t indexCount)
+		: m_TriangleCount(), m_DeferredMinCost(DBL_MAX)
+	{
+		// 焊接顶点
+		std::unordered_map<WeldKey, UINT, WeldKeyHash> wedgeLookup, positionLookup;
+		std::vector<UINT> wedgeOf(vertices.size());
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			const VertexPosNormalTex& vertex = vertices[i];
+			WeldKey key = { { FloatBits(vertex.pos.x), FloatBits(vertex.pos.y), FloatBits(vertex.pos.z),
+				FloatBits(vertex.tex.x), FloatBits(vertex.tex.y) } };
+			auto result = wedgeLookup.emplace(key, (UINT)m_Wedges.size());
+			wedgeOf[i] = result.first->second;
+			if (!result.second)
+			{
+				Wedge& wedge = m_Wedges[wedgeOf[i]];
+				const XMFLOAT3& normal = vertices[wedge.source].normal;
+				wedge.normalSum.x += vertex.normal.x;
+				wedge.normalSum.y += vertex.normal.y;
+				wedge.normalSum.z += vertex.normal.z;
+				if (memcmp(&normal, &vertex.normal, sizeof(normal)) != 0)
+					wedge.uniformNormal = false;
+				continue;
+			}
+
+			key.bits[3] = key.bits[4] = 0;
+			auto position = positionLookup.emplace(key, (UINT)m_Positions.size());
+			if (position.second)
+				m_Positions.push_back(ToVector3d(vertex.pos));
+			m_Wedges.push_back({ position.first->second, (UINT)i, vertex.normal, true });
+		}
+
+		size_t positionCount = m_Positions.size();
+		m_Quadrics.assign(positionCount, Quadric());
+		m_PositionTriangles.resize(positionCount);
+		m_Versions.assign(positionCount, 0);
+		m_Alive.assign(positionCount, 1);
+		m_Border.assign(positionCount, 0);
+		m_Locked.assign(positionCount, 0);
+		m_CollapsedTo.resize(positionCount);
+		for (UINT p = 0; p < positionCount; ++p)
+			m_CollapsedTo[p] = p;
+
+		// 去掉位置重合的退化三角形，累加各面的二次误差
+		// 以位置对为键统计每条边相邻的三角形数目，并记录其中一个三角形
+		std::unordered_map<uint64_t, std::pair<UINT, UINT>> edges;
+		m_Triangles.reserve(indexCount);
+		for (size_t i = 0; i + 2 < indexCount; i += 3)
+		{
+			UINT w[3] = { wedgeOf[indices[i]], wedgeOf[indices[i + 1]], wedgeOf[indices[i + 2]] };
+			UINT p[3] = { m_Wedges[w[0]].position, m_Wedges[w[1]].position, m_Wedges[w[2]].position };
+			if (p[0] == p[1] || p[1] == p[2] || p[2] == p[0])
+				continue;
+
+			UINT t = (UINT)(m_Triangles.size() / 3);
+			m_Triangles.insert(m_Triangles.end(), w, w + 3);
+			Vector3d normal = Cross(Subtract(m_Positions[p[1]], m_Positions[p[0]]), Subtract(m_Positions[p[2]], m_Positions[p[0]]));
+			double length = std::sqrt(Dot(normal, normal));
+			for (int j = 0; j < 3; ++j)
+			{
+				m_PositionTriangles[p[j]].push_back(t);
+				if (length > 0.0)
+				{
+					Vector3d n = { normal.x / length, normal.y / length, normal.z / length };
+					AddPlane(m_Quadrics[p[j]], n, -Dot(n, m_Positions[p[0]]), length * 0.5);
+				}
+				UINT a = std::min(p[j], p[(j + 1) % 3]), b = std::max(p[j], p[(j + 1) % 3]);
+				auto& edge = edges[(uint64_t)a << 32 | b];
+				if (edge.first++ == 0)
+					edge.second = t;
+			}
+		}
+		m_TriangleCount = m_Triangles.size() / 3;
+		m_TriangleAlive.assign(m_TriangleCount, 1);
+
+		// 边界边加入垂直于所在面的平面，使边界的形状得以保持；非流形边的两端不参与折叠
+		const double kBorderWeight = 10.0;
+		for (auto& edge : edges)
+		{
+			UINT a = (UINT)(edge.first >> 32), b = (UINT)(edge.first & 0xFFFFFFFF);
+			if (edge.second.first > 2)
+			{
+				m_Locked[a] = m_Locked[b] = 1;
+				continue;
+			}
+			if (edge.second.first != 1)
+				continue;
+			m_Border[a] = m_Border[b] = 1;
+
+			UINT t = edge.second.second;
+			Vector3d faceNormal = Cross(Subtract(m_Positions[CornerPosition(t, 1)], m_Positions[CornerPosition(t, 0)]),
+				Subtract(m_Positions[CornerPosition(t, 2)], m_Positions[CornerPosition(t, 0)]));
+			Vector3d e = Subtract(m_Positions[b], m_Positions[a]);
+			Vector3d n = Cross(e, faceNormal);
+			double length = std::sqrt(Dot(n, n));
+			if (length <= 0.0)
+				continue;
+			n = { n.x / length, n.y / length, n.z / length };
+			double weight = Dot(e, e) * kBorderWeight;
+			AddPlane(m_Quadrics[a], n, -Dot(n, m_Positions[a]), weight);
+			AddPlane(m_Quadrics[b], n, -Dot(n, m_Positions[a]), weight);
+		}
+
+		for (UINT t = 0; t < m_TriangleCount; ++t)
+		{
+			for (int j = 0; j < 3; ++j)
+			{
+				UINT a = CornerPosition(t, j), b = CornerPosition(t, (j + 1) % 3);
+				PushCollapse(a, b);
+				PushCollapse(b, a);
+			}
+		}
+	}
+
+	void QuadricSimplifier::Simplify(size_t targetCount)
+	{
+		while (m_TriangleCount > targetCount)
+		{
+			if (!m_Deferred.empty() && (m_Queue.empty() || m_Queue.top().cost > m_DeferredMinCost))
+			{
+				for (const Collapse& collapse : m_Deferred)
+					m_Queue.push(collapse);
+				m_Deferred.clear();
+				m_DeferredMinCost = DBL_MAX;
+			}
+			if (m_Queue.empty())
+				break;
+			Collapse collapse = m_Queue.top();
+			m_Queue.pop();
+			TryCollapse(collapse);
+		}
+	}
+
+	float QuadricSimplifier::ComputeError()
+	{
+		double maxErrorSq = 0.0;
+		for (UINT p = 0; p < (UINT)m_Positions.size(); ++p)
+		{
+			if (m_Alive[p])
+				continue;
+			// 沿折叠链找到存活的位置，并压缩路径
+			UINT r = m_CollapsedTo[p];
+			while (!m_Alive[r])
+				r = m_CollapsedTo[r];
+			m_CollapsedTo[p] = r;
+
+			double errorSq = DBL_MAX;
+			auto measure = [this, p, &errorSq](UINT q)
+			{
+				for (UINT t : m_PositionTriangles[q])
+				{
+					if (m_TriangleAlive[t])
+					{
+						errorSq = std::min(errorSq, PointTriangleDistanceSq(m_Positions[p], m_Positions[CornerPosition(t, 0)],
+							m_Positions[CornerPosition(t, 1)], m_Positions[CornerPosition(t, 2)]));
+					}
+				}
+			};
+			measure(r);
+			GatherNeighbors(r, m_NeighborsTo);
+			for (UINT q : m_NeighborsTo)
+				measure(q);
+			if (errorSq != DBL_MAX)
+				maxErrorSq = std::max(maxErrorSq, errorSq);
+		}
+		return (float)std::sqrt(maxErrorSq);
+	}
+
+	void QuadricSimplifier::GetTriangles(std::vector<UINT>& wedgeIndices) const
+	{
+		wedgeIndices.clear();
+		wedgeIndices.reserve(m_TriangleCount * 3);
+		for (size_t t = 0; t < m_TriangleAlive.size(); ++t)
+		{
+			if (m_TriangleAlive[t])
+				wedgeIndices.insert(wedgeIndices.end(), m_Triangles.begin() + t * 3, m_Triangles.begin() + t * 3 + 3);
+		}
+	}
+
+	void QuadricSimplifier::GatherNeighbors(UINT p, std::vector<UINT>& neighbors) const
+	{
+		neighbors.clear();
+		for (UINT t : m_PositionTriangles[p])
+		{
+			if (!m_TriangleAlive[t])
+				continue;
+			for (int j = 0; j < 3; ++j)
+			{
+				UINT q = CornerPosition(t, j);
+				if (q != p && std::find(neighbors.begin(), neighbors.end(), q) == neighbors.end())
+					neighbors.push_back(q);
+			}
+		}
+	}
+
+	void QuadricSimplifier::PushCollapse(UINT from, UINT to)
+	{
+		// 边界顶点只能沿边界移动，是否沿着边界边在折叠时检查
+		if (m_Locked[from] || (m_Border[from] && !m_Border[to]))
+			return;
+		// 平坦区域的误差都接近0，加上很小的边长项使短边优先，避免大量折叠集中到同一位置
+		const double kEdgeLengthWeight = 1e-3;
+		Quadric q = m_Quadrics[from];
+		AddQuadric(q, m_Quadrics[to]);
+		Vector3d edge = Subtract(m_Positions[to], m_Positions[from]);
+		double cost = QuadricError(q, m_Positions[to]) + Dot(edge, edge) * kEdgeLengthWeight;
+		m_Deferred.push_back({ cost, from, to, m_Versions[from], m_Versions[to] });
+		m_DeferredMinCost = std::min(m_DeferredMinCost, cost);
+	}
+
+	void QuadricSimplifier::PushCollapses(UINT p)
+	{
+		// p的二次误差已改变，重新加入与p相连的边，旧的条目因版本号不符被丢弃
+		GatherNeighbors(p, m_NeighborsTo);
+		for (UINT q : m_NeighborsTo)
+		{
+			PushCollapse(p, q);
+			PushCollapse(q, p);
+		}
+	}
+
+	bool QuadricSimplifier::TryCollapse(const Collapse& collapse)
+	{
+		UINT from = collapse.from, to = collapse.to;
+		if (!m_Alive[from] || !m_Alive[to] ||
+			m_Versions[from] != collapse.fromVersion || m_Versions[to] != collapse.toVersion)
+			return false;
+
+		// 区分同时包含两个位置(折叠后消失)与只包含from(折叠后移动)的三角形
+		m_Shared.clear();
+		m_Moved.clear();
+		for (UINT t : m_PositionTriangles[from])
+		{
+			if (m_TriangleAlive[t])
+				(HasPosition(t, to) ? m_Shared : m_Moved).push_back(t);
+		}
+		// 流形网格中内部边有两个相邻三角形，边界边只有一个
+		// 没有三角形需要移动时折叠会使整个连通块消失(如双面的单个三角形)
+		if (m_Shared.empty() || m_Shared.size() > 2 || (m_Border[from] && m_Shared.size() != 1) || m_Moved.empty())
+			return false;
+
+		// 连接条件：两端共同的相邻位置只能是消失的三角形的第三个顶点，否则折叠会产生非流形结构
+		m_Opposite.clear();
+		for (UINT t : m_Shared)
+		{
+			for (int j = 0; j < 3; ++j)
+			{
+				UINT p = CornerPosition(t, j);
+				if (p != from && p != to && std::find(m_Opposite.begin(), m_Opposite.end(), p) == m_Opposite.end())
+					m_Opposite.push_back(p);
+			}
+		}
+		GatherNeighbors(from, m_NeighborsFrom);
+		GatherNeighbors(to, m_NeighborsTo);
+		size_t commonCount = 0;
+		for (UINT p : m_NeighborsFrom)
+			commonCount += std::find(m_NeighborsTo.begin(), m_NeighborsTo.end(), p) != m_NeighborsTo.end();
+		if (commonCount != m_Opposite.size())
+			return false;
+
+		// from上的每个wedge沿共享的边映射到to上唯一的wedge
+		auto cornerWedge = [this](UINT t, UINT p)
+		{
+			for (int j = 0; j < 3; ++j)
+			{
+				if (CornerPosition(t, j) == p)
+					return m_Triangles[t * 3 + j];
+			}
+			return m_Triangles[t * 3];
+		};
+		auto findMapping = [this](UINT wedge)
+		{
+			return std::find_if(m_WedgeMap.begin(), m_WedgeMap.end(),
+				[wedge](const std::pair<UINT, UINT>& m) { return m.first == wedge; });
+		};
+		m_WedgeMap.clear();
+		for (UINT t : m_Shared)
+		{
+			UINT wedgeFrom = cornerWedge(t, from), wedgeTo = cornerWedge(t, to);
+			auto it = findMapping(wedgeFrom);
+			if (it == m_WedgeMap.end())
+				m_WedgeMap.emplace_back(wedgeFrom, wedgeTo);
+			else if (it->second != wedgeTo)
+				return false;
+		}
+		for (UINT t : m_Moved)
+		{
+			if (findMapping(cornerWedge(t, from)) == m_WedgeMap.end())
+				return false;
+		}
+
+		// 移动后的三角形不能翻转或退化
+		const Vector3d& target = m_Positions[to];
+		for (UINT t : m_Moved)
+		{
+			Vector3d before[3], after[3];
+			for (int j = 0; j < 3; ++j)
+			{
+				UINT p = CornerPosition(t, j);
+				before[j] = m_Positions[p];
+				after[j] = p == from ? target : before[j];
+			}
+			Vector3d n0 = Cross(Subtract(before[1], before[0]), Subtract(before[2], before[0]));
+			Vector3d n1 = Cross(Subtract(after[1], after[0]), Subtract(after[2], after[0]));
+			double length1 = Dot(n1, n1);
+			if (length1 <= 0.0 || Dot(n0, n1) < 0.25 * std::sqrt(Dot(n0, n0) * length1))
+				return false;
+		}
+
+		// 执行折叠
+		for (UINT t : m_Shared)
+		{
+			m_TriangleAlive[t] = 0;
+			--m_TriangleCount;
+		}
+		std::vector<UINT>& toTriangles = m_PositionTriangles[to];
+		toTriangles.erase(std::remove_if(toTriangles.begin(), toTriangles.end(),
+			[this](UINT t) { return !m_TriangleAlive[t]; }), toTriangles.end());
+		for (UINT t : m_Moved)
+		{
+			for (int j = 0; j < 3; ++j)
+			{
+				if (CornerPosition(t, j) == from)
+					m_Triangles[t * 3 + j] = findMapping(m_Triangles[t * 3 + j])->second;
+			}
+			toTriangles.push_back(t);
+		}
+		std::vector<UINT>().swap(m_PositionTriangles[from]);
+		AddQuadric(m_Quadrics[to], m_Quadrics[from]);
+		m_Alive[from] = 0;
+		m_CollapsedTo[from] = to;
+		++m_Versions[to];
+
+		PushCollapses(to);
+		return true;
+	}
+
+	//
+	// 三角形簇
+	//
+
+	// 将10位整数的各位间隔两位展开，用于组成Morton码
+	inline uint32_t SpreadBits10(uint32_t x)
+	{
+		x &= 0x3FF;
+		x = (x | (x << 16)) & 0x030000FF;
+		x = (x | (x << 8)) & 0x0300F00F;
+		x = (x | (x << 4)) & 0x030C30C3;
+		x = (x | (x << 2)) & 0x09249249;
+		return x;
+	}
+
+	// 计算一簇三角形的包围球(Ritter)与法线锥
+	template<class IndexType>
+	void ComputeMeshletBounds(const std::vector<VertexPosNormalTex>& vertices, const IndexType* indices, size_t indexCount,
+		const std::vector<Vector3d>& points, ObjReader::ObjMeshlet& meshlet)
+	{
+		auto distanceSq = [](const Vector3d& a, const Vector3d& b) { Vector3d d = Subtract(a, b); return Dot(d, d); };
+		auto farthest = [&](const Vector3d& from)
+		{
+			size_t index = 0;
+			for (size_t i = 1; i < points.size(); ++i)
+			{
+				if (distanceSq(points[i], from) > distanceSq(points[index], from))
+					index = i;
+			}
+			return points[index];
+		};
+		Vector3d a = farthest(points[0]);
+		Vector3d b = farthest(a);
+		Vector3d center = { (a.x + b.x) * 0.5, (a.y + b.y) * 0.5, (a.z + b.z) * 0.5 };
+		double radius = std::sqrt(distanceSq(a, b)) * 0.5;
+		for (const Vector3d& p : points)
+		{
+			double d = std::sqrt(distanceSq(p, center));
+			if (d > radius)
+			{
+				double newRadius = (radius + d) * 0.5;
+				center = MultiplyAdd(center, Subtract(p, center), (newRadius - radius) / d);
+				radius = newRadius;
+			}
+		}
+		// 以取整后的球心重新计算半径，保证所有顶点都在球内
+		meshlet.center = XMFLOAT3((float)center.x, (float)center.y, (float)center.z);
+		Vector3d storedCenter = ToVector3d(meshlet.center);
+		double radiusSq = 0.0;
+		for (const Vector3d& p : points)
+			radiusSq = (std::max)(radiusSq, distanceSq(p, storedCenter));
+		meshlet.radius = std::nextafter((float)std::sqrt(radiusSq), FLT_MAX);
+
+		// 轴向取各三角形单位法向量之和的方向，退化三角形不会被绘制，不参与计算
+		std::vector<Vector3d> normals;
+		normals.reserve(indexCount / 3);
+		Vector3d axis = {};
+		for (size_t i = 0; i + 2 < indexCount; i += 3)
+		{
+			Vector3d p0 = ToVector3d(vertices[indices[i]].pos);
+			Vector3d n = Cross(Subtract(ToVector3d(vertices[indices[i + 1]].pos), p0), Subtract(ToVector3d(vertices[indices[i + 2]].pos), p0));
+			double length = std::sqrt(Dot(n, n));
+			if (length > 0.0)
+			{
+				normals.push_back({ n.x / length, n.y / length, n.z / length });
+				axis = MultiplyAdd(axis, normals.back(), 1.0);
+			}
+		}
+		double axisLength = std::sqrt(Dot(axis, axis));
+		meshlet.coneAxis = XMFLOAT3();
+		meshlet.coneCutoff = -1.0f;
+		if (axisLength < 1e-6)
+			return;
+		axis = { axis.x / axisLength, axis.y / axisLength, axis.z / axisLength };
+		double cutoff = 1.0;
+		for (const Vector3d& n : normals)
+			cutoff = (std::min)(cutoff, Dot(n, axis));
+		meshlet.coneAxis = XMFLOAT3((float)axis.x, (float)axis.y, (float)axis.z);
+		// 略微放宽以抵消轴向取整为float的误差
+		meshlet.coneCutoff = (float)(cutoff - 1e-6);
+	}
+
+	// 法线锥越窄，簇整体背向观察者而被剔除的机会越大，因此与簇的平均法向量偏离越多的三角形代价越高
+	// 只作为代价而不直接拒绝，否则朝向分散的网格(如树叶)会被切成大量很小的簇，顶点在簇之间重复变换
+	const double kMeshletConeWeight = 1.0;
+
+	template<class IndexType>
+	void BuildMeshletsImpl(const std::vector<VertexPosNormalTex>& vertices, std::vector<IndexType>& indices,
+		UINT maxVertices, UINT maxTriangles, std::vector<ObjReader::ObjMeshlet>& meshlets)
+	{
+		meshlets.clear();
+		size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0 || maxVertices < 3 || maxTriangles == 0)
+			return;
+
+		// 三角形的重心与单位法向量，退化三角形的法向量为0
+		std::vector<Vector3d> centroids(triangleCount), normals(triangleCount);
+		Vector3d boxMin = { DBL_MAX, DBL_MAX, DBL_MAX }, boxMax = { -DBL_MAX, -DBL_MAX, -DBL_MAX };
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			Vector3d p0 = ToVector3d(vertices[indices[t * 3]].pos);
+			Vector3d p1 = ToVector3d(vertices[indices[t * 3 + 1]].pos);
+			Vector3d p2 = ToVector3d(vertices[indices[t * 3 + 2]].pos);
+			Vector3d& c = centroids[t];
+			c = { (p0.x + p1.x + p2.x) / 3.0, (p0.y + p1.y + p2.y) / 3.0, (p0.z + p1.z + p2.z) / 3.0 };
+			boxMin = { (std::min)(boxMin.x, c.x), (std::min)(boxMin.y, c.y), (std::min)(boxMin.z, c.z) };
+			boxMax = { (std::max)(boxMax.x, c.x), (std::max)(boxMax.y, c.y), (std::max)(boxMax.z, c.z) };
+			Vector3d n = Cross(Subtract(p1, p0), Subtract(p2, p0));
+			double length = std::sqrt(Dot(n, n));
+			normals[t] = length > 0.0 ? Vector3d{ n.x / length, n.y / length, n.z / length } : Vector3d{};
+		}
+
+		// 簇的起点按重心的Morton码顺序选取，使前后相邻的簇在空间上也相邻
+		std::vector<std::pair<uint32_t, UINT>> seeds(triangleCount);
+		Vector3d extent = Subtract(boxMax, boxMin);
+		double scale = 1023.0 / (std::max)((std::max)(extent.x, extent.y), (std::max)(extent.z, DBL_MIN));
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			Vector3d c = Subtract(centroids[t], boxMin);
+			seeds[t].first = SpreadBits10((uint32_t)(c.x * scale)) | SpreadBits10((uint32_t)(c.y * scale)) << 1 |
+				SpreadBits10((uint32_t)(c.z * scale)) << 2;
+			seeds[t].second = (UINT)t;
+		}
+		std::sort(seeds.begin(), seeds.end());
+
+		// 按位置焊接后的顶点到三角形的邻接表(CSR)，使UV接缝与法向量不连续处两侧的三角形也相邻
+		std::unordered_map<WeldKey, UINT, WeldKeyHash> positionLookup;
+		std::vector<UINT> positionOf(vertices.size());
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			const XMFLOAT3& pos = vertices[i].pos;
+			WeldKey key = { { FloatBits(pos.x), FloatBits(pos.y), FloatBits(pos.z), 0, 0 } };
+			positionOf[i] = positionLookup.emplace(key, (UINT)positionLookup.size()).first->second;
+		}
+		std::vector<UINT> adjacencyOffsets(positionLookup.size() + 1, 0);
+		for (size_t i = 0; i < triangleCount * 3; ++i)
+			++adjacencyOffsets[positionOf[indices[i]] + 1];
+		for (size_t i = 1; i < adjacencyOffsets.size(); ++i)
+			adjacencyOffsets[i] += adjacencyOffsets[i - 1];
+		std::vector<UINT> adjacency(triangleCount * 3);
+		{
+			std::vector<UINT> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (size_t i = 0; i < triangleCount * 3; ++i)
+				adjacency[cursor[positionOf[indices[i]]]++] = (UINT)(i / 3);
+		}
+
+		// 按索引连通的块(如UV接缝分开的面片、独立的四边形)，顶点与三角形都不超过簇的上限时整块放入同一个簇，
+		// 块内的顶点因此不会被复制到多个簇中；componentTriangles为块中尚未加入簇的三角形数目
+		std::vector<UINT> componentOf(vertices.size());
+		for (size_t i = 0; i < vertices.size(); ++i)
+			componentOf[i] = (UINT)i;
+		auto findComponent = [&componentOf](UINT v)
+		{
+			while (componentOf[v] != v)
+				v = componentOf[v] = componentOf[componentOf[v]];
+			return v;
+		};
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			UINT root = findComponent((UINT)indices[t * 3]);
+			componentOf[findComponent((UINT)indices[t * 3 + 1])] = root;
+			componentOf[findComponent((UINT)indices[t * 3 + 2])] = root;
+		}
+		std::vector<UINT> componentVertices(vertices.size(), 0), componentTriangles(vertices.size(), 0);
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			componentOf[i] = findComponent((UINT)i);
+			++componentVertices[componentOf[i]];
+		}
+		for (size_t t = 0; t < triangleCount; ++t)
+			++componentTriangles[componentOf[indices[t * 3]]];
+		auto isSmallComponent = [&](UINT c)
+		{
+			return componentVertices[c] <= maxVertices && componentTriangles[c] <= maxTriangles;
+		};
+
+		// 以簇的编号标记已加入当前簇的顶点、候选三角形与预留了空间的块
+		// 候选数目设有上限，避免共享顶点极多的网格上每一步的开销过大
+		const UINT kNone = UINT_MAX;
+		const size_t kMaxCandidates = 256;
+		const size_t kSeedWindow = 64;
+		std::vector<uint8_t> used(triangleCount, 0);
+		std::vector<UINT> vertexMeshlet(vertices.size(), kNone), candidateMeshlet(triangleCount, kNone);
+		std::vector<UINT> componentMeshlet(vertices.size(), kNone);
+		std::vector<UINT> candidates, meshletTriangles;
+		std::vector<Vector3d> meshletPoints;
+		std::vector<IndexType> result;
+		result.reserve(triangleCount * 3);
+		size_t seedCursor = 0;
+		for (UINT id = 0; seedCursor < triangleCount; ++id)
+		{
+			candidates.clear();
+			meshletTriangles.clear();
+			meshletPoints.clear();
+			Vector3d centroidSum = {}, normalSum = {};
+			double spread = 0.0;
+			// 已加入当前簇的小块中尚未加入的顶点与三角形，需要为它们预留空间
+			size_t reservedVertices = 0, reservedTriangles = 0;
+			auto newVertexCount = [&](UINT t)
+			{
+				return (UINT)(vertexMeshlet[indices[t * 3]] != id) + (UINT)(vertexMeshlet[indices[t * 3 + 1]] != id) +
+					(UINT)(vertexMeshlet[indices[t * 3 + 2]] != id);
+			};
+
+			UINT next = kNone;
+			for (;;)
+			{
+				if (meshletTriangles.empty())
+				{
+					while (seedCursor < triangleCount && used[seeds[seedCursor].second])
+						++seedCursor;
+					if (seedCursor == triangleCount)
+						break;
+					next = seeds[seedCursor].second;
+				}
+
+				UINT component = componentOf[indices[next * 3]];
+				if (componentMeshlet[component] != id && isSmallComponent(component))
+				{
+					componentMeshlet[component] = id;
+					reservedVertices += componentVertices[component];
+					reservedTriangles += componentTriangles[component];
+				}
+				if (componentMeshlet[component] == id)
+				{
+					reservedVertices -= newVertexCount(next);
+					--reservedTriangles;
+				}
+				--componentTriangles[component];
+
+				used[next] = 1;
+				meshletTriangles.push_back(next);
+				for (int j = 0; j < 3; ++j)
+				{
+					IndexType v = indices[next * 3 + j];
+					if (vertexMeshlet[v] != id)
+					{
+						vertexMeshlet[v] = id;
+						meshletPoints.push_back(ToVector3d(vertices[v].pos));
+					}
+					UINT p = positionOf[v];
+					for (UINT k = adjacencyOffsets[p]; k < adjacencyOffsets[p + 1] && candidates.size() < kMaxCandidates; ++k)
+					{
+						UINT t = adjacency[k];
+						if (!used[t] && candidateMeshlet[t] != id)
+						{
+							candidateMeshlet[t] = id;
+							candidates.push_back(t);
+						}
+					}
+				}
+				if (meshletTriangles.size() == maxTriangles)
+					break;
+
+				centroidSum = MultiplyAdd(centroidSum, centroids[next], 1.0);
+				normalSum = MultiplyAdd(normalSum, normals[next], 1.0);
+				double inverseCount = 1.0 / meshletTriangles.size();
+				Vector3d center = { centroidSum.x * inverseCount, centroidSum.y * inverseCount, centroidSum.z * inverseCount };
+				for (int j = 0; j < 3; ++j)
+				{
+					Vector3d offset = Subtract(ToVector3d(vertices[indices[next * 3 + j]].pos), center);
+					spread = (std::max)(spread, std::sqrt(Dot(offset, offset)));
+				}
+				double normalLength = std::sqrt(Dot(normalSum, normalSum));
+				Vector3d axis = normalLength > 0.0 ?
+					Vector3d{ normalSum.x / normalLength, normalSum.y / normalLength, normalSum.z / normalLength } : Vector3d{};
+
+				// 代价 = 新增顶点数 + 到簇中心的距离(相对簇的大小) + 与簇平均法向量的偏离
+				next = kNone;
+				double bestCost = DBL_MAX;
+				auto consider = [&](UINT t)
+				{
+					UINT newCount = newVertexCount(t);
+					if (meshletPoints.size() + newCount > maxVertices)
+						return;
+					// 不属于已预留的块时，小块需要整块放得下，其余三角形不能占用预留的空间
+					UINT component = componentOf[indices[t * 3]];
+					if (componentMeshlet[component] != id)
+					{
+						bool whole = isSmallComponent(component);
+						if (meshletPoints.size() + reservedVertices + (whole ? componentVertices[component] : newCount) > maxVertices ||
+							meshletTriangles.size() + reservedTriangles + (whole ? componentTriangles[component] : 1) > maxTriangles)
+							return;
+					}
+					Vector3d d = Subtract(centroids[t], center);
+					double cost = newCount + (spread > 0.0 ? std::sqrt(Dot(d, d)) / spread : 0.0) +
+						kMeshletConeWeight * (1.0 - Dot(normals[t], axis));
+					if (cost < bestCost)
+					{
+						bestCost = cost;
+						next = t;
+					}
+				};
+				for (size_t i = 0; i < candidates.size();)
+				{
+					if (used[candidates[i]])
+					{
+						candidates[i] = candidates.back();
+						candidates.pop_back();
+						continue;
+					}
+					consider(candidates[i++]);
+				}
+				// 没有相邻的候选时(如互不相连的小块网格)，从Morton顺序中接下来的若干个三角形里选取
+				for (size_t i = seedCursor; next == kNone && i < triangleCount && i < seedCursor + kSeedWindow; ++i)
+				{
+					if (!used[seeds[i].second])
+						consider(seeds[i].second);
+				}
+				if (next == kNone)
+					break;
+			}
+
+			if (meshletTriangles.empty())
+				break;
+			ObjReader::ObjMeshlet meshlet;
+			meshlet.startIndex = (UINT)result.size();
+			meshlet.indexCount = (UINT)meshletTriangles.size() * 3;
+			for (UINT t : meshletTriangles)
+				result.insert(result.end(), indices.begin() + t * 3, indices.begin() + t * 3 + 3);
+			ComputeMeshletBounds(vertices, result.data() + meshlet.startIndex, meshlet.indexCount, meshletPoints, meshlet);
+			meshlets.push_back(meshlet);
+		}
+
+		// 按法线锥轴向的主方向分组(无法按朝向剔除的簇排在最后)，组内保持空间顺序，
+		// 使同时被剔除的簇在索引中相邻，剩余的簇可以合并为较少的绘制调用
+		auto direction = [](const ObjReader::ObjMeshlet& meshlet)
+		{
+			if (meshlet.coneCutoff <= 0.0f)
+				return 6;
+			const XMFLOAT3& a = meshlet.coneAxis;
+			float x = std::fabs(a.x), y = std::fabs(a.y), z = std::fabs(a.z);
+			if (x >= y && x >= z)
+				return a.x > 0.0f ? 0 : 3;
+			if (y >= z)
+				return a.y > 0.0f ? 1 : 4;
+			return a.z > 0.0f ? 2 : 5;
+		};
+		std::stable_sort(meshlets.begin(), meshlets.end(), [&](const ObjReader::ObjMeshlet& lhs, const ObjReader::ObjMeshlet& rhs)
+		{
+			return direction(lhs) < direction(rhs);
+		});
+		// 不足一个三角形的多余索引保留在末尾
+		size_t offset = 0;
+		for (auto& meshlet : meshlets)
+		{
+			std::copy(result.begin() + meshlet.startIndex, result.begin() + meshlet.startIndex + meshlet.indexCount, indices.begin() + offset);
+			meshlet.startIndex = (UINT)offset;
+			offset += meshlet.indexCount;
+		}
+	}
+
+	//
+	// 拆分大网格
+	//
+
+	// 按三角形重心的Morton码顺序填充子网格，顶点数将要超过maxVertices时开始下一个子网格
+	// 每个子网格覆盖Morton曲线上连续的一段，因此在空间上是紧凑的，跨子网格的顶点会被复制
+	void SplitPartImpl(const ObjReader::ObjPart& part, UINT maxVertices, std::vector<ObjReader::ObjPart>& submeshes)
+	{
+		const auto& vertices = part.vertices;
+		const auto& indices = part.indices32;
+		size_t triangleCount = indices.size() / 3;
+
+		std::vector<Vector3d> centroids(triangleCount);
+		Vector3d boxMin = { DBL_MAX, DBL_MAX, DBL_MAX }, boxMax = { -DBL_MAX, -DBL_MAX, -DBL_MAX };
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			Vector3d p0 = ToVector3d(vertices[indices[t * 3]].pos);
+			Vector3d p1 = ToVector3d(vertices[indices[t * 3 + 1]].pos);
+			Vector3d p2 = ToVector3d(vertices[indices[t * 3 + 2]].pos);
+			Vector3d& c = centroids[t];
+			c = { (p0.x + p1.x + p2.x) / 3.0, (p0.y + p1.y + p2.y) / 3.0, (p0.z + p1.z + p2.z) / 3.0 };
+			boxMin = { (std::min)(boxMin.x, c.x), (std::min)(boxMin.y, c.y), (std::min)(boxMin.z, c.z) };
+			boxMax = { (std::max)(boxMax.x, c.x), (std::max)(boxMax.y, c.y), (std::max)(boxMax.z, c.z) };
+		}
+
+		std::vector<std::pair<uint32_t, UINT>> order(triangleCount);
+		Vector3d extent = Subtract(boxMax, boxMin);
+		double scale = 1023.0 / (std::max)((std::max)(extent.x, extent.y), (std::max)(extent.z, DBL_MIN));
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			Vector3d c = Subtract(centroids[t], boxMin);
+			order[t].first = SpreadBits10((uint32_t)(c.x * scale)) | SpreadBits10((uint32_t)(c.y * scale)) << 1 |
+				SpreadBits10((uint32_t)(c.z * scale)) << 2;
+			order[t].second = (UINT)t;
+		}
+		std::sort(order.begin(), order.end());
+
+		// owner记录顶点最近被复制到的子网格，remap为其在该子网格中的位置
+		std::vector<size_t> owner(vertices.size(), SIZE_MAX);
+		std::vector<WORD> remap(vertices.size());
+		size_t first = submeshes.size();
+		size_t current = SIZE_MAX;
+		for (auto& entry : order)
+		{
+			const DWORD* triangle = indices.data() + entry.second * 3;
+			if (current != SIZE_MAX)
+			{
+				size_t newCount = 0;
+				for (int k = 0; k < 3; ++k)
+					newCount += owner[triangle[k]] != current;
+				if (submeshes[current].vertices.size() + newCount > maxVertices)
+					current = SIZE_MAX;
+			}
+			if (current == SIZE_MAX)
+			{
+				current = submeshes.size();
+				submeshes.emplace_back();
+				submeshes[current].material = part.material;
+				submeshes[current].texStrDiffuse = part.texStrDiffuse;
+			}
+
+			ObjReader::ObjPart& submesh = submeshes[current];
+			for (int k = 0; k < 3; ++k)
+			{
+				DWORD v = triangle[k];
+				if (owner[v] != current)
+				{
+					owner[v] = current;
+					remap[v] = (WORD)submesh.vertices.size();
+					submesh.vertices.push_back(vertices[v]);
+				}
+				submesh.indices16.push_back(remap[v]);
+			}
+		}
+		for (size_t i = first; i < submeshes.size(); ++i)
+			submeshes[i].bounds = ObjReader::ComputeBounds(submeshes[i].vertices.data(), submeshes[i].vertices.size());
+	}
+
+	// 将32位索引转为16位索引并释放原数组，调用方需保证所有索引都小于0xFFFF
+	void NarrowIndices(std::vector<DWORD>& indices32, std::vector<WORD>& indices16)
+	{
+		if (indices32.empty())
+			return;
+		indices16.assign(indices32.begin(), indices32.end());
+		std::vector<DWORD>().swap(indices32);
+	}
+
+	//
+	// 按材质合并部分
+	//
+
+	bool SameMaterial(const ObjReader::ObjPart& lhs, const ObjReader::ObjPart& rhs)
+	{
+		return memcmp(&lhs.material, &rhs.material, sizeof(Material)) == 0 && lhs.texStrDiffuse == rhs.texStrDiffuse;
+	}
+
+	// 以顶点的全部字节为键，位置、法向量与纹理坐标都相同的顶点才视为重复
+	struct VertexBytesHash
+	{
+		size_t operator()(const VertexPosNormalTex& vertex) const
+		{
+			uint32_t words[sizeof(VertexPosNormalTex) / 4];
+			memcpy(words, &vertex, sizeof(words));
+			uint64_t h = 0;
+			for (uint32_t w : words)
+				h = (h ^ w) * 0x9E3779B97F4A7C15ull;
+			return (size_t)(h ^ (h >> 32));
+		}
+	};
+
+	struct VertexBytesEqual
+	{
+		bool operator()(const VertexPosNormalTex& lhs, const VertexPosNormalTex& rhs) const
+		{
+			return memcmp(&lhs, &rhs, sizeof(VertexPosNormalTex)) == 0;
+		}
+	};
+
+	// 将group中的部分依次追加到merged，顶点经共享的顶点池去重
+	void MergePartsImpl(std::vector<ObjReader::ObjPart*>& group, ObjReader::ObjPart& merged)
+	{
+		size_t vertexCount = 0, indexCount = 0;
+		for (auto* part : group)
+		{
+			vertexCount += part->vertices.size();
+			indexCount += part->indices16.size() + part->indices32.size();
+		}
+
+		merged.material = group.front()->material;
+		merged.texStrDiffuse = group.front()->texStrDiffuse;
+		merged.vertices.reserve(vertexCount);
+		std::vector<DWORD> indices;
+		indices.reserve(indexCount);
+
+		std::unordered_map<VertexPosNormalTex, DWORD, VertexBytesHash, VertexBytesEqual> pool;
+		pool.reserve(vertexCount);
+		std::vector<DWORD> remap;
+		for (auto* part : group)
+		{
+			remap.resize(part->vertices.size());
+			for (size_t i = 0; i < part->vertices.size(); ++i)
+			{
+				auto result = pool.emplace(part->vertices[i], (DWORD)merged.vertices.size());
+				if (result.second)
+					merged.vertices.push_back(part->vertices[i]);
+				remap[i] = result.first->second;
+			}
+			for (WORD index : part->indices16)
+				indices.push_back(remap[index]);
+			for (DWORD index : part->indices32)
+				indices.push_back(remap[index]);
+		}
+
+		// 与ObjReader相同，顶点数不超过WORD的最大值时使用16位索引
+		if (merged.vertices.size() < 65535)
+			merged.indices16.assign(indices.begin(), indices.end());
+		else
+			merged.indices32.swap(indices);
+		merged.bounds = ObjReader::ComputeBounds(merged.vertices.data(), merged.vertices.size());
+	}
+}
+
+namespace MeshOptimizer
+{
+	VertexCacheStats AnalyzeVertexCache(const WORD* indices, size_t indexCount, size_t vertexCount, UINT cacheSize)
+	{
+		return AnalyzeVertexCacheImpl(indices, indexCount, vertexCount, cacheSize);
+	}
+
+	VertexCacheStats AnalyzeVertexCache(const DWORD* indices, size_t indexCount, size_t vertexCount, UINT cacheSize)
+	{
+		return AnalyzeVertexCacheImpl(indices, indexCount, vertexCount, cacheSize);
+	}
+
+	void OptimizeVertexCache(WORD* indices, size_t indexCount, size_t vertexCount, UINT cacheSize)
+	{
+		OptimizeVertexCacheImpl(indices, indexCount, vertexCount, cacheSize);
+	}
+
+	void OptimizeVertexCache(DWORD* indices, size_t indexCount, size_t vertexCount, UINT cacheSize)
+	{
+		OptimizeVertexCacheImpl(indices, indexCount, vertexCount, cacheSize);
+	}
+
+	void OptimizeVertexFetch(std::vector<VertexPosNormalTex>& vertices, WORD* indices, size_t indexCount)
+	{
+		OptimizeVertexFetchImpl(vertices, indices, indexCount);
+	}
+
+	void OptimizeVertexFetch(std::vector<VertexPosNormalTex>& vertices, DWORD* indices, size_t indexCount)
+	{
+		OptimizeVertexFetchImpl(vertices, indices, indexCount);
+	}
+
+	void OptimizePart(ObjReader::ObjPart& part, VertexCacheStats* before, VertexCacheStats* after)
+	{
+		// 索引宽度以实际存储的索引数组为准
+		if (!part.indices32.empty())
+			OptimizePartImpl(part.vertices, part.indices32, part.lods, &ObjReader::ObjLod::indices32, part.meshlets, before, after);
+		else
+			OptimizePartImpl(part.vertices, part.indices16, part.lods, &ObjReader::ObjLod::indices16, part.meshlets, before, after);
+	}
+
+	void GenerateLods(ObjReader::ObjPart& part, const float* ratios, size_t ratioCount, LodStats* stats)
+	{
+		LodStats result = {};
+		if (stats)
+			*stats = result;
+		part.lods.clear();
+		if (ratioCount == 0)
+			return;
+		bool use32 = !part.indices32.empty();
+		std::vector<DWORD> indices;
+		if (use32)
+			indices = part.indices32;
+		else
+			indices.assign(part.indices16.begin(), part.indices16.end());
+		size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0)
+			return;
+
+		QuadricSimplifier simplifier(part.vertices, indices.data(), indices.size());
+		const auto& wedges = simplifier.GetWedges();
+		// wedge对应的顶点，法向量一致时直接使用原始顶点，否则追加一个平均法向量的顶点
+		const UINT kNoVertex = UINT_MAX;
+		std::vector<UINT> wedgeVertices(wedges.size(), kNoVertex);
+		std::vector<std::vector<DWORD>> levels;
+		std::vector<float> errors;
+		std::vector<UINT> wedgeIndices;
+		size_t previousCount = triangleCount;
+		for (size_t i = 0; i < ratioCount; ++i)
+		{
+			simplifier.Simplify((size_t)(triangleCount * ratios[i]));
+			// 三角形数减少不到10%的级别没有意义，此后也不会有进展
+			size_t count = simplifier.GetTriangleCount();
+			if (count == 0 || count * 10 > previousCount * 9)
+				break;
+			previousCount = count;
+
+			simplifier.GetTriangles(wedgeIndices);
+			levels.emplace_back(wedgeIndices.size());
+			for (size_t j = 0; j < wedgeIndices.size(); ++j)
+			{
+				UINT w = wedgeIndices[j];
+				if (wedgeVertices[w] == kNoVertex)
+				{
+					const auto& wedge = wedges[w];
+					wedgeVertices[w] = wedge.source;
+					// 16位索引的部分已满时不再追加顶点，避免索引改为32位
+					if (!wedge.uniformNormal && !use32 && part.vertices.size() >= kSubmeshMaxVertices)
+					{
+						++result.reusedVertexCount;
+					}
+					else if (!wedge.uniformNormal)
+					{
+						VertexPosNormalTex vertex = part.vertices[wedge.source];
+						XMVECTOR normalSum = XMLoadFloat3(&wedge.normalSum);
+						if (XMVectorGetX(XMVector3LengthSq(normalSum)) > 0.0f)
+							XMStoreFloat3(&vertex.normal, XMVector3Normalize(normalSum));
+						wedgeVertices[w] = (UINT)part.vertices.size();
+						part.vertices.push_back(vertex);
+						++result.appendedVertexCount;
+					}
+				}
+				levels.back()[j] = wedgeVertices[w];
+			}
+			errors.push_back(simplifier.ComputeError());
+		}
+
+		part.lods.resize(levels.size());
+		for (size_t i = 0; i < levels.size(); ++i)
+		{
+			ObjReader::ObjLod& lod = part.lods[i];
+			if (use32)
+				lod.indices32.swap(levels[i]);
+			else
+				lod.indices16.assign(levels[i].begin(), levels[i].end());
+			lod.error = errors[i];
+		}
+		result.levelCount = levels.size();
+		if (stats)
+			*stats = result;
+	}
+
+	UINT LodVertexBudget(const float* ratios, size_t ratioCount)
+	{
+		if (ratioCount == 0)
+			return kSubmeshMaxVertices;
+		return (UINT)(kSubmeshMaxVertices / (1.0f + ratios[0]));
+	}
+
+	void BuildMeshlets(ObjReader::ObjPart& part, UINT maxVertices, UINT maxTriangles)
+	{
+		if (!part.indices32.empty())
+			BuildMeshletsImpl(part.vertices, part.indices32, maxVertices, maxTriangles, part.meshlets);
+		else
+			BuildMeshletsImpl(part.vertices, part.indices16, maxVertices, maxTriangles, part.meshlets);
+	}
+
+	void SplitLargeParts(std::vector<ObjReader::ObjPart>& parts, SplitStats* stats, UINT maxVertices)
+	{
+		maxVertices = (std::min)((std::max)(maxVertices, 3u), kSubmeshMaxVertices);
+
+		SplitStats result = {};
+		std::vector<ObjReader::ObjPart> output;
+		output.reserve(parts.size());
+		for (auto& part : parts)
+		{
+			result.vertexCountBefore += part.vertices.size();
+			result.indexBytesBefore += part.indices16.size() * sizeof(WORD) + part.indices32.size() * sizeof(DWORD);
+			if (part.indices32.empty())
+			{
+				output.push_back(std::move(part));
+				continue;
+			}
+			// 最大索引为maxVertices - 1，不会与图元重启值0xFFFF冲突
+			if (part.vertices.size() <= maxVertices)
+			{
+				NarrowIndices(part.indices32, part.indices16);
+				for (auto& lod : part.lods)
+					NarrowIndices(lod.indices32, lod.indices16);
+				output.push_back(std::move(part));
+				++result.narrowedPartCount;
+				continue;
+			}
+
+			size_t first = output.size();
+			SplitPartImpl(part, maxVertices, output);
+			++result.splitPartCount;
+			result.submeshCount += output.size() - first;
+		}
+
+		for (auto& part : output)
+		{
+			result.vertexCountAfter += part.vertices.size();
+			result.indexBytesAfter += part.indices16.size() * sizeof(WORD) + part.indices32.size() * sizeof(DWORD);
+		}
+		parts.swap(output);
+		if (stats)
+			*stats = result;
+	}
+
+	void MergePartsByMaterial(std::vector<ObjReader::ObjPart>& parts, MergeStats* stats)
+	{
+		MergeStats result = {};
+		result.partCountBefore = parts.size();
+
+		// 按材质首次出现的顺序分组，材质的种类通常远少于部分数，逐个比较即可
+		std::vector<std::vector<ObjReader::ObjPart*>> groups;
+		for (auto& part : parts)
+		{
+			result.vertexCountBefore += part.vertices.size();
+			auto it = std::find_if(groups.begin(), groups.end(), [&](const std::vector<ObjReader::ObjPart*>& group)
+			{
+				return SameMaterial(*group.front(), part);
+			});
+			if (it == groups.end())
+				groups.emplace_back(1, &part);
+			else
+				it->push_back(&part);
+		}
+
+		std::vector<ObjReader::ObjPart> output(groups.size());
+		for (size_t i = 0; i < groups.size(); ++i)
+		{
+			// 单独的部分原样保留
+			if (groups[i].size() == 1)
+				output[i] = std::move(*groups[i].front());
+			else
+				MergePartsImpl(groups[i], output[i]);
+			result.vertexCountAfter += output[i].vertices.size();
+		}
+		result.partCountAfter = output.size();
+
+		parts.swap(output);
+		if (stats)
+			*stats = result;
+	}
+}
@@ -0,0 +1,107 @@
+//***************************************************************************************
+// MeshOptimizer.h
+// Licensed under the MIT License.
+//
+// 模型烘焙阶段使用的网格优化
+// Cook-time mesh optimization passes.
+//***************************************************************************************
+
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H
+
+#include "ObjReader.h"
+
+namespace MeshOptimizer
+{
+	// 模拟的顶点后变换缓存大小(FIFO)
+	static const UINT kCacheSize = 16;
+	// 三角形簇的默认上限
+	static const UINT kMeshletMaxVertices = 64;
+	static const UINT kMeshletMaxTriangles = 124;
+	// 拆分后子网格的顶点数上限，索引不会出现0xFFFF(图元重启值)
+	static const UINT kSubmeshMaxVertices = 65535;
+
+	// 顶点缓存统计
+	// acmr: 平均每个三角形需要变换的顶点数，范围为[0.5, 3]，越低越好
+	// atvr: 变换次数与顶点数之比，1为最优
+	struct VertexCacheStats
+	{
+		float acmr;
+		float atvr;
+	};
+
+	// 拆分大网格的统计，字节数只计原始网格的索引
+	struct SplitStats
+	{
+		size_t splitPartCount;		// 被拆分的部分数
+		size_t submeshCount;		// 拆分得到的子网格数
+		size_t narrowedPartCount;	// 无需拆分、直接改用16位索引的部分数
+		size_t vertexCountBefore, vertexCountAfter;		// 子网格边界上的顶点会被复制
+		size_t indexBytesBefore, indexBytesAfter;
+	};
+
+	// 生成LOD链的统计
+	struct LodStats
+	{
+		size_t levelCount;			// 生成的级别数
+		size_t appendedVertexCount;	// 以平均法向量追加的顶点数
+		size_t reusedVertexCount;	// 16位索引已用尽而直接使用原始顶点(及其法向量)的wedge数
+	};
+
+	// 按材质合并部分的统计，每个部分对应D3DObject::Draw中的一次绘制调用
+	struct MergeStats
+	{
+		size_t partCountBefore, partCountAfter;
+		size_t vertexCountBefore, vertexCountAfter;		// 合并的部分之间完全相同的顶点只保留一份
+	};
+
+	// 以FIFO缓存模拟顶点着色器的调用次数
+	VertexCacheStats AnalyzeVertexCache(const WORD* indices, size_t indexCount, size_t vertexCount, UINT cacheSize = kCacheSize);
+	VertexCacheStats AnalyzeVertexCache(const DWORD* indices, size_t indexCount, size_t vertexCount, UINT cacheSize = kCacheSize);
+
+	// 使用Tipsify算法(Sander et al. 2007)重排三角形以提高顶点缓存命中率，三角形的顶点顺序不变
+	void OptimizeVertexCache(WORD* indices, size_t indexCount, size_t vertexCount, UINT cacheSize = kCacheSize);
+	void OptimizeVertexCache(DWORD* indices, size_t indexCount, size_t vertexCount, UINT cacheSize = kCacheSize);
+
+	// 按首次使用的顺序重排顶点并更新索引，改善顶点读取的局部性，未被引用的顶点会被移除
+	void OptimizeVertexFetch(std::vector<VertexPosNormalTex>& vertices, WORD* indices, size_t indexCount);
+	void OptimizeVertexFetch(std::vector<VertexPosNormalTex>& vertices, DWORD* indices, size_t indexCount);
+
+	// 对ObjPart依次执行顶点缓存与顶点读取优化，可选地返回优化前后的统计(只统计原始网格)
+	// 部分带有LOD时各级索引一并优化，只被LOD引用的顶点会被保留
+	// 部分带有三角形簇时只在各簇内部重排三角形，簇的范围保持不变
+	void OptimizePart(ObjReader::ObjPart& part, VertexCacheStats* before = nullptr, VertexCacheStats* after = nullptr);
+
+	// 以二次误差度量(Garland & Heckbert 1997)的半边折叠为ObjPart生成LOD链，替换已有的part.lods
+	// ratios为各级相对原始网格的目标三角形比例，需递减，例如{ 0.5f, 0.25f, 0.1f }
+	// 简化时按位置与纹理坐标焊接顶点，UV接缝上的顶点只能沿接缝折叠，边界顶点只能沿边界折叠
+	// 焊接后法向量不一致的顶点(如平直着色)以平均法向量追加到part.vertices；使用16位索引的部分追加后
+	// 顶点数不超过kSubmeshMaxVertices，索引宽度保持不变，放不下的wedge直接使用原始顶点
+	// 无法继续简化时LOD链会比ratios短，每级记录相对原始网格的近似最大偏差，可选地返回统计
+	void GenerateLods(ObjReader::ObjPart& part, const float* ratios, size_t ratioCount, LodStats* stats = nullptr);
+
+	// 将原始网格的三角形重排为连续的簇，替换已有的part.meshlets，LOD不受影响
+	// 每簇最多引用maxVertices个顶点、包含maxTriangles个三角形，从空间上相邻的三角形开始，
+	// 优先加入共享顶点多、距离近且朝向一致的三角形，使包围球与法线锥尽量紧凑
+	// 按索引连通且不超过上限的小块网格整块放入同一个簇，块内的顶点不会在簇之间重复
+	void BuildMeshlets(ObjReader::ObjPart& part, UINT maxVertices = kMeshletMaxVertices, UINT maxTriangles = kMeshletMaxTriangles);
+
+	// 将使用32位索引且顶点数超过maxVertices的部分拆分为可使用16位索引的子网格，子网格共享原部分的材质与纹理
+	// 使用32位索引但顶点数不超过maxVertices的部分(如恰好65535个顶点)不拆分，直接改用16位索引
+	// 三角形按重心的Morton码顺序依次填入子网格，每个子网格对应空间上紧凑的一块，子网格按顺序替换原部分
+	// 需要在GenerateLods与BuildMeshlets之前调用，被拆分部分已有的LOD与簇会被丢弃，可选地返回统计
+	// 之后还要生成LOD时，maxVertices需要为GenerateLods追加的顶点留出余量，见LodVertexBudget
+	void SplitLargeParts(std::vector<ObjReader::ObjPart>& parts, SplitStats* stats = nullptr, UINT maxVertices = kSubmeshMaxVertices);
+
+	// 拆分后再以ratios生成LOD时子网格的顶点数上限
+	// 追加的顶点不超过第一级LOD引用的顶点，约为原始顶点数的ratios[0]倍，据此预留余量
+	UINT LodVertexBudget(const float* ratios, size_t ratioCount);
+
+	// 将材质与漫射光纹理都相同的部分合并为一个部分，减少绘制调用；合并后的部分使用共享的顶点池，
+	// 各部分中字节完全相同的顶点(如组与组交界处的顶点)只保留一份，顶点数不超过65534时使用16位索引
+	// 合并后的部分位于该材质首次出现的位置，三角形按原部分的顺序排列，不同材质的部分之间的绘制顺序可能改变
+	// 需要在SplitLargeParts、GenerateLods与BuildMeshlets之前调用，被合并部分已有的LOD与簇会被丢弃，可选地返回统计
+	void MergePartsByMaterial(std::vector<ObjReader::ObjPart>& parts, MergeStats* stats = nullptr);
+}
+
+#endif
@@ -0,0 +1,39 @@
+#include "MeshRegistry.h"
+#include <cstring>
+
+MeshRegistry::MeshRegistry(IndexBufferCache* indexCache)
+	: m_pIndexCache(indexCache), m_Models(), m_Stats()
+{
+}
+
+void MeshRegistry::Clear()
+{
+	m_Models.clear();
+}
+
+bool MeshRegistry::Key::operator==(const Key& other) const
+{
+	// 浮点参数按位比较，只有完全相同的参数才共用网格
+	return shape == other.shape && vertexLayout == other.vertexLayout && indexSize == other.indexSize &&
+		!memcmp(params, other.params, sizeof(params)) && !memcmp(slices, other.slices, sizeof(slices)) &&
+		!memcmp(&color, &other.color, sizeof(color));
+}
+
+size_t MeshRegistry::KeyHash::operator()(const Key& key) const
+{
+	// FNV-1a，逐个字段处理以避开结构体中的填充字节
+	size_t hash = 2166136261u;
+	auto combine = [&hash](const void* data, size_t size)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; ++i)
+			hash = (hash ^ bytes[i]) * 16777619u;
+	};
+	combine(&key.shape, sizeof(key.shape));
+	combine(&key.vertexLayout, sizeof(key.vertexLayout));
+	combine(&key.indexSize, sizeof(key.indexSize));
+	combine(key.params, sizeof(key.params));
+	combine(key.slices, sizeof(key.slices));
+	combine(&key.color, sizeof(key.color));
+	return hash;
+}
@@ -0,0 +1,170 @@
+//***************************************************************************************
+// MeshRegistry.h
+// Licensed under the MIT License.
+//
+// 按参数缓存Geometry生成的网格模型，参数相同的对象共用同一份顶点/索引缓冲区
+// Memoizes procedural Geometry meshes by parameters so objects share their GPU buffers.
+//***************************************************************************************
+
+#ifndef MESHREGISTRY_H
+#define MESHREGISTRY_H
+
+#include <unordered_map>
+#include "Model.h"
+
+// 每种参数组合只生成并上传一次网格，返回的Model与注册表中的Model共用缓冲区(ComPtr引用计数)，
+// 复制给多个D3DObject也不会再创建缓冲区
+// 注册表只对应一个设备，不是线程安全的；Clear之后已分发的Model仍然有效
+class MeshRegistry
+{
+public:
+	enum class Shape : UINT
+	{
+		Box,
+		Sphere,
+		Cylinder,
+		Cone,
+		Plane
+	};
+
+	struct Stats
+	{
+		UINT hits;		// 直接返回已有网格的次数
+		UINT misses;	// 生成网格并创建缓冲区的次数
+	};
+
+	// indexCache不为nullptr时，球体与平面的索引缓冲区按拓扑共享，半径、尺寸不同的网格也共用
+	explicit MeshRegistry(IndexBufferCache* indexCache = nullptr);
+
+	MeshRegistry(const MeshRegistry&) = delete;
+	MeshRegistry& operator=(const MeshRegistry&) = delete;
+
+	// 参数与默认值同Geometry中对应的方法
+	template<class VertexType = VertexPosNormalTex, class IndexType = DWORD>
+	const Model& GetBox(ID3D11Device * device, float width = 2.0f, float height = 2.0f, float depth = 2.0f,
+		const DirectX::XMFLOAT4& color = { 1.0f, 1.0f, 1.0f, 1.0f });
+	template<class VertexType = VertexPosNormalTex, class IndexType = DWORD>
+	const Model& GetSphere(ID3D11Device * device, float radius = 1.0f, UINT levels = 20, UINT slices = 20,
+		const DirectX::XMFLOAT4& color = { 1.0f, 1.0f, 1.0f, 1.0f });
+	template<class VertexType = VertexPosNormalTex, class IndexType = DWORD>
+	const Model& GetCylinder(ID3D11Device * device, float radius = 1.0f, float height = 2.0f, UINT slices = 20,
+		const DirectX::XMFLOAT4& color = { 1.0f, 1.0f, 1.0f, 1.0f });
+	template<class VertexType = VertexPosNormalTex, class IndexType = DWORD>
+	const Model& GetCone(ID3D11Device * device, float radius = 1.0f, float height = 2.0f, UINT slices = 20,
+		const DirectX::XMFLOAT4& color = { 1.0f, 1.0f, 1.0f, 1.0f });
+	template<class VertexType = VertexPosNormalTex, class IndexType = DWORD>
+	const Model& GetPlane(ID3D11Device * device, float width = 10.0f, float depth = 10.0f, float texU = 1.0f, float texV = 1.0f,
+		const DirectX::XMFLOAT4& color = { 1.0f, 1.0f, 1.0f, 1.0f });
+
+	// 释放注册表持有的模型
+	void Clear();
+	const Stats& GetStats() const { return m_Stats; }
+	size_t GetMeshCount() const { return m_Models.size(); }
+
+private:
+	struct Key
+	{
+		Shape shape;
+		const void* vertexLayout;	// 顶点类型的输入布局，每种顶点类型各不相同
+		UINT indexSize;
+		float params[4];
+		UINT slices[2];
+		DirectX::XMFLOAT4 color;
+
+		bool operator==(const Key& other) const;
+	};
+
+	struct KeyHash
+	{
+		size_t operator()(const Key& key) const;
+	};
+
+	template<class VertexType, class IndexType>
+	static Key MakeKey(Shape shape, float p0, float p1, float p2, float p3, UINT s0, UINT s1, const DirectX::XMFLOAT4& color);
+
+	// 未命中时调用createModel()生成网格并创建缓冲区
+	template<class Func>
+	const Model& GetOrCreate(const Key& key, Func&& createModel);
+
+	IndexBufferCache* m_pIndexCache;
+	std::unordered_map<Key, Model, KeyHash> m_Models;
+	Stats m_Stats;
+};
+
+template<class VertexType, class IndexType>
+inline MeshRegistry::Key MeshRegistry::MakeKey(Shape shape, float p0, float p1, float p2, float p3,
+	UINT s0, UINT s1, const DirectX::XMFLOAT4& color)
+{
+	return Key{ shape, VertexType::inputLayout, (UINT)sizeof(IndexType), { p0, p1, p2, p3 }, { s0, s1 }, color };
+}
+
+template<class Func>
+inline const Model& MeshRegistry::GetOrCreate(const Key& key, Func&& createModel)
+{
+	auto it = m_Models.find(key);
+	if (it != m_Models.end())
+	{
+		++m_Stats.hits;
+		return it->second;
+	}
+	++m_Stats.misses;
+	return m_Models.emplace(key, createModel()).first->second;
+}
+
+template<class VertexType, class IndexType>
+inline const Model& MeshRegistry::GetBox(ID3D11Device * device, float width, float height, float depth,
+	const DirectX::XMFLOAT4& color)
+{
+	return GetOrCreate(MakeKey<VertexType, IndexType>(Shape::Box, width, height, depth, 0.0f, 0, 0, color), [&]()
+	{
+		return Model(device, Geometry::CreateBox<VertexType, IndexType>(width, height, depth, color));
+	});
+}
+
+template<class VertexType, class IndexType>
+inline const Model& MeshRegistry::GetSphere(ID3D11Device * device, float radius, UINT levels, UINT slices,
+	const DirectX::XMFLOAT4& color)
+{
+	return GetOrCreate(MakeKey<VertexType, IndexType>(Shape::Sphere, radius, 0.0f, 0.0f, 0.0f, levels, slices, color), [&]()
+	{
+		auto meshData = Geometry::CreateSphere<VertexType, IndexType>(radius, levels, slices, color);
+		if (!m_pIndexCache)
+			return Model(device, meshData);
+		return Model(device, meshData.vertexVec, m_pIndexCache->GetSphere<IndexType>(device, levels, slices));
+	});
+}
+
+template<class VertexType, class IndexType>
+inline const Model& MeshRegistry::GetCylinder(ID3D11Device * device, float radius, float height, UINT slices,
+	const DirectX::XMFLOAT4& color)
+{
+	return GetOrCreate(MakeKey<VertexType, IndexType>(Shape::Cylinder, radius, height, 0.0f, 0.0f, slices, 0, color), [&]()
+	{
+		return Model(device, Geometry::CreateCylinder<VertexType, IndexType>(radius, height, slices, color));
+	});
+}
+
+template<class VertexType, class IndexType>
+inline const Model& MeshRegistry::GetCone(ID3D11Device * device, float radius, float height, UINT slices,
+	const DirectX::XMFLOAT4& color)
+{
+	return GetOrCreate(MakeKey<VertexType, IndexType>(Shape::Cone, radius, height, 0.0f, 0.0f, slices, 0, color), [&]()
+	{
+		return Model(device, Geometry::CreateCone<VertexType, IndexType>(radius, height, slices, color));
+	});
+}
+
+template<class VertexType, class IndexType>
+inline const Model& MeshRegistry::GetPlane(ID3D11Device * device, float width, float depth, float texU, float texV,
+	const DirectX::XMFLOAT4& color)
+{
+	return GetOrCreate(MakeKey<VertexType, IndexType>(Shape::Plane, width, depth, texU, texV, 0, 0, color), [&]()
+	{
+		auto meshData = Geometry::CreatePlane<VertexType, IndexType>(width, depth, texU, texV, color);
+		if (!m_pIndexCache)
+			return Model(device, meshData);
+		return Model(device, meshData.vertexVec, m_pIndexCache->GetPlane<IndexType>(device));
+	});
+}
+
+#endif
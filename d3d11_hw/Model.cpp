@@ -1,4 +1,5 @@
 #include "Model.h"
+#include "MeshOptimizer.h"
 #include "d3dUtil.h"
 #include "DXTrace.h"
 
@@ -15,6 +16,18 @@ Model::Model(ID3D11Device * device, const ObjReader & model)
 	SetModel(device, model);
 }
 
+Model::Model(ID3D11Device * device, ObjReader && model)
+	: modelParts(), boundingBox(), vertexStride()
+{
+	SetModel(device, std::move(model));
+}
+
+Model::Model(ID3D11Device * device, const MboView & model)
+	: modelParts(), boundingBox(), vertexStride()
+{
+	SetModel(device, model);
+}
+
 Model::Model(ID3D11Device * device, const void* vertices, UINT vertexSize, UINT vertexCount,
 	const void * indices, UINT indexCount, DXGI_FORMAT indexFormat)
 	: modelParts(), boundingBox(), vertexStride()
@@ -22,6 +35,13 @@ Model::Model(ID3D11Device * device, const void* vertices, UINT vertexSize, UINT
 	SetMesh(device, vertices, vertexSize, vertexCount, indices, indexCount, indexFormat);
 }
 
+Model::Model(ID3D11Device * device, const void* vertices, UINT vertexSize, UINT vertexCount,
+	const IndexBufferCache::SharedIndexBuffer& indexBuffer)
+	: modelParts(), boundingBox(), vertexStride()
+{
+	SetMesh(device, vertices, vertexSize, vertexCount, indexBuffer);
+}
+
 void Model::SetModel(ID3D11Device * device, const ObjReader & model)
 {
 	vertexStride = sizeof(VertexPosNormalTex);
@@ -33,78 +53,272 @@ void Model::SetModel(ID3D11Device * device, const ObjReader & model)
 
 	for (size_t i = 0; i < model.objParts.size(); ++i)
 	{
-		auto part = model.objParts[i];
-
-		modelParts[i].vertexCount = (UINT)part.vertices.size();
-		// 设置顶点缓冲区描述
-		D3D11_BUFFER_DESC vbd;
-		ZeroMemory(&vbd, sizeof(vbd));
-		vbd.Usage = D3D11_USAGE_IMMUTABLE;
-		vbd.ByteWidth = modelParts[i].vertexCount * (UINT)sizeof(VertexPosNormalTex);
-		vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-		vbd.CPUAccessFlags = 0;
-		// 新建顶点缓冲区
-		D3D11_SUBRESOURCE_DATA InitData;
-		ZeroMemory(&InitData, sizeof(InitData));
-		InitData.pSysMem = part.vertices.data();
-		HR(device->CreateBuffer(&vbd, &InitData, modelParts[i].vertexBuffer.ReleaseAndGetAddressOf()));
-
-		// 设置索引缓冲区描述
-		D3D11_BUFFER_DESC ibd;
-		ZeroMemory(&ibd, sizeof(ibd));
-		ibd.Usage = D3D11_USAGE_IMMUTABLE;
-		ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
-		ibd.CPUAccessFlags = 0;
-		if (modelParts[i].vertexCount > 65535)
+		SetModelPart(device, modelParts[i], model.objParts[i]);
+	}
+}
+
+void Model::SetModel(ID3D11Device * device, ObjReader && model)
+{
+	vertexStride = sizeof(VertexPosNormalTex);
+
+	modelParts.resize(model.objParts.size());
+
+	// 创建包围盒
+	BoundingBox::CreateFromPoints(boundingBox, XMLoadFloat3(&model.vMin), XMLoadFloat3(&model.vMax));
+
+	for (size_t i = 0; i < model.objParts.size(); ++i)
+	{
+		auto& part = model.objParts[i];
+		SetModelPart(device, modelParts[i], part);
+		// 初始数据在CreateBuffer返回后已不再需要，立即归还以降低峰值内存
+		std::vector<VertexPosNormalTex>().swap(part.vertices);
+		std::vector<WORD>().swap(part.indices16);
+		std::vector<DWORD>().swap(part.indices32);
+		std::vector<ObjReader::ObjLod>().swap(part.lods);
+		std::vector<ObjReader::ObjMeshlet>().swap(part.meshlets);
+	}
+
+	model.ReleaseGeometry();
+}
+
+void Model::SetModel(ID3D11Device * device, const MboView & model)
+{
+	vertexStride = sizeof(VertexPosNormalTex);
+
+	modelParts.resize(model.parts.size());
+
+	// 创建包围盒
+	BoundingBox::CreateFromPoints(boundingBox, XMLoadFloat3(&model.vMin), XMLoadFloat3(&model.vMax));
+
+	// 顶点与索引直接来自文件映射，不经过中间拷贝
+	for (size_t i = 0; i < model.parts.size(); ++i)
+	{
+		const auto& part = model.parts[i];
+		SetModelPart(device, modelParts[i], part.vertices, part.vertexCount, part.indices, part.indexCount,
+			part.indexSize == sizeof(DWORD) ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT,
+			part.lods, part.meshlets, part.bounds, part.material, part.texStrDiffuse);
+	}
+}
+
+bool Model::SetModelStreaming(ID3D11Device * device, const wchar_t * objFileName)
+{
+	vertexStride = sizeof(VertexPosNormalTex);
+
+	modelParts.clear();
+
+	ObjReader reader;
+	bool succeeded = reader.ReadObjStreaming(objFileName, [&](size_t partIndex, ObjReader::ObjPart& part)
+	{
+		// 解析线程此时已经在处理后面的部分
+		MeshOptimizer::OptimizePart(part);
+		modelParts.resize(partIndex + 1);
+		SetModelPart(device, modelParts[partIndex], part);
+		return true;
+	});
+
+	// 包围盒要等全部顶点解析完才能确定
+	BoundingBox::CreateFromPoints(boundingBox, XMLoadFloat3(&reader.vMin), XMLoadFloat3(&reader.vMax));
+	return succeeded;
+}
+
+void Model::SetModelPart(ID3D11Device * device, ModelPart & modelPart, const ObjReader::ObjPart & part)
+{
+	// 索引宽度以实际存储的索引数组为准
+	bool use32 = !part.indices32.empty();
+	std::vector<MboView::LodView> lods(part.lods.size());
+	for (size_t i = 0; i < part.lods.size(); ++i)
+	{
+		const auto& lod = part.lods[i];
+		lods[i].indices = use32 ? static_cast<const void*>(lod.indices32.data()) : static_cast<const void*>(lod.indices16.data());
+		lods[i].indexCount = (UINT)(use32 ? lod.indices32.size() : lod.indices16.size());
+		lods[i].error = lod.error;
+	}
+
+	if (use32)
+	{
+		SetModelPart(device, modelPart, part.vertices.data(), (UINT)part.vertices.size(),
+			part.indices32.data(), (UINT)part.indices32.size(), DXGI_FORMAT_R32_UINT,
+			lods, part.meshlets, part.bounds, part.material, part.texStrDiffuse);
+	}
+	else
+	{
+		SetModelPart(device, modelPart, part.vertices.data(), (UINT)part.vertices.size(),
+			part.indices16.data(), (UINT)part.indices16.size(), DXGI_FORMAT_R16_UINT,
+			lods, part.meshlets, part.bounds, part.material, part.texStrDiffuse);
+	}
+}
+
+void Model::SetModelPart(ID3D11Device * device, ModelPart & modelPart, const void * vertices, UINT vertexCount,
+	const void * indices, UINT indexCount, DXGI_FORMAT indexFormat, const std::vector<MboView::LodView>& lods,
+	const std::vector<ModelPart::Meshlet>& meshlets, const ObjReader::ObjBounds& bounds,
+	const Material & material, const std::wstring & texStrDiffuse)
+{
+	modelPart.vertexCount = vertexCount;
+	// 设置顶点缓冲区描述
+	D3D11_BUFFER_DESC vbd;
+	ZeroMemory(&vbd, sizeof(vbd));
+	vbd.Usage = D3D11_USAGE_IMMUTABLE;
+	vbd.ByteWidth = vertexCount * (UINT)sizeof(VertexPosNormalTex);
+	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	vbd.CPUAccessFlags = 0;
+	// 新建顶点缓冲区
+	D3D11_SUBRESOURCE_DATA InitData;
+	ZeroMemory(&InitData, sizeof(InitData));
+	InitData.pSysMem = vertices;
+	HR(device->CreateBuffer(&vbd, &InitData, modelPart.vertexBuffer.ReleaseAndGetAddressOf()));
+
+	// 设置索引缓冲区描述
+	D3D11_BUFFER_DESC ibd;
+	ZeroMemory(&ibd, sizeof(ibd));
+	ibd.Usage = D3D11_USAGE_IMMUTABLE;
+	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	ibd.CPUAccessFlags = 0;
+	modelPart.indexCount = indexCount;
+	modelPart.indexFormat = indexFormat;
+	UINT indexSize = indexFormat == DXGI_FORMAT_R32_UINT ? (UINT)sizeof(DWORD) : (UINT)sizeof(WORD);
+	ibd.ByteWidth = indexCount * indexSize;
+	InitData.pSysMem = indices;
+	// 有LOD链时各级索引位于原始网格之后
+	// .mbo中的各级索引在内存中本来就紧接原始网格的索引，整段直接作为初始数据，否则先拼接
+	std::vector<BYTE> lodIndices;
+	modelPart.lods.clear();
+	modelPart.lodIndex = 0;
+	if (!lods.empty())
+	{
+		modelPart.lods.push_back({ 0, indexCount, 0.0f });
+		UINT totalCount = indexCount;
+		bool contiguous = true;
+		for (const auto& lod : lods)
+		{
+			if (lod.indexCount && lod.indices != static_cast<const BYTE*>(indices) + (size_t)totalCount * indexSize)
+				contiguous = false;
+			modelPart.lods.push_back({ totalCount, lod.indexCount, lod.error });
+			totalCount += lod.indexCount;
+		}
+		if (!contiguous)
 		{
-			modelParts[i].indexCount = (UINT)part.indices32.size();
-			modelParts[i].indexFormat = DXGI_FORMAT_R32_UINT;
-			ibd.ByteWidth = modelParts[i].indexCount * (UINT)sizeof(DWORD);
-			InitData.pSysMem = part.indices32.data();
+			lodIndices.resize((size_t)totalCount * indexSize);
+			memcpy(lodIndices.data(), indices, (size_t)indexCount * indexSize);
+			for (size_t i = 0; i < lods.size(); ++i)
+			{
+				memcpy(lodIndices.data() + (size_t)modelPart.lods[i + 1].startIndex * indexSize, lods[i].indices,
+					(size_t)lods[i].indexCount * indexSize);
+			}
+			InitData.pSysMem = lodIndices.data();
+		}
+		ibd.ByteWidth = totalCount * indexSize;
+	}
+	// 新建索引缓冲区
+	HR(device->CreateBuffer(&ibd, &InitData, modelPart.indexBuffer.ReleaseAndGetAddressOf()));
 
+	// 剔除之前绘制全部的簇
+	modelPart.meshlets = meshlets;
+	modelPart.visibleRanges.clear();
+	if (!meshlets.empty())
+		modelPart.visibleRanges.push_back({ 0, indexCount });
+
+	BoundingBox::CreateFromPoints(modelPart.boundingBox, XMLoadFloat3(&bounds.vMin), XMLoadFloat3(&bounds.vMax));
+	modelPart.boundingSphere = BoundingSphere(bounds.center, bounds.radius);
+	modelPart.visible = true;
+
+	
+	// 创建漫射光对应纹理
+	auto& strD = texStrDiffuse;
+	if (strD.size() > 4)
+	{
+		if (strD.substr(strD.size() - 3, 3) == L"dds")
+		{
+			HR(CreateDDSTextureFromFile(device, strD.c_str(), nullptr,
+				modelPart.texDiffuse.GetAddressOf()));
 		}
 		else
 		{
-			modelParts[i].indexCount = (UINT)part.indices16.size();
-			modelParts[i].indexFormat = DXGI_FORMAT_R16_UINT;
-			ibd.ByteWidth = modelParts[i].indexCount * (UINT)sizeof(WORD);
-			InitData.pSysMem = part.indices16.data();
+			HR(CreateWICTextureFromFile(device, strD.c_str(), nullptr,
+				modelPart.texDiffuse.GetAddressOf()));
 		}
-		// 新建索引缓冲区
-		HR(device->CreateBuffer(&ibd, &InitData, modelParts[i].indexBuffer.ReleaseAndGetAddressOf()));
+	}
+
+	modelPart.material = material;
+}
 
-		
-		// 创建漫射光对应纹理
-		auto& strD = part.texStrDiffuse;
-		if (strD.size() > 4)
+UINT ModelPart::SelectLod(float maxError) const
+{
+	UINT lod = 0;
+	while (lod + 1 < (UINT)lods.size() && lods[lod + 1].error <= maxError)
+		++lod;
+	return lod;
+}
+
+bool XM_CALLCONV ModelPart::IntersectsFrustum(const XMVECTOR planes[6]) const
+{
+	return SphereIntersectsFrustum(XMLoadFloat3(&boundingSphere.Center), boundingSphere.Radius, planes) &&
+		BoxIntersectsFrustum(XMLoadFloat3(&boundingBox.Center), XMLoadFloat3(&boundingBox.Extents), planes);
+}
+
+void XM_CALLCONV ModelPart::CullMeshlets(FXMVECTOR eyePos, const XMVECTOR planes[6])
+{
+	visibleRanges.clear();
+	visible = IntersectsFrustum(planes);
+	if (!visible)
+		return;
+	for (const auto& meshlet : meshlets)
+	{
+		XMVECTOR center = XMLoadFloat3(&meshlet.center);
+		bool visible = SphereIntersectsFrustum(center, meshlet.radius, planes);
+
+		// 法向量与轴向夹角不超过a的三角形，在观察方向与轴向夹角b满足cos(a + b) * 距离 >= 半径时全部背向观察者
+		if (visible && meshlet.coneCutoff > 0.0f)
 		{
-			if (strD.substr(strD.size() - 3, 3) == L"dds")
+			XMVECTOR toCenter = center - eyePos;
+			float distance = XMVectorGetX(XMVector3Length(toCenter));
+			if (distance > meshlet.radius)
 			{
-				HR(CreateDDSTextureFromFile(device, strD.c_str(), nullptr,
-					modelParts[i].texDiffuse.GetAddressOf()));
-			}
-			else
-			{
-				HR(CreateWICTextureFromFile(device, strD.c_str(), nullptr,
-					modelParts[i].texDiffuse.GetAddressOf()));
+				float cosB = XMVectorGetX(XMVector3Dot(toCenter, XMLoadFloat3(&meshlet.coneAxis))) / distance;
+				float sinB = sqrtf((std::max)(1.0f - cosB * cosB, 0.0f));
+				float sinA = sqrtf(1.0f - meshlet.coneCutoff * meshlet.coneCutoff);
+				visible = (cosB * meshlet.coneCutoff - sinB * sinA) * distance < meshlet.radius;
 			}
 		}
 
-		modelParts[i].material = part.material;
+		if (!visible)
+			continue;
+		if (!visibleRanges.empty() && visibleRanges.back().startIndex + visibleRanges.back().indexCount == meshlet.startIndex)
+			visibleRanges.back().indexCount += meshlet.indexCount;
+		else
+			visibleRanges.push_back({ meshlet.startIndex, meshlet.indexCount });
 	}
-
-
 }
 
 void Model::SetMesh(ID3D11Device * device, const void * vertices, UINT vertexSize, UINT vertexCount, const void * indices, UINT indexCount, DXGI_FORMAT indexFormat)
+{
+	// 新建索引缓冲区，由该模型独占
+	IndexBufferCache::SharedIndexBuffer indexBuffer;
+	indexBuffer.buffer = IndexBufferCache::CreateIndexBuffer(device, indices, indexCount, indexFormat);
+	indexBuffer.indexCount = indexCount;
+	indexBuffer.indexFormat = indexFormat;
+	SetMesh(device, vertices, vertexSize, vertexCount, indexBuffer);
+}
+
+void Model::SetMesh(ID3D11Device * device, const void * vertices, UINT vertexSize, UINT vertexCount,
+	const IndexBufferCache::SharedIndexBuffer & indexBuffer)
 {
 	vertexStride = vertexSize;
 
 	modelParts.resize(1);
 
 	modelParts[0].vertexCount = vertexCount;
-	modelParts[0].indexCount = indexCount;
-	modelParts[0].indexFormat = indexFormat;
+	modelParts[0].indexCount = indexBuffer.indexCount;
+	modelParts[0].indexFormat = indexBuffer.indexFormat;
+	modelParts[0].lods.clear();
+	modelParts[0].lodIndex = 0;
+	modelParts[0].meshlets.clear();
+	modelParts[0].visibleRanges.clear();
+	modelParts[0].visible = true;
+
+	// 各种顶点结构都以位置开头
+	ObjReader::ObjBounds bounds = ObjReader::ComputeBounds(vertices, vertexCount, vertexSize);
+	BoundingBox::CreateFromPoints(modelParts[0].boundingBox, XMLoadFloat3(&bounds.vMin), XMLoadFloat3(&bounds.vMax));
+	modelParts[0].boundingSphere = BoundingSphere(bounds.center, bounds.radius);
 
 	modelParts[0].material.ambient = XMFLOAT4(0.2f, 0.2f, 0.2f, 1.0f);
 	modelParts[0].material.diffuse = XMFLOAT4(0.8f, 0.8f, 0.8f, 1.0f);
@@ -123,24 +337,8 @@ void Model::SetMesh(ID3D11Device * device, const void * vertices, UINT vertexSiz
 	InitData.pSysMem = vertices;
 	HR(device->CreateBuffer(&vbd, &InitData, modelParts[0].vertexBuffer.ReleaseAndGetAddressOf()));
 
-	// 设置索引缓冲区描述
-	D3D11_BUFFER_DESC ibd;
-	ZeroMemory(&ibd, sizeof(ibd));
-	ibd.Usage = D3D11_USAGE_IMMUTABLE;
-	if (indexFormat == DXGI_FORMAT_R16_UINT)
-	{
-		ibd.ByteWidth = indexCount * (UINT)sizeof(WORD);
-	}
-	else
-	{
-		ibd.ByteWidth = indexCount * (UINT)sizeof(DWORD);
-	}
-	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	ibd.CPUAccessFlags = 0;
-	// 新建索引缓冲区
-	InitData.pSysMem = indices;
-	HR(device->CreateBuffer(&ibd, &InitData, modelParts[0].indexBuffer.ReleaseAndGetAddressOf()));
-
+	// 索引缓冲区只增加引用
+	modelParts[0].indexBuffer = indexBuffer.buffer;
 }
 
 void Model::SetDebugObjectName(const std::string& name)
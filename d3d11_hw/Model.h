@@ -13,6 +13,7 @@
 #include "Effects.h"
 #include "ObjReader.h"
 #include "Geometry.h"
+#include "IndexBufferCache.h"
 
 struct ModelPart
 {
@@ -20,8 +21,27 @@ struct ModelPart
 	template <class T>
 	using ComPtr = Microsoft::WRL::ComPtr<T>;
 
+	// 细节级别在索引缓冲区中的范围
+	struct Lod
+	{
+		UINT startIndex;
+		UINT indexCount;
+		float error;			// 相对原始网格的近似最大偏差(模型空间)，原始网格为0
+	};
+
+	// 索引缓冲区中连续的一段索引
+	struct IndexRange
+	{
+		UINT startIndex;
+		UINT indexCount;
+	};
+
+	// 原始网格的三角形簇，包围球与法线锥位于模型空间
+	using Meshlet = ObjReader::ObjMeshlet;
+
 	ModelPart() : material(), texDiffuse(), vertexBuffer(), indexBuffer(),
-		vertexCount(), indexCount(), indexFormat() {}
+		vertexCount(), indexCount(), indexFormat(), lods(), lodIndex(), meshlets(), visibleRanges(),
+		boundingBox(), boundingSphere(), visible(true) {}
 
 	ModelPart(const ModelPart&) = default;
 	ModelPart& operator=(const ModelPart&) = default;
@@ -35,8 +55,23 @@ struct ModelPart
 	ComPtr<ID3D11Buffer> vertexBuffer;
 	ComPtr<ID3D11Buffer> indexBuffer;
 	UINT vertexCount;
-	UINT indexCount;
+	UINT indexCount;			// 原始网格的索引数
 	DXGI_FORMAT indexFormat;
+	std::vector<Lod> lods;		// 由细到粗，lods[0]为原始网格，没有LOD链时为空
+	UINT lodIndex;				// 绘制时使用的级别
+	std::vector<Meshlet> meshlets;			// 按索引顺序覆盖原始网格，没有时为空
+	std::vector<IndexRange> visibleRanges;	// 原始网格中未被剔除的簇，相邻的簇已合并
+	DirectX::BoundingBox boundingBox;		// 模型空间
+	DirectX::BoundingSphere boundingSphere;
+	bool visible;							// 最近一次剔除时是否与视锥相交
+
+	// 返回误差不超过maxError的最粗级别
+	UINT SelectLod(float maxError) const;
+	// 以包围球与包围盒检测部分是否可能与视锥相交，planes同CullMeshlets
+	bool XM_CALLCONV IntersectsFrustum(const DirectX::XMVECTOR planes[6]) const;
+	// 先按包围体剔除整个部分并更新visible，部分可见时再剔除位于视锥外或整体背向观察者的簇，更新visibleRanges
+	// eyePos与planes(ExtractFrustumPlanes得到的视锥平面，见d3dUtil.h)都位于模型空间
+	void XM_CALLCONV CullMeshlets(DirectX::FXMVECTOR eyePos, const DirectX::XMVECTOR planes[6]);
 };
 
 struct Model
@@ -47,6 +82,8 @@ struct Model
 	
 	Model();
 	Model(ID3D11Device * device, const ObjReader& model);
+	Model(ID3D11Device * device, ObjReader&& model);
+	Model(ID3D11Device * device, const MboView& model);
 	// 设置缓冲区
 	template<class VertexType, class IndexType>
 	Model(ID3D11Device * device, const Geometry::MeshData<VertexType, IndexType>& meshData);
@@ -57,11 +94,24 @@ struct Model
 	
 	Model(ID3D11Device * device, const void* vertices, UINT vertexSize, UINT vertexCount,
 		const void * indices, UINT indexCount, DXGI_FORMAT indexFormat);
+
+	// 使用共享的索引缓冲区(见IndexBufferCache)，只创建顶点缓冲区
+	template<class VertexType>
+	Model(ID3D11Device * device, const std::vector<VertexType> & vertices, const IndexBufferCache::SharedIndexBuffer& indexBuffer);
+	Model(ID3D11Device * device, const void* vertices, UINT vertexSize, UINT vertexCount,
+		const IndexBufferCache::SharedIndexBuffer& indexBuffer);
 	//
 	// 设置模型
 	//
 
 	void SetModel(ID3D11Device * device, const ObjReader& model);
+	// 每创建完一个部分的缓冲区就释放其顶点与索引，结束后model不再持有几何数据
+	void SetModel(ID3D11Device * device, ObjReader&& model);
+	// 直接使用映射的.mbo数据创建缓冲区，CPU端不保留几何数据的拷贝
+	void SetModel(ID3D11Device * device, const MboView& model);
+	// 流式读取.obj，每解析完一个部分就优化其网格并创建缓冲区，与后续部分的解析重叠
+	// CPU端只保留全局的顶点属性与少数几个待处理部分的几何数据，不保留整个文件与原始的面，失败时返回false
+	bool SetModelStreaming(ID3D11Device * device, const wchar_t * objFileName);
 
 	//
 	// 设置网格
@@ -75,6 +125,12 @@ struct Model
 	void SetMesh(ID3D11Device * device, const void* vertices, UINT vertexSize, UINT vertexCount,
 		const void * indices, UINT indexCount, DXGI_FORMAT indexFormat);
 
+	// 索引缓冲区只增加引用，与其它模型共用
+	template<class VertexType>
+	void SetMesh(ID3D11Device * device, const std::vector<VertexType> & vertices, const IndexBufferCache::SharedIndexBuffer& indexBuffer);
+	void SetMesh(ID3D11Device * device, const void* vertices, UINT vertexSize, UINT vertexCount,
+		const IndexBufferCache::SharedIndexBuffer& indexBuffer);
+
 	//
 	// 调试 
 	//
@@ -86,6 +142,14 @@ struct Model
 	std::vector<ModelPart> modelParts;
 	DirectX::BoundingBox boundingBox;
 	UINT vertexStride;
+
+private:
+	static void SetModelPart(ID3D11Device * device, ModelPart& modelPart, const ObjReader::ObjPart& part);
+	// 各级LOD的索引与原始网格的索引依次放在同一个索引缓冲区中
+	static void SetModelPart(ID3D11Device * device, ModelPart& modelPart, const void* vertices, UINT vertexCount,
+		const void* indices, UINT indexCount, DXGI_FORMAT indexFormat, const std::vector<MboView::LodView>& lods,
+		const std::vector<ModelPart::Meshlet>& meshlets, const ObjReader::ObjBounds& bounds,
+		const Material& material, const std::wstring& texStrDiffuse);
 };
 
 
@@ -105,6 +169,13 @@ inline Model::Model(ID3D11Device * device, const std::vector<VertexType> & verti
 	SetMesh(device, vertices, indices);
 }
 
+template<class VertexType>
+inline Model::Model(ID3D11Device * device, const std::vector<VertexType> & vertices, const IndexBufferCache::SharedIndexBuffer& indexBuffer)
+	: modelParts(), boundingBox(), vertexStride()
+{
+	SetMesh(device, vertices, indexBuffer);
+}
+
 template<class VertexType, class IndexType>
 inline void Model::SetMesh(ID3D11Device * device, const Geometry::MeshData<VertexType, IndexType>& meshData)
 {
@@ -122,6 +193,12 @@ inline void Model::SetMesh(ID3D11Device * device, const std::vector<VertexType>
 
 }
 
+template<class VertexType>
+inline void Model::SetMesh(ID3D11Device * device, const std::vector<VertexType> & vertices, const IndexBufferCache::SharedIndexBuffer& indexBuffer)
+{
+	SetMesh(device, vertices.data(), sizeof(VertexType), (UINT)vertices.size(), indexBuffer);
+}
+
 
 
 #endif
@@ -1,213 +1,2444 @@
 #include "ObjReader.h"
+#include "MboCodec.h"
+#include "MeshOptimizer.h"
+#include "ThreadPool.h"
+#include <cfloat>
+#include <clocale>
+#include <cstddef>
+#include <cstdlib>
+#include <random>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <codecvt>
+#include <sys/stat.h>
+#ifdef __APPLE__
+#include <xlocale.h>
+#endif
+#endif
 
 using namespace DirectX;
-bool ObjReader::Read(const wchar_t * mboFileName, const wchar_t * objFileName)
+
+namespace
 {
-	if (mboFileName && ReadMbo(mboFileName))
+	//
+	// 以下函数用于在内存中直接扫描.obj文件的字节流
+	// 不依赖locale，且解析过程中不产生任何堆分配
+	//
+
+	inline bool IsBlank(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+	}
+
+	inline bool IsDigit(char c)
+	{
+		return c >= '0' && c <= '9';
+	}
+
+	// 跳过行内空白(不跨行)
+	inline const char* SkipBlank(const char* p, const char* end)
+	{
+		while (p < end && IsBlank(*p))
+			++p;
+		return p;
+	}
+
+	// 跳到下一行的开头
+	inline const char* SkipLine(const char* p, const char* end)
+	{
+		const char* nl = static_cast<const char*>(memchr(p, '\n', end - p));
+		return nl ? nl + 1 : end;
+	}
+
+	// 获取当前词的结尾
+	inline const char* TokenEnd(const char* p, const char* end)
+	{
+		while (p < end && !IsBlank(*p) && *p != '\n')
+			++p;
+		return p;
+	}
+
+	// 获取去掉前后空白后的行内容[beg, ed)
+	inline const char* TrimmedLine(const char* p, const char* end, const char*& beg)
+	{
+		beg = SkipBlank(p, end);
+		const char* ed = beg;
+		while (ed < end && *ed != '\n')
+			++ed;
+		while (ed > beg && IsBlank(ed[-1]))
+			--ed;
+		return ed;
+	}
+
+	inline bool TokenEquals(const char* beg, const char* ed, const char* keyword)
+	{
+		size_t len = strlen(keyword);
+		return (size_t)(ed - beg) == len && memcmp(beg, keyword, len) == 0;
+	}
+
+	// 解析无符号整数，失败返回nullptr
+	inline const char* ParseUInt(const char* p, const char* end, DWORD& out)
+	{
+		if (p >= end || !IsDigit(*p))
+			return nullptr;
+		DWORD value = 0;
+		while (p < end && IsDigit(*p))
+			value = value * 10 + (DWORD)(*p++ - '0');
+		out = value;
+		return p;
+	}
+
+	// 按"C" locale调用strtof，不受全局locale的小数点设置影响
+	float StrToFloatC(const char* str, char** endPtr)
+	{
+#ifdef _WIN32
+		static const _locale_t s_CLocale = _create_locale(LC_NUMERIC, "C");
+		return _strtof_l(str, endPtr, s_CLocale);
+#else
+		static const locale_t s_CLocale = newlocale(LC_NUMERIC_MASK, "C", (locale_t)0);
+		return strtof_l(str, endPtr, s_CLocale);
+#endif
+	}
+
+	// 解析浮点数，失败返回nullptr，结果与strtof一致
+	// 有效数字不超过2^53且10的幂次不超过22时，double运算能得到精确舍入的double(Clinger快速路径)
+	// 再转为float时，只有该double恰好落在两个相邻float的中点上才可能产生二次舍入误差，此时改走慢速路径
+	// 其余情况(超长尾数、inf/nan等)回退到"C" locale下的strtof
+	const char* ParseFloat(const char* p, const char* end, float& out)
+	{
+		static const double s_Pow10[] = {
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+		};
+
+		const char* beg = p;
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+'))
+			negative = (*p++ == '-');
+
+		unsigned long long mantissa = 0;
+		int exp10 = 0, digitCount = 0;
+		bool hasDigits = false, truncated = false;
+		// 整数部分
+		for (; p < end && IsDigit(*p); ++p)
+		{
+			hasDigits = true;
+			if (digitCount < 19)
+			{
+				mantissa = mantissa * 10 + (*p - '0');
+				if (mantissa)
+					++digitCount;
+			}
+			else
+			{
+				++exp10;
+				truncated = true;
+			}
+		}
+		// 小数部分
+		if (p < end && *p == '.')
+		{
+			for (++p; p < end && IsDigit(*p); ++p)
+			{
+				hasDigits = true;
+				if (digitCount < 19)
+				{
+					mantissa = mantissa * 10 + (*p - '0');
+					if (mantissa)
+						++digitCount;
+					--exp10;
+				}
+				else
+				{
+					truncated = true;
+				}
+			}
+		}
+		// 指数部分
+		if (hasDigits && p < end && (*p == 'e' || *p == 'E'))
+		{
+			const char* q = p + 1;
+			bool expNegative = false;
+			if (q < end && (*q == '-' || *q == '+'))
+				expNegative = (*q++ == '-');
+			if (q < end && IsDigit(*q))
+			{
+				int e = 0;
+				for (; q < end && IsDigit(*q); ++q)
+				{
+					if (e < 10000)
+						e = e * 10 + (*q - '0');
+				}
+				exp10 += expNegative ? -e : e;
+				p = q;
+			}
+		}
+
+		if (hasDigits && !truncated && mantissa <= (1ull << 53) && exp10 >= -22 && exp10 <= 22)
+		{
+			double value = (double)mantissa;
+			value = exp10 < 0 ? value / s_Pow10[-exp10] : value * s_Pow10[exp10];
+			// 结果在float的正规数范围内，double比float多出的29位尾数为100...0时即为中点
+			unsigned long long bits;
+			memcpy(&bits, &value, sizeof(bits));
+			if ((bits & 0x1FFFFFFFull) != 0x10000000ull)
+			{
+				out = (float)(negative ? -value : value);
+				return p;
+			}
+		}
+
+		// 慢速路径
+		char buffer[64];
+		const char* ed = TokenEnd(beg, end);
+		size_t len = (size_t)(ed - beg);
+		if (len == 0 || len >= sizeof(buffer))
+			return nullptr;
+		memcpy(buffer, beg, len);
+		buffer[len] = '\0';
+		char* parsedEnd = nullptr;
+		out = StrToFloatC(buffer, &parsedEnd);
+		if (parsedEnd == buffer)
+			return nullptr;
+		return beg + (parsedEnd - buffer);
+	}
+
+	// UTF-8字节串转宽字符串，遇到非法UTF-8序列时按系统代码页(如GBK)转换
+	std::wstring DecodeString(const char* beg, const char* ed)
+	{
+		std::wstring wstr;
+		wstr.reserve(ed - beg);
+		const unsigned char* p = reinterpret_cast<const unsigned char*>(beg);
+		const unsigned char* end = reinterpret_cast<const unsigned char*>(ed);
+		while (p < end)
+		{
+			unsigned int c = *p++;
+			int extra = c < 0x80 ? 0 : (c >> 5) == 0x6 ? 1 : (c >> 4) == 0xE ? 2 : (c >> 3) == 0x1E ? 3 : -1;
+			if (extra < 0 || end - p < extra)
+				break;
+			c &= extra == 0 ? 0x7F : (0x3F >> extra);
+			for (int i = 0; i < extra; ++i, ++p)
+			{
+				if ((*p & 0xC0) != 0x80)
+				{
+					extra = -1;
+					break;
+				}
+				c = (c << 6) | (*p & 0x3F);
+			}
+			if (extra < 0)
+				break;
+			if (sizeof(wchar_t) == 2 && c > 0xFFFF)
+			{
+				c -= 0x10000;
+				wstr.push_back((wchar_t)(0xD800 + (c >> 10)));
+				wstr.push_back((wchar_t)(0xDC00 + (c & 0x3FF)));
+			}
+			else
+			{
+				wstr.push_back((wchar_t)c);
+			}
+		}
+		if (p == end)
+			return wstr;
+
+#ifdef _WIN32
+		int len = MultiByteToWideChar(CP_ACP, 0, beg, (int)(ed - beg), nullptr, 0);
+		wstr.resize(len);
+		MultiByteToWideChar(CP_ACP, 0, beg, (int)(ed - beg), &wstr[0], len);
+#else
+		// 没有代码页转换时按Latin-1逐字节转换，字节需先转为无符号数以免符号扩展
+		wstr.assign(reinterpret_cast<const unsigned char*>(beg), reinterpret_cast<const unsigned char*>(ed));
+#endif
+		return wstr;
+	}
+
+	// 宽字符串转UTF-8字节串
+	std::string EncodeString(const std::wstring& wstr)
+	{
+		std::string str;
+		str.reserve(wstr.size());
+		for (size_t i = 0; i < wstr.size(); ++i)
+		{
+			unsigned int c = (unsigned int)wstr[i];
+			// 合并UTF-16代理对
+			if (c >= 0xD800 && c < 0xDC00 && i + 1 < wstr.size() &&
+				(unsigned int)wstr[i + 1] >= 0xDC00 && (unsigned int)wstr[i + 1] < 0xE000)
+			{
+				c = 0x10000 + ((c - 0xD800) << 10) + ((unsigned int)wstr[++i] - 0xDC00);
+			}
+
+			if (c < 0x80)
+				str.push_back((char)c);
+			else if (c < 0x800)
+				str += { (char)(0xC0 | (c >> 6)), (char)(0x80 | (c & 0x3F)) };
+			else if (c < 0x10000)
+				str += { (char)(0xE0 | (c >> 12)), (char)(0x80 | ((c >> 6) & 0x3F)), (char)(0x80 | (c & 0x3F)) };
+			else
+				str += { (char)(0xF0 | (c >> 18)), (char)(0x80 | ((c >> 12) & 0x3F)),
+					(char)(0x80 | ((c >> 6) & 0x3F)), (char)(0x80 | (c & 0x3F)) };
+		}
+		return str;
+	}
+
+	FILE* OpenFile(const wchar_t* fileName, const wchar_t* mode)
+	{
+		FILE* fp = nullptr;
+#ifdef _WIN32
+		if (_wfopen_s(&fp, fileName, mode) != 0)
+			fp = nullptr;
+#else
+		// 非Windows平台下以UTF-8编码文件名
+		fp = fopen(EncodeString(fileName).c_str(), EncodeString(mode).c_str());
+#endif
+		return fp;
+	}
+
+	// 将整个文件读入内存
+	bool ReadFileBytes(const wchar_t* fileName, std::vector<char>& bytes)
+	{
+		FILE* fp = OpenFile(fileName, L"rb");
+		if (!fp)
+			return false;
+
+		fseek(fp, 0, SEEK_END);
+		long size = ftell(fp);
+		fseek(fp, 0, SEEK_SET);
+		bytes.resize(size > 0 ? (size_t)size : 0);
+		size_t readSize = bytes.empty() ? 0 : fread(bytes.data(), 1, bytes.size(), fp);
+		fclose(fp);
+		return readSize == bytes.size();
+	}
+
+	bool WriteFileBytes(const wchar_t* fileName, const char* data, size_t size)
+	{
+		FILE* fp = OpenFile(fileName, L"wb");
+		if (!fp)
+			return false;
+
+		size_t writeSize = size ? fwrite(data, 1, size, fp) : 0;
+		return fclose(fp) == 0 && writeSize == size;
+	}
+
+	// 以宽字符流打开文本文件
+	// Windows下按中文代码页解码，其余平台下文件名与内容均按UTF-8处理
+	bool OpenTextFile(std::wifstream& wfin, const wchar_t* fileName)
+	{
+#ifdef _WIN32
+		wfin.open(fileName);
+		// 切换中文
+		std::locale china("chs");
+		wfin.imbue(china);
+#else
+		wfin.open(EncodeString(fileName));
+		wfin.imbue(std::locale(std::locale::classic(), new std::codecvt_utf8<wchar_t>));
+#endif
+		return wfin.is_open();
+	}
+
+	// 获取文件所在的目录，包含末尾的路径分隔符，没有目录时返回空串
+	std::wstring GetDirectory(const wchar_t* fileName)
+	{
+		std::wstring dir = fileName ? fileName : L"";
+		size_t pos = dir.find_last_of(L"/\\");
+		return pos == std::wstring::npos ? std::wstring() : dir.substr(0, pos + 1);
+	}
+
+	// 创建单层目录，目录已存在时也视为成功
+	bool CreateDirectoryIfMissing(const std::wstring& dir)
+	{
+#ifdef _WIN32
+		return CreateDirectoryW(dir.c_str(), nullptr) || GetLastError() == ERROR_ALREADY_EXISTS;
+#else
+		return mkdir(EncodeString(dir).c_str(), 0755) == 0 || errno == EEXIST;
+#endif
+	}
+
+	// 将src重命名为dst，dst已存在时将其替换
+	bool RenameFile(const std::wstring& src, const std::wstring& dst)
+	{
+#ifdef _WIN32
+		return MoveFileExW(src.c_str(), dst.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+		return rename(EncodeString(src).c_str(), EncodeString(dst).c_str()) == 0;
+#endif
+	}
+
+	void RemoveFile(const std::wstring& fileName)
+	{
+#ifdef _WIN32
+		DeleteFileW(fileName.c_str());
+#else
+		remove(EncodeString(fileName).c_str());
+#endif
+	}
+
+	// 64位哈希，每次混合8个字节，用于检测源文件内容的变化(不用于安全目的)
+	uint64_t HashBytes(const char* data, size_t size, uint64_t seed)
+	{
+		const uint64_t m = 0x9E3779B97F4A7C15ull;
+		uint64_t h = seed ^ (size * m);
+		auto mix = [&h, m](uint64_t k)
+		{
+			k *= 0xFF51AFD7ED558CCDull;
+			k ^= k >> 32;
+			h = (h ^ k) * m;
+			h ^= h >> 29;
+		};
+
+		const char* p = data;
+		for (; size >= 8; p += 8, size -= 8)
+		{
+			uint64_t k;
+			memcpy(&k, p, 8);
+			mix(k);
+		}
+		if (size)
+		{
+			uint64_t k = 0;
+			memcpy(&k, p, size);
+			mix(k ^ ((uint64_t)size << 56));
+		}
+
+		h ^= h >> 33;
+		h *= 0xC4CEB9FE1A85EC53ull;
+		h ^= h >> 33;
+		return h;
+	}
+
+	// 单个文本块的解析结果
+	// 面的索引是全局的，因此各块可以独立解析，之后再按顺序合并
+	struct ObjChunk
+	{
+		enum class EventType { Part, MtlLib, UseMtl };
+
+		struct Event
+		{
+			EventType type;
+			size_t faceCount;			// 事件发生前本块已解析的面数
+			const char* nameBeg;		// mtllib/usemtl的名称
+			const char* nameEnd;
+		};
+
+		std::vector<XMFLOAT3> positions;
+		std::vector<XMFLOAT3> normals;
+		std::vector<XMFLOAT2> texCoords;
+		std::vector<DWORD> faces;		// 每个面9个索引(v/vt/vn)，已按左手坐标系的顶点顺序排列
+		std::vector<Event> events;
+		XMFLOAT3 vMin, vMax;
+		bool succeeded = false;
+	};
+
+	void ParseObjChunk(const char* p, const char* end, ObjChunk& chunk)
+	{
+		XMVECTOR vecMin = g_XMInfinity, vecMax = g_XMNegInfinity;
+
+		// 根据文本长度粗略预留空间，减少扩容次数
+		size_t estimate = (size_t)(end - p) / 32;
+		chunk.positions.reserve(estimate / 4);
+		chunk.faces.reserve(estimate / 2 * 9);
+
+		for (; p < end; p = SkipLine(p, end))
+		{
+			p = SkipBlank(p, end);
+			const char* keyEnd = TokenEnd(p, end);
+			if (keyEnd == p)
+				continue;
+
+			const char* keyBeg = p;
+			p = SkipBlank(keyEnd, end);
+
+			if (*keyBeg == '#')
+			{
+				//
+				// 忽略注释所在行
+				//
+				continue;
+			}
+			else if (TokenEquals(keyBeg, keyEnd, "v"))
+			{
+				//
+				// 顶点位置
+				//
+
+				// 注意obj使用的是右手坐标系，而不是左手坐标系
+				// 需要将z值反转
+				XMFLOAT3 pos;
+				if (!(p = ParseFloat(p, end, pos.x)) ||
+					!(p = ParseFloat(SkipBlank(p, end), end, pos.y)) ||
+					!(p = ParseFloat(SkipBlank(p, end), end, pos.z)))
+					return;
+				pos.z = -pos.z;
+				chunk.positions.push_back(pos);
+				XMVECTOR vecPos = XMLoadFloat3(&pos);
+				vecMax = XMVectorMax(vecMax, vecPos);
+				vecMin = XMVectorMin(vecMin, vecPos);
+			}
+			else if (TokenEquals(keyBeg, keyEnd, "vt"))
+			{
+				//
+				// 顶点纹理坐标
+				//
+
+				// 注意obj使用的是笛卡尔坐标系，而不是纹理坐标系
+				float u, v;
+				if (!(p = ParseFloat(p, end, u)) ||
+					!(p = ParseFloat(SkipBlank(p, end), end, v)))
+					return;
+				v = 1.0f - v;
+				chunk.texCoords.emplace_back(XMFLOAT2(u, v));
+			}
+			else if (TokenEquals(keyBeg, keyEnd, "vn"))
+			{
+				//
+				// 顶点法向量
+				//
+
+				// 注意obj使用的是右手坐标系，而不是左手坐标系
+				// 需要将z值反转
+				float x, y, z;
+				if (!(p = ParseFloat(p, end, x)) ||
+					!(p = ParseFloat(SkipBlank(p, end), end, y)) ||
+					!(p = ParseFloat(SkipBlank(p, end), end, z)))
+					return;
+				z = -z;
+				chunk.normals.emplace_back(XMFLOAT3(x, y, z));
+			}
+			else if (TokenEquals(keyBeg, keyEnd, "f"))
+			{
+				//
+				// 几何面
+				//
+				DWORD idx[9];
+
+				// 顶点位置索引/纹理坐标索引/法向量索引
+				// 原来右手坐标系下顶点顺序是逆时针排布
+				// 现在需要转变为左手坐标系就需要将三角形顶点反过来输入
+				for (int i = 2; i >= 0; --i)
+				{
+					p = SkipBlank(p, end);
+					if (!(p = ParseUInt(p, end, idx[i * 3])) || p >= end || *p++ != '/' ||
+						!(p = ParseUInt(p, end, idx[i * 3 + 1])) || p >= end || *p++ != '/' ||
+						!(p = ParseUInt(p, end, idx[i * 3 + 2])))
+						return;
+				}
+				chunk.faces.insert(chunk.faces.end(), idx, idx + 9);
+
+				// 几何面顶点数可能超过了3，不支持该格式
+				p = SkipBlank(p, end);
+				if (p < end && *p != '\n')
+					return;
+			}
+			else if (TokenEquals(keyBeg, keyEnd, "o") || TokenEquals(keyBeg, keyEnd, "g"))
+			{
+				// 
+				// 对象名(组名)
+				//
+				chunk.events.push_back({ ObjChunk::EventType::Part, chunk.faces.size() / 9, nullptr, nullptr });
+			}
+			else if (TokenEquals(keyBeg, keyEnd, "mtllib") || TokenEquals(keyBeg, keyEnd, "usemtl"))
+			{
+				//
+				// 材质库与材质引用，名称的解码推迟到合并阶段
+				//
+				ObjChunk::Event ev;
+				ev.type = TokenEquals(keyBeg, keyEnd, "mtllib") ? ObjChunk::EventType::MtlLib : ObjChunk::EventType::UseMtl;
+				ev.faceCount = chunk.faces.size() / 9;
+				ev.nameEnd = TrimmedLine(p, end, ev.nameBeg);
+				chunk.events.push_back(ev);
+			}
+		}
+
+		XMStoreFloat3(&chunk.vMin, vecMin);
+		XMStoreFloat3(&chunk.vMax, vecMax);
+		chunk.succeeded = true;
+	}
+
+	//
+	// 以下用于读取二进制glTF(.glb)文件
+	//
+
+	// 最小化的JSON文档树，只用于读取.glb中的JSON块
+	struct JsonValue
+	{
+		enum class Type { Null, Bool, Number, String, Array, Object };
+
+		// 对象的成员或数组的元素，不存在时返回一个Null值
+		const JsonValue& operator[](const char* key) const
+		{
+			for (size_t i = 0; i < keys.size(); ++i)
+			{
+				if (keys[i] == key)
+					return values[i];
+			}
+			return Null();
+		}
+		const JsonValue& operator[](size_t index) const
+		{
+			return type == Type::Array && index < values.size() ? values[index] : Null();
+		}
+		const JsonValue& operator[](int index) const
+		{
+			return index >= 0 ? (*this)[(size_t)index] : Null();
+		}
+
+		bool IsNull() const { return type == Type::Null; }
+		size_t Size() const { return type == Type::Array ? values.size() : 0; }
+		double Number(double defaultValue) const { return type == Type::Number ? number : defaultValue; }
+		// 非负整数，不是合法索引时返回SIZE_MAX
+		size_t Index() const
+		{
+			return type == Type::Number && number >= 0.0 && number < 9007199254740992.0 && number == (double)(uint64_t)number ?
+				(size_t)number : SIZE_MAX;
+		}
+
+		static const JsonValue& Null()
+		{
+			static const JsonValue s_Null;
+			return s_Null;
+		}
+
+		Type type = Type::Null;
+		bool boolean = false;
+		double number = 0.0;
+		std::string str;					// UTF-8
+		std::vector<std::string> keys;		// 对象的成员名，与values一一对应
+		std::vector<JsonValue> values;		// 对象的成员值或数组的元素
+	};
+
+	class JsonParser
+	{
+	public:
+		JsonParser(const char* data, size_t size) : m_p(data), m_End(data + size) {}
+
+		// 解析整个文本，末尾只允许出现空白(.glb的JSON块以空格补齐)
+		bool Parse(JsonValue& value)
+		{
+			if (!ParseValue(value, 0))
+				return false;
+			SkipSpace();
+			return m_p == m_End;
+		}
+
+	private:
+		// 嵌套层数的上限，避免恶意文件耗尽栈空间
+		static const int kMaxDepth = 64;
+
+		void SkipSpace()
+		{
+			while (m_p < m_End && (*m_p == ' ' || *m_p == '\t' || *m_p == '\r' || *m_p == '\n' || *m_p == '\0'))
+				++m_p;
+		}
+
+		bool Expect(const char* literal)
+		{
+			size_t len = strlen(literal);
+			if ((size_t)(m_End - m_p) < len || memcmp(m_p, literal, len) != 0)
+				return false;
+			m_p += len;
+			return true;
+		}
+
+		bool ParseValue(JsonValue& value, int depth)
+		{
+			SkipSpace();
+			if (m_p >= m_End || depth > kMaxDepth)
+				return false;
+
+			switch (*m_p)
+			{
+			case '{':
+			{
+				value.type = JsonValue::Type::Object;
+				++m_p;
+				SkipSpace();
+				if (m_p < m_End && *m_p == '}')
+				{
+					++m_p;
+					return true;
+				}
+				for (;;)
+				{
+					SkipSpace();
+					value.keys.emplace_back();
+					value.values.emplace_back();
+					if (!ParseString(value.keys.back()))
+						return false;
+					SkipSpace();
+					if (m_p >= m_End || *m_p++ != ':' || !ParseValue(value.values.back(), depth + 1))
+						return false;
+					SkipSpace();
+					if (m_p < m_End && *m_p == ',')
+						++m_p;
+					else
+						return m_p < m_End && *m_p++ == '}';
+				}
+			}
+			case '[':
+			{
+				value.type = JsonValue::Type::Array;
+				++m_p;
+				SkipSpace();
+				if (m_p < m_End && *m_p == ']')
+				{
+					++m_p;
+					return true;
+				}
+				for (;;)
+				{
+					value.values.emplace_back();
+					if (!ParseValue(value.values.back(), depth + 1))
+						return false;
+					SkipSpace();
+					if (m_p < m_End && *m_p == ',')
+						++m_p;
+					else
+						return m_p < m_End && *m_p++ == ']';
+				}
+			}
+			case '"':
+				value.type = JsonValue::Type::String;
+				return ParseString(value.str);
+			case 't':
+				value.type = JsonValue::Type::Bool;
+				value.boolean = true;
+				return Expect("true");
+			case 'f':
+				value.type = JsonValue::Type::Bool;
+				return Expect("false");
+			case 'n':
+				return Expect("null");
+			default:
+				value.type = JsonValue::Type::Number;
+				return ParseNumber(value.number);
+			}
+		}
+
+		// 整数(索引、偏移、数量)逐位累加得到精确值，带小数或指数的数值按float精度解析，均不依赖locale
+		bool ParseNumber(double& number)
+		{
+			const char* beg = m_p;
+			const char* ed = beg;
+			while (ed < m_End && (IsDigit(*ed) || *ed == '-' || *ed == '+' || *ed == '.' || *ed == 'e' || *ed == 'E'))
+				++ed;
+
+			const char* p = *beg == '-' ? beg + 1 : beg;
+			double integer = 0.0;
+			for (; p < ed && IsDigit(*p); ++p)
+				integer = integer * 10.0 + (*p - '0');
+			if (p == ed && p > beg && IsDigit(p[-1]))
+			{
+				number = *beg == '-' ? -integer : integer;
+				m_p = ed;
+				return true;
+			}
+
+			float value;
+			if (ParseFloat(beg, ed, value) != ed)
+				return false;
+			number = value;
+			m_p = ed;
+			return true;
+		}
+
+		void AppendUtf8(std::string& str, unsigned int c)
+		{
+			if (c < 0x80)
+				str.push_back((char)c);
+			else if (c < 0x800)
+				str += { (char)(0xC0 | (c >> 6)), (char)(0x80 | (c & 0x3F)) };
+			else if (c < 0x10000)
+				str += { (char)(0xE0 | (c >> 12)), (char)(0x80 | ((c >> 6) & 0x3F)), (char)(0x80 | (c & 0x3F)) };
+			else
+				str += { (char)(0xF0 | (c >> 18)), (char)(0x80 | ((c >> 12) & 0x3F)),
+					(char)(0x80 | ((c >> 6) & 0x3F)), (char)(0x80 | (c & 0x3F)) };
+		}
+
+		bool ParseHex4(unsigned int& c)
+		{
+			if (m_End - m_p < 4)
+				return false;
+			c = 0;
+			for (int i = 0; i < 4; ++i)
+			{
+				char h = *m_p++;
+				c <<= 4;
+				if (IsDigit(h))
+					c |= (unsigned int)(h - '0');
+				else if (h >= 'a' && h <= 'f')
+					c |= (unsigned int)(h - 'a' + 10);
+				else if (h >= 'A' && h <= 'F')
+					c |= (unsigned int)(h - 'A' + 10);
+				else
+					return false;
+			}
+			return true;
+		}
+
+		bool ParseString(std::string& str)
+		{
+			if (m_p >= m_End || *m_p++ != '"')
+				return false;
+			while (m_p < m_End)
+			{
+				char c = *m_p++;
+				if (c == '"')
+					return true;
+				if (c != '\\')
+				{
+					str.push_back(c);
+					continue;
+				}
+				if (m_p >= m_End)
+					return false;
+				switch (*m_p++)
+				{
+				case '"': str.push_back('"'); break;
+				case '\\': str.push_back('\\'); break;
+				case '/': str.push_back('/'); break;
+				case 'b': str.push_back('\b'); break;
+				case 'f': str.push_back('\f'); break;
+				case 'n': str.push_back('\n'); break;
+				case 'r': str.push_back('\r'); break;
+				case 't': str.push_back('\t'); break;
+				case 'u':
+				{
+					unsigned int code, low;
+					if (!ParseHex4(code))
+						return false;
+					// UTF-16代理对
+					if (code >= 0xD800 && code < 0xDC00 && m_End - m_p >= 6 && m_p[0] == '\\' && m_p[1] == 'u')
+					{
+						m_p += 2;
+						if (!ParseHex4(low) || low < 0xDC00 || low >= 0xE000)
+							return false;
+						code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+					}
+					AppendUtf8(str, code);
+					break;
+				}
+				default:
+					return false;
+				}
+			}
+			return false;
+		}
+
+		const char* m_p;
+		const char* m_End;
+	};
+
+	// .glb文件头与块头，见glTF 2.0规范的GLB File Format Specification
+	struct GlbHeader
+	{
+		uint32_t magic;					// "glTF"
+		uint32_t version;				// 2
+		uint32_t length;				// 整个文件的字节数
+	};
+
+	struct GlbChunkHeader
+	{
+		uint32_t length;				// 块数据的字节数，不含块头
+		uint32_t type;
+	};
+
+	const uint32_t kGlbMagic = 0x46546C67;			// "glTF"
+	const uint32_t kGlbChunkJson = 0x4E4F534A;		// "JSON"
+	const uint32_t kGlbChunkBin = 0x004E4942;		// "BIN\0"
+
+	// glTF访问器的分量类型
+	enum GltfComponentType
+	{
+		GltfByte = 5120,
+		GltfUnsignedByte = 5121,
+		GltfShort = 5122,
+		GltfUnsignedShort = 5123,
+		GltfUnsignedInt = 5125,
+		GltfFloat = 5126
+	};
+
+	// 解析后的访问器，data指向BIN块中第一个元素
+	struct GltfAccessor
+	{
+		const char* data = nullptr;
+		size_t count = 0;
+		size_t stride = 0;				// 相邻元素的字节间隔
+		UINT componentType = 0;
+		UINT componentCount = 0;
+		bool normalized = false;
+	};
+
+	UINT GltfComponentSize(UINT componentType)
+	{
+		switch (componentType)
+		{
+		case GltfByte: case GltfUnsignedByte: return 1;
+		case GltfShort: case GltfUnsignedShort: return 2;
+		case GltfUnsignedInt: case GltfFloat: return 4;
+		default: return 0;
+		}
+	}
+
+	UINT GltfComponentCount(const std::string& type)
+	{
+		return type == "SCALAR" ? 1 : type == "VEC2" ? 2 : type == "VEC3" ? 3 : type == "VEC4" ? 4 : 0;
+	}
+
+	// 解析访问器并检查其全部元素都位于BIN块内
+	// 不支持稀疏访问器、没有缓冲区视图的访问器与引用外部缓冲区的访问器
+	bool GetGltfAccessor(const JsonValue& doc, size_t index, const char* bin, size_t binSize, GltfAccessor& accessor)
+	{
+		const JsonValue& acc = doc["accessors"][index];
+		if (acc.IsNull() || !acc["sparse"].IsNull())
+			return false;
+		const JsonValue& view = doc["bufferViews"][acc["bufferView"].Index()];
+		size_t bufferIndex = view["buffer"].Index();
+		if (view.IsNull() || bufferIndex == SIZE_MAX || !doc["buffers"][bufferIndex]["uri"].IsNull() || !bin)
+			return false;
+
+		accessor.componentType = (UINT)acc["componentType"].Index();
+		accessor.componentCount = GltfComponentCount(acc["type"].str);
+		accessor.normalized = acc["normalized"].boolean;
+		accessor.count = acc["count"].Index();
+		UINT componentSize = GltfComponentSize(accessor.componentType);
+		size_t elementSize = (size_t)componentSize * accessor.componentCount;
+		if (!elementSize || accessor.count == SIZE_MAX)
+			return false;
+
+		size_t viewOffset = view["byteOffset"].IsNull() ? 0 : view["byteOffset"].Index();
+		size_t viewLength = view["byteLength"].Index();
+		size_t offset = acc["byteOffset"].IsNull() ? 0 : acc["byteOffset"].Index();
+		accessor.stride = view["byteStride"].IsNull() ? elementSize : view["byteStride"].Index();
+		if (viewOffset > binSize || viewLength > binSize - viewOffset || accessor.stride < elementSize || offset > viewLength)
+			return false;
+		if (accessor.count && (accessor.count - 1 > (viewLength - offset - elementSize) / accessor.stride ||
+			viewLength - offset < elementSize))
+			return false;
+
+		accessor.data = bin + viewOffset + offset;
+		return true;
+	}
+
+	// 读取第i个元素的前n个分量并转换为float，归一化的整数按规范映射到[0, 1]或[-1, 1]
+	void ReadGltfElement(const GltfAccessor& accessor, size_t i, float* out, UINT n)
+	{
+		const char* src = accessor.data + i * accessor.stride;
+		for (UINT c = 0; c < n; ++c)
+		{
+			switch (accessor.componentType)
+			{
+			case GltfFloat: { float v; memcpy(&v, src + c * 4, 4); out[c] = v; break; }
+			case GltfUnsignedInt: { uint32_t v; memcpy(&v, src + c * 4, 4); out[c] = (float)v; break; }
+			case GltfUnsignedShort: { uint16_t v; memcpy(&v, src + c * 2, 2); out[c] = accessor.normalized ? v / 65535.0f : v; break; }
+			case GltfShort: { int16_t v; memcpy(&v, src + c * 2, 2); out[c] = accessor.normalized ? (std::max)(v / 32767.0f, -1.0f) : v; break; }
+			case GltfUnsignedByte: { uint8_t v = (uint8_t)src[c]; out[c] = accessor.normalized ? v / 255.0f : v; break; }
+			case GltfByte: { int8_t v = (int8_t)src[c]; out[c] = accessor.normalized ? (std::max)(v / 127.0f, -1.0f) : v; break; }
+			}
+		}
+	}
+
+	// 读取第i个索引
+	uint32_t ReadGltfIndex(const GltfAccessor& accessor, size_t i)
+	{
+		const char* src = accessor.data + i * accessor.stride;
+		switch (accessor.componentType)
+		{
+		case GltfUnsignedInt: { uint32_t v; memcpy(&v, src, 4); return v; }
+		case GltfUnsignedShort: { uint16_t v; memcpy(&v, src, 2); return v; }
+		default: return (uint8_t)*src;
+		}
+	}
+
+	// 将URI中的%XX转义还原为字节
+	std::string DecodeUri(const std::string& uri)
+	{
+		std::string str;
+		str.reserve(uri.size());
+		for (size_t i = 0; i < uri.size(); ++i)
+		{
+			auto hex = [](char h) { return IsDigit(h) ? h - '0' : (h | 0x20) >= 'a' && (h | 0x20) <= 'f' ? (h | 0x20) - 'a' + 10 : -1; };
+			if (uri[i] == '%' && i + 2 < uri.size() && hex(uri[i + 1]) >= 0 && hex(uri[i + 2]) >= 0)
+			{
+				str.push_back((char)(hex(uri[i + 1]) * 16 + hex(uri[i + 2])));
+				i += 2;
+			}
+			else
+			{
+				str.push_back(uri[i]);
+			}
+		}
+		return str;
+	}
+
+	bool IsGlbFile(const wchar_t* fileName)
+	{
+		size_t len = fileName ? wcslen(fileName) : 0;
+		if (len < 4)
+			return false;
+		const wchar_t* ext = fileName + len - 4;
+		return ext[0] == L'.' && (ext[1] | 0x20) == L'g' && (ext[2] | 0x20) == L'l' && (ext[3] | 0x20) == L'b';
+	}
+
+	// 写入图元的索引，顶点顺序由右手坐标系转换为左手坐标系时reverse为true
+	// 没有索引访问器时按顶点顺序生成，16位索引且布局紧密时整块拷贝，索引越界时返回false
+	template<class T>
+	bool ReadGltfIndices(const GltfAccessor* indices, size_t indexCount, size_t vertexCount, bool reverse, std::vector<T>& out)
+	{
+		out.resize(indexCount);
+		T* dst = out.data();
+		if (!indices)
+		{
+			for (size_t i = 0; i < indexCount; ++i)
+				dst[i] = (T)i;
+		}
+		else if (sizeof(T) == sizeof(uint16_t) && indices->componentType == GltfUnsignedShort && indices->stride == sizeof(uint16_t))
+		{
+			if (indexCount)
+				memcpy(dst, indices->data, indexCount * sizeof(T));
+			for (size_t i = 0; i < indexCount; ++i)
+			{
+				if (dst[i] >= vertexCount)
+					return false;
+			}
+		}
+		else
+		{
+			for (size_t i = 0; i < indexCount; ++i)
+			{
+				uint32_t index = ReadGltfIndex(*indices, i);
+				if (index >= vertexCount)
+					return false;
+				dst[i] = (T)index;
+			}
+		}
+
+		if (reverse)
+		{
+			for (size_t i = 0; i < indexCount; i += 3)
+				std::swap(dst[i + 1], dst[i + 2]);
+		}
+		return true;
+	}
+
+	// 读取一个三角形图元的顶点与索引，world为所在节点在glTF(右手坐标系)下的世界矩阵
+	// 结果转换到左手坐标系，顶点数不超过WORD的最大值时使用16位索引
+	bool ReadGltfPrimitive(const JsonValue& doc, const JsonValue& primitive, const char* bin, size_t binSize,
+		FXMMATRIX world, ObjReader::ObjPart& part)
+	{
+		// 只支持三角形列表(mode缺省时为4)
+		if (!primitive["mode"].IsNull() && primitive["mode"].Index() != 4)
+			return false;
+
+		// 与.obj一样要求提供法向量，缺少纹理坐标时补0
+		const JsonValue& attributes = primitive["attributes"];
+		GltfAccessor positions, normals, texCoords;
+		if (!GetGltfAccessor(doc, attributes["POSITION"].Index(), bin, binSize, positions) ||
+			!GetGltfAccessor(doc, attributes["NORMAL"].Index(), bin, binSize, normals) ||
+			positions.componentCount != 3 || normals.componentCount != 3 || normals.count != positions.count)
+			return false;
+		bool hasTexCoords = !attributes["TEXCOORD_0"].IsNull();
+		if (hasTexCoords && (!GetGltfAccessor(doc, attributes["TEXCOORD_0"].Index(), bin, binSize, texCoords) ||
+			texCoords.componentCount != 2 || texCoords.count != positions.count))
+			return false;
+
+		const JsonValue& indexValue = primitive["indices"];
+		GltfAccessor indices;
+		if (!indexValue.IsNull() && (!GetGltfAccessor(doc, indexValue.Index(), bin, binSize, indices) ||
+			indices.componentCount != 1 || (indices.componentType != GltfUnsignedByte &&
+			indices.componentType != GltfUnsignedShort && indices.componentType != GltfUnsignedInt)))
+			return false;
+		size_t vertexCount = positions.count;
+		size_t indexCount = indexValue.IsNull() ? vertexCount : indices.count;
+		if (indexCount % 3)
+			return false;
+
+		//
+		// 顶点
+		//
+
+		part.vertices.resize(vertexCount);
+		VertexPosNormalTex* vertices = part.vertices.data();
+		bool transformed = !XMMatrixIsIdentity(world);
+		// glTF与D3D的纹理坐标原点都在左上角，只需要反转位置与法向量的z值
+		bool interleaved = !transformed && hasTexCoords &&
+			positions.componentType == GltfFloat && normals.componentType == GltfFloat && texCoords.componentType == GltfFloat &&
+			positions.stride == sizeof(VertexPosNormalTex) && normals.stride == sizeof(VertexPosNormalTex) &&
+			texCoords.stride == sizeof(VertexPosNormalTex) &&
+			normals.data == positions.data + offsetof(VertexPosNormalTex, normal) &&
+			texCoords.data == positions.data + offsetof(VertexPosNormalTex, tex);
+		if (interleaved)
+		{
+			// 缓冲区视图的布局与VertexPosNormalTex一致，整块拷贝
+			if (vertexCount)
+				memcpy(vertices, positions.data, vertexCount * sizeof(VertexPosNormalTex));
+			for (size_t i = 0; i < vertexCount; ++i)
+			{
+				vertices[i].pos.z = -vertices[i].pos.z;
+				vertices[i].normal.z = -vertices[i].normal.z;
+			}
+		}
+		else
+		{
+			// 法向量使用世界矩阵的逆转置变换
+			XMMATRIX normalMatrix = XMMatrixTranspose(XMMatrixInverse(nullptr, world));
+			for (size_t i = 0; i < vertexCount; ++i)
+			{
+				VertexPosNormalTex& vertex = vertices[i];
+				ReadGltfElement(positions, i, &vertex.pos.x, 3);
+				ReadGltfElement(normals, i, &vertex.normal.x, 3);
+				if (hasTexCoords)
+					ReadGltfElement(texCoords, i, &vertex.tex.x, 2);
+				else
+					vertex.tex = XMFLOAT2();
+				if (transformed)
+				{
+					XMStoreFloat3(&vertex.pos, XMVector3Transform(XMLoadFloat3(&vertex.pos), world));
+					XMStoreFloat3(&vertex.normal, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&vertex.normal), normalMatrix)));
+				}
+				vertex.pos.z = -vertex.pos.z;
+				vertex.normal.z = -vertex.normal.z;
+			}
+		}
+
+		//
+		// 索引
+		//
+
+		// 反转z值会使三角形的环绕方向反过来，需要调换顶点顺序
+		// 但镜像的节点变换(行列式为负)已经反转过一次，此时保持原顺序
+		bool reverse = XMVectorGetX(XMMatrixDeterminant(world)) >= 0.0f;
+		const GltfAccessor* source = indexValue.IsNull() ? nullptr : &indices;
+		part.indices16.clear();
+		part.indices32.clear();
+		bool succeeded = vertexCount < 65535 ?
+			ReadGltfIndices(source, indexCount, vertexCount, reverse, part.indices16) :
+			ReadGltfIndices(source, indexCount, vertexCount, reverse, part.indices32);
+		if (!succeeded)
+			return false;
+
+		part.bounds = ObjReader::ComputeBounds(vertices, vertexCount);
+		return true;
+	}
+
+	// 检查.mbo中的索引是否都小于顶点数，索引会直接写入索引缓冲区，越界的索引不能交给GPU
+	// v1文件中的数组不一定对齐，逐个使用memcpy读取
+	bool IndicesInRange(const void* indices, size_t count, UINT indexSize, UINT vertexCount)
+	{
+		const char* p = static_cast<const char*>(indices);
+		if (indexSize == sizeof(WORD))
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				WORD index;
+				memcpy(&index, p + i * sizeof(WORD), sizeof(WORD));
+				if (index >= vertexCount)
+					return false;
+			}
+		}
+		else
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				DWORD index;
+				memcpy(&index, p + i * sizeof(DWORD), sizeof(DWORD));
+				if (index >= vertexCount)
+					return false;
+			}
+		}
+		return true;
+	}
+}
+
+bool ObjReader::Read(const wchar_t * mboFileName, const wchar_t * objFileName, UINT threadCount)
+{
+	if (mboFileName && ReadMbo(mboFileName))
+	{
+		return true;
+	}
+	else if (objFileName)
+	{
+		bool status = IsGlbFile(objFileName) ? ReadGlb(objFileName) : ReadObj(objFileName, threadCount);
+		if (status && mboFileName)
+			return WriteMbo(mboFileName);
+		return status;
+	}
+
+	return false;
+}
+
+bool ObjReader::ReadObj(const wchar_t * objFileName, UINT threadCount)
+{
+	std::vector<char> bytes;
+	if (!ReadFileBytes(objFileName, bytes))
+		return false;
+
+	return ReadObjFromMemory(bytes.data(), bytes.size(), objFileName, threadCount);
+}
+
+bool ObjReader::ReadObjFromMemory(const char * data, size_t size, const wchar_t * objFileName, UINT threadCount)
+{
+	objParts.clear();
+	sourceHash = 0;
+	vertexLookups = vertexCacheHits = 0;
+
+	const char* p = data;
+	const char* end = data + size;
+	// 跳过UTF-8 BOM
+	if (size >= 3 && memcmp(data, "\xEF\xBB\xBF", 3) == 0)
+		p += 3;
+
+	if (threadCount == 0)
+		threadCount = ThreadPool::HardwareThreadCount();
+	// 每块至少1MB，避免小文件产生过多的块
+	size_t chunkCount = (size_t)(end - p) / (1 << 20) + 1;
+	if (chunkCount > threadCount)
+		chunkCount = threadCount;
+
+	// 按行边界切分文本块
+	std::vector<const char*> bounds(chunkCount + 1);
+	bounds[0] = p;
+	bounds[chunkCount] = end;
+	for (size_t i = 1; i < chunkCount; ++i)
+	{
+		const char* q = p + (end - p) * i / chunkCount;
+		bounds[i] = q < bounds[i - 1] ? bounds[i - 1] : SkipLine(q, end);
+	}
+
+	std::vector<ObjChunk> chunks(chunkCount);
+	std::unique_ptr<ThreadPool> pool;
+	if (chunkCount > 1)
+		pool = std::make_unique<ThreadPool>(threadCount - 1);
+
+	auto parseChunk = [&](size_t i) { ParseObjChunk(bounds[i], bounds[i + 1], chunks[i]); };
+	if (pool)
+		pool->ParallelFor(chunkCount, parseChunk);
+	else
+		parseChunk(0);
+
+	//
+	// 按顺序合并各块的结果
+	//
+
+	// 合并顶点属性，各块的属性首尾相接即为全局的属性数组
+	size_t positionCount = 0, normalCount = 0, texCoordCount = 0;
+	for (auto& chunk : chunks)
+	{
+		if (!chunk.succeeded)
+			return false;
+		positionCount += chunk.positions.size();
+		normalCount += chunk.normals.size();
+		texCoordCount += chunk.texCoords.size();
+	}
+
+	std::vector<XMFLOAT3>   positions;
+	std::vector<XMFLOAT3>   normals;
+	std::vector<XMFLOAT2>   texCoords;
+	positions.reserve(positionCount);
+	normals.reserve(normalCount);
+	texCoords.reserve(texCoordCount);
+
+	XMVECTOR vecMin = g_XMInfinity, vecMax = g_XMNegInfinity;
+	for (auto& chunk : chunks)
+	{
+		positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+		normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+		texCoords.insert(texCoords.end(), chunk.texCoords.begin(), chunk.texCoords.end());
+		vecMin = XMVectorMin(vecMin, XMLoadFloat3(&chunk.vMin));
+		vecMax = XMVectorMax(vecMax, XMLoadFloat3(&chunk.vMax));
+		std::vector<XMFLOAT3>().swap(chunk.positions);
+		std::vector<XMFLOAT3>().swap(chunk.normals);
+		std::vector<XMFLOAT2>().swap(chunk.texCoords);
+	}
+
+	// 重放o/g/mtllib/usemtl事件，并记录每个部分所包含的面所在的范围
+	struct FaceRange
+	{
+		const ObjChunk* chunk;
+		size_t faceBeg, faceEnd;
+	};
+	std::vector<std::vector<FaceRange>> partFaces;
+	MtlReader mtlReader;
+
+	auto appendFaces = [&](const ObjChunk& chunk, size_t faceBeg, size_t faceEnd)
+	{
+		if (faceBeg == faceEnd)
+			return;
+		// 若在o/g之前就出现几何面，则补充一个默认部分
+		if (objParts.empty())
+		{
+			AddDefaultPart();
+			partFaces.emplace_back();
+		}
+		partFaces.back().push_back(FaceRange{ &chunk, faceBeg, faceEnd });
+	};
+
+	for (auto& chunk : chunks)
+	{
+		size_t faceBeg = 0;
+		for (auto& ev : chunk.events)
+		{
+			appendFaces(chunk, faceBeg, ev.faceCount);
+			faceBeg = ev.faceCount;
+
+			if (ev.type == ObjChunk::EventType::Part)
+			{
+				// 
+				// 对象名(组名)
+				//
+				AddDefaultPart();
+				partFaces.emplace_back();
+			}
+			else if (ev.type == ObjChunk::EventType::MtlLib)
+			{
+				//
+				// 指定某一文件的材质
+				//
+				std::wstring mtlFile = DecodeString(ev.nameBeg, ev.nameEnd);
+				// 获取路径
+				std::wstring dir = objFileName ? objFileName : L"";
+				size_t pos;
+				if ((pos = dir.find_last_of('/')) == std::wstring::npos &&
+					(pos = dir.find_last_of('\\')) == std::wstring::npos)
+				{
+					pos = 0;
+				}
+				else
+				{
+					pos += 1;
+				}
+
+				mtlReader.ReadMtl((dir.erase(pos) + mtlFile).c_str());
+			}
+			else if (ev.type == ObjChunk::EventType::UseMtl)
+			{
+				//
+				// 使用之前指定文件内部的某一材质
+				//
+				std::wstring mtlName = DecodeString(ev.nameBeg, ev.nameEnd);
+				if (objParts.empty())
+				{
+					AddDefaultPart();
+					partFaces.emplace_back();
+				}
+				objParts.back().material = mtlReader.materials[mtlName];
+				objParts.back().texStrDiffuse = mtlReader.mapKdStrs[mtlName];
+			}
+		}
+		appendFaces(chunk, faceBeg, chunk.faces.size() / 9);
+	}
+
+	//
+	// 各部分的顶点缓存互相独立，可以并行地组装顶点与索引
+	//
+	std::vector<char> partSucceeded(objParts.size(), 1);
+	std::vector<size_t> partHits(objParts.size());
+	auto buildPart = [&](size_t i)
+	{
+		ObjPart& part = objParts[i];
+
+		// 根据面数预留空间，不重复顶点数按面数估计
+		size_t faceCount = 0;
+		for (auto& range : partFaces[i])
+			faceCount += range.faceEnd - range.faceBeg;
+		part.indices32.reserve(faceCount * 3);
+		VertexCache cache;
+		cache.Reset(faceCount);
+
+		size_t hits = 0;
+		for (auto& range : partFaces[i])
+		{
+			if (!AddFaces(part, cache, range.chunk->faces.data() + range.faceBeg * 9, range.faceEnd - range.faceBeg,
+				positions, normals, texCoords, hits))
+			{
+				partSucceeded[i] = 0;
+				return;
+			}
+		}
+		partHits[i] = hits;
+		FinishPart(part);
+	};
+
+	if (pool)
+		pool->ParallelFor(objParts.size(), buildPart);
+	else
+	{
+		for (size_t i = 0; i < objParts.size(); ++i)
+			buildPart(i);
+	}
+
+	for (size_t i = 0; i < objParts.size(); ++i)
+	{
+		if (!partSucceeded[i])
+			return false;
+		vertexLookups += objParts[i].indices16.size() + objParts[i].indices32.size();
+		vertexCacheHits += partHits[i];
+	}
+
+	XMStoreFloat3(&vMax, vecMax);
+	XMStoreFloat3(&vMin, vecMin);
+
+	return true;
+}
+
+bool ObjReader::ReadObjStreaming(const wchar_t * objFileName, const PartCallback & onPart)
+{
+	// 映射文件而不是整体读入，解析可以立即开始，页面随解析进度按需载入
+	MappedFile file;
+	if (!file.Open(objFileName))
+		return false;
+
+	return ReadObjStreamingFromMemory(file.GetData(), file.GetSize(), objFileName, onPart, &file);
+}
+
+bool ObjReader::ReadObjStreamingFromMemory(const char * data, size_t size, const wchar_t * objFileName, const PartCallback & onPart)
+{
+	return ReadObjStreamingFromMemory(data, size, objFileName, onPart, nullptr);
+}
+
+bool ObjReader::ReadObjStreamingFromMemory(const char * data, size_t size, const wchar_t * objFileName,
+	const PartCallback & onPart, const MappedFile * file)
+{
+	objParts.clear();
+	sourceHash = 0;
+	vertexLookups = vertexCacheHits = 0;
+
+	const char* begin = data;
+	const char* end = data + size;
+	// 跳过UTF-8 BOM
+	if (size >= 3 && memcmp(data, "\xEF\xBB\xBF", 3) == 0)
+		begin += 3;
+
+	// 每次解析的文本长度，部分结束后最多再解析这么多文本就会被交出
+	const size_t sliceSize = 1 << 18;
+	// 已组装、等待回调的部分数的上限，解析领先过多时等待，限制内存占用
+	const size_t maxQueuedParts = 4;
+
+	std::queue<ObjPart> readyParts;
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::atomic<bool> cancelled(false);
+	bool parseDone = false, parseSucceeded = false;
+	XMFLOAT3 parsedMin, parsedMax;
+	size_t parsedLookups = 0, parsedHits = 0;
+
+	// 在解析线程中调用，队列已满时等待，读取被中止时返回false
+	auto emitPart = [&](ObjPart&& part)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [&]() { return readyParts.size() < maxQueuedParts || cancelled; });
+			if (cancelled)
+				return false;
+			readyParts.push(std::move(part));
+		}
+		condition.notify_all();
+		return true;
+	};
+
+	auto parse = [&]()
+	{
+		// 尚未交出的部分，最后一个可能仍在接收新的面
+		// 面的索引是全局的，引用的属性都已解析时面直接组装进部分，不再保留原始的面；
+		// 否则(引用了后面才出现的属性)该部分之后的面都暂存起来，推迟到属性齐全时组装
+		struct PendingPart
+		{
+			explicit PendingPart(ObjPart&& part) : part(std::move(part)) {}
+
+			ObjPart part;
+			VertexCache cache;
+			std::vector<DWORD> faces;
+			DWORD maxVpi = 0, maxVti = 0, maxVni = 0;
+		};
+		std::vector<PendingPart> pending;
+		size_t closedCount = 0;
+
+		std::vector<XMFLOAT3> positions;
+		std::vector<XMFLOAT3> normals;
+		std::vector<XMFLOAT2> texCoords;
+		XMVECTOR vecMin = g_XMInfinity, vecMax = g_XMNegInfinity;
+		MtlReader mtlReader;
+		size_t lookups = 0, hits = 0;
+
+		auto appendFaces = [&](const ObjChunk& chunk, size_t faceBeg, size_t faceEnd)
+		{
+			if (faceBeg == faceEnd)
+				return true;
+			// 若在o/g之前就出现几何面，则补充一个默认部分
+			if (pending.size() == closedCount)
+				pending.emplace_back(DefaultPart());
+			PendingPart& current = pending.back();
+			const DWORD* faces = chunk.faces.data() + faceBeg * 9;
+			const DWORD* facesEnd = chunk.faces.data() + faceEnd * 9;
+			for (const DWORD* face = faces; face < facesEnd; face += 3)
+			{
+				current.maxVpi = (std::max)(current.maxVpi, face[0]);
+				current.maxVti = (std::max)(current.maxVti, face[1]);
+				current.maxVni = (std::max)(current.maxVni, face[2]);
+			}
+			if (current.faces.empty() && current.maxVpi <= positions.size() &&
+				current.maxVti <= texCoords.size() && current.maxVni <= normals.size())
+				return AddFaces(current.part, current.cache, faces, faceEnd - faceBeg, positions, normals, texCoords, hits);
+			current.faces.insert(current.faces.end(), faces, facesEnd);
+			return true;
+		};
+
+		// 按顺序交出已结束的部分，atEnd为false时遇到仍引用了未解析属性的部分就停下
+		auto flushParts = [&](bool atEnd)
+		{
+			size_t count = 0;
+			for (; count < closedCount; ++count)
+			{
+				PendingPart& pendingPart = pending[count];
+				if (!atEnd && (pendingPart.maxVpi > positions.size() ||
+					pendingPart.maxVti > texCoords.size() || pendingPart.maxVni > normals.size()))
+					break;
+
+				ObjPart& part = pendingPart.part;
+				if (!AddFaces(part, pendingPart.cache, pendingPart.faces.data(), pendingPart.faces.size() / 9,
+					positions, normals, texCoords, hits))
+					return false;
+				// 交出前释放只在组装时使用的数据，等待回调的部分只保留自身的几何数据
+				std::vector<DWORD>().swap(pendingPart.faces);
+				pendingPart.cache = VertexCache();
+				if (atEnd && count + 1 == closedCount)
+				{
+					// 最后一个部分组装完毕后不再需要全局的属性
+					std::vector<XMFLOAT3>().swap(positions);
+					std::vector<XMFLOAT3>().swap(normals);
+					std::vector<XMFLOAT2>().swap(texCoords);
+				}
+				lookups += part.indices32.size();
+				FinishPart(part);
+				part.vertices.shrink_to_fit();
+				if (!emitPart(std::move(part)))
+					return false;
+			}
+			pending.erase(pending.begin(), pending.begin() + count);
+			closedCount -= count;
+			return true;
+		};
+
+		ObjChunk chunk;
+		const char* discarded = begin;
+		for (const char* p = begin; p < end && !cancelled; )
+		{
+			const char* sliceEnd = (size_t)(end - p) > sliceSize ? SkipLine(p + sliceSize, end) : end;
+
+			chunk.positions.clear();
+			chunk.normals.clear();
+			chunk.texCoords.clear();
+			chunk.faces.clear();
+			chunk.events.clear();
+			chunk.succeeded = false;
+			ParseObjChunk(p, sliceEnd, chunk);
+			if (!chunk.succeeded)
+				return false;
+			p = sliceEnd;
+
+			positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+			normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+			texCoords.insert(texCoords.end(), chunk.texCoords.begin(), chunk.texCoords.end());
+			vecMin = XMVectorMin(vecMin, XMLoadFloat3(&chunk.vMin));
+			vecMax = XMVectorMax(vecMax, XMLoadFloat3(&chunk.vMax));
+
+			// 重放o/g/mtllib/usemtl事件，与ReadObjFromMemory的处理方式相同
+			size_t faceBeg = 0;
+			for (auto& ev : chunk.events)
+			{
+				if (!appendFaces(chunk, faceBeg, ev.faceCount))
+					return false;
+				faceBeg = ev.faceCount;
+
+				if (ev.type == ObjChunk::EventType::Part)
+				{
+					// 
+					// 对象名(组名)，上一个部分到此结束
+					//
+					closedCount = pending.size();
+					pending.emplace_back(DefaultPart());
+				}
+				else if (ev.type == ObjChunk::EventType::MtlLib)
+				{
+					//
+					// 指定某一文件的材质
+					//
+					std::wstring mtlFile = DecodeString(ev.nameBeg, ev.nameEnd);
+					mtlReader.ReadMtl((GetDirectory(objFileName) + mtlFile).c_str());
+				}
+				else if (ev.type == ObjChunk::EventType::UseMtl)
+				{
+					//
+					// 使用之前指定文件内部的某一材质
+					//
+					std::wstring mtlName = DecodeString(ev.nameBeg, ev.nameEnd);
+					if (pending.size() == closedCount)
+						pending.emplace_back(DefaultPart());
+					pending.back().part.material = mtlReader.materials[mtlName];
+					pending.back().part.texStrDiffuse = mtlReader.mapKdStrs[mtlName];
+				}
+			}
+			if (!appendFaces(chunk, faceBeg, chunk.faces.size() / 9))
+				return false;
+			// 事件中的名称指向文本，重放完毕后这一段文本不再被访问
+			if (file)
+				discarded = file->Discard(discarded, p);
+
+			if (!flushParts(false))
+				return false;
+		}
+		if (cancelled)
+			return false;
+
+		// 文件末尾结束最后一个部分
+		closedCount = pending.size();
+		if (!flushParts(true))
+			return false;
+
+		XMStoreFloat3(&parsedMin, vecMin);
+		XMStoreFloat3(&parsedMax, vecMax);
+		parsedLookups = lookups;
+		parsedHits = hits;
+		return true;
+	};
+
+	std::thread parser([&]()
+	{
+		bool succeeded = parse();
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			parseDone = true;
+			parseSucceeded = succeeded;
+		}
+		condition.notify_all();
+	});
+
+	// 在调用线程上按顺序处理已完成的部分
+	bool succeeded = true;
+	for (size_t partIndex = 0; ; ++partIndex)
+	{
+		ObjPart part;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [&]() { return !readyParts.empty() || parseDone; });
+			if (readyParts.empty() || (parseDone && !parseSucceeded))
+				break;
+			part = std::move(readyParts.front());
+			readyParts.pop();
+		}
+		condition.notify_all();
+
+		if (!onPart(partIndex, part))
+		{
+			succeeded = false;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				cancelled = true;
+			}
+			condition.notify_all();
+			break;
+		}
+	}
+	parser.join();
+
+	if (!succeeded || !parseSucceeded)
+		return false;
+
+	vMin = parsedMin;
+	vMax = parsedMax;
+	vertexLookups = parsedLookups;
+	vertexCacheHits = parsedHits;
+	return true;
+}
+
+bool ObjReader::ReadGlb(const wchar_t * glbFileName)
+{
+	// 映射文件而不是整体读入，布局一致的缓冲区视图直接从映射的内存拷贝
+	MappedFile file;
+	if (!file.Open(glbFileName))
+		return false;
+
+	return ReadGlbFromMemory(file.GetData(), file.GetSize(), glbFileName);
+}
+
+bool ObjReader::ReadGlbFromMemory(const char * data, size_t size, const wchar_t * glbFileName)
+{
+	objParts.clear();
+	sourceHash = 0;
+	vertexLookups = vertexCacheHits = 0;
+
+	//
+	// 文件头与JSON、BIN块
+	//
+
+	GlbHeader header;
+	if (size < sizeof(GlbHeader))
+		return false;
+	memcpy(&header, data, sizeof(GlbHeader));
+	if (header.magic != kGlbMagic || header.version != 2 || header.length > size)
+		return false;
+
+	const char* json = nullptr;
+	const char* bin = nullptr;
+	size_t jsonSize = 0, binSize = 0;
+	size_t offset = sizeof(GlbHeader);
+	while (header.length - offset >= sizeof(GlbChunkHeader))
+	{
+		GlbChunkHeader chunk;
+		memcpy(&chunk, data + offset, sizeof(GlbChunkHeader));
+		offset += sizeof(GlbChunkHeader);
+		if (chunk.length > header.length - offset)
+			return false;
+		// 只使用第一个JSON块与第一个BIN块，其余块(扩展)忽略
+		if (chunk.type == kGlbChunkJson && !json)
+		{
+			json = data + offset;
+			jsonSize = chunk.length;
+		}
+		else if (chunk.type == kGlbChunkBin && !bin)
+		{
+			bin = data + offset;
+			binSize = chunk.length;
+		}
+		// 块按4字节对齐
+		offset += (std::min)(((size_t)chunk.length + 3) & ~(size_t)3, header.length - offset);
+	}
+
+	JsonValue doc;
+	if (!json || !JsonParser(json, jsonSize).Parse(doc))
+		return false;
+
+	//
+	// 遍历场景中的节点，每个三角形图元成为一个部分，节点变换烘焙进顶点
+	//
+
+	std::wstring dir = GetDirectory(glbFileName);
+	auto addMesh = [&](size_t meshIndex, FXMMATRIX world)
+	{
+		const JsonValue& mesh = doc["meshes"][meshIndex];
+		if (mesh.IsNull())
+			return false;
+		const JsonValue& primitives = mesh["primitives"];
+		for (size_t i = 0; i < primitives.Size(); ++i)
+		{
+			const JsonValue& primitive = primitives[i];
+			AddDefaultPart();
+			ObjPart& part = objParts.back();
+			if (!ReadGltfPrimitive(doc, primitive, bin, binSize, world, part))
+				return false;
+
+			// 金属度粗糙度材质近似为Phong材质：镜面反射颜色在非金属的0.04与基础色之间按金属度插值，
+			// 镜面系数由粗糙度按Blinn-Phong的常用近似2/r^4-2换算
+			const JsonValue& material = doc["materials"][primitive["material"].Index()];
+			if (material.IsNull())
+				continue;
+			const JsonValue& pbr = material["pbrMetallicRoughness"];
+			const JsonValue& baseColor = pbr["baseColorFactor"];
+			float r = (float)baseColor[0].Number(1.0), g = (float)baseColor[1].Number(1.0), b = (float)baseColor[2].Number(1.0);
+			const std::string& alphaMode = material["alphaMode"].str;
+			float alpha = alphaMode.empty() || alphaMode == "OPAQUE" ? 1.0f : (float)baseColor[3].Number(1.0);
+			float metallic = (float)pbr["metallicFactor"].Number(1.0);
+			float roughness = (float)pbr["roughnessFactor"].Number(1.0);
+			float r4 = (std::max)(roughness * roughness * roughness * roughness, 1e-4f);
+			part.material.ambient = XMFLOAT4(0.2f * r, 0.2f * g, 0.2f * b, alpha);
+			part.material.diffuse = XMFLOAT4(r, g, b, alpha);
+			part.material.specular = XMFLOAT4(0.04f + (r - 0.04f) * metallic, 0.04f + (g - 0.04f) * metallic,
+				0.04f + (b - 0.04f) * metallic, (std::min)((std::max)(2.0f / r4 - 2.0f, 1.0f), 256.0f));
+
+			// 只引用外部图像文件的纹理，嵌入BIN块或data URI的图像需要另外自行加载
+			size_t textureIndex = pbr["baseColorTexture"]["index"].Index();
+			const std::string& uri = doc["images"][doc["textures"][textureIndex]["source"].Index()]["uri"].str;
+			if (!uri.empty() && uri.compare(0, 5, "data:") != 0)
+			{
+				std::string path = DecodeUri(uri);
+				part.texStrDiffuse = dir + DecodeString(path.data(), path.data() + path.size());
+			}
+		}
+		return true;
+	};
+
+	const JsonValue& nodes = doc["nodes"];
+	const JsonValue& scenes = doc["scenes"];
+	if (scenes.Size() == 0)
+	{
+		// 没有场景时按原样读取全部网格
+		for (size_t i = 0; i < doc["meshes"].Size(); ++i)
+		{
+			if (!addMesh(i, XMMatrixIdentity()))
+				return false;
+		}
+	}
+	else
+	{
+		size_t sceneIndex = doc["scene"].IsNull() ? 0 : doc["scene"].Index();
+		const JsonValue& roots = scenes[sceneIndex]["nodes"];
+
+		// 深度优先遍历，按节点在文件中的顺序输出部分
+		// 合法的节点层次是树，深度超过节点数说明存在环
+		struct NodeEntry
+		{
+			size_t node;
+			size_t depth;
+			XMFLOAT4X4 parent;
+		};
+		std::vector<NodeEntry> stack;
+		XMFLOAT4X4 identity;
+		XMStoreFloat4x4(&identity, XMMatrixIdentity());
+		for (size_t i = roots.Size(); i > 0; --i)
+			stack.push_back(NodeEntry{ roots[i - 1].Index(), 0, identity });
+
+		while (!stack.empty())
+		{
+			NodeEntry entry = stack.back();
+			stack.pop_back();
+			const JsonValue& node = nodes[entry.node];
+			if (node.IsNull() || entry.depth > nodes.Size())
+				return false;
+
+			// glTF的矩阵按列主序存储，按行读入即为行向量形式的矩阵
+			XMMATRIX local;
+			const JsonValue& matrix = node["matrix"];
+			if (matrix.Size() == 16)
+			{
+				XMFLOAT4X4 m;
+				for (int i = 0; i < 16; ++i)
+					m.m[i / 4][i % 4] = (float)matrix[i].Number(0.0);
+				local = XMLoadFloat4x4(&m);
+			}
+			else
+			{
+				const JsonValue& t = node["translation"];
+				const JsonValue& q = node["rotation"];
+				const JsonValue& s = node["scale"];
+				local = XMMatrixScaling((float)s[0].Number(1.0), (float)s[1].Number(1.0), (float)s[2].Number(1.0)) *
+					XMMatrixRotationQuaternion(XMVectorSet((float)q[0].Number(0.0), (float)q[1].Number(0.0),
+						(float)q[2].Number(0.0), (float)q[3].Number(1.0))) *
+					XMMatrixTranslation((float)t[0].Number(0.0), (float)t[1].Number(0.0), (float)t[2].Number(0.0));
+			}
+			XMMATRIX world = local * XMLoadFloat4x4(&entry.parent);
+
+			if (!node["mesh"].IsNull() && !addMesh(node["mesh"].Index(), world))
+				return false;
+
+			const JsonValue& children = node["children"];
+			XMFLOAT4X4 childParent;
+			XMStoreFloat4x4(&childParent, world);
+			for (size_t i = children.Size(); i > 0; --i)
+				stack.push_back(NodeEntry{ children[i - 1].Index(), entry.depth + 1, childParent });
+		}
+	}
+
+	XMVECTOR vecMin = g_XMInfinity, vecMax = g_XMNegInfinity;
+	for (auto& part : objParts)
+	{
+		if (part.vertices.empty())
+			continue;
+		vecMin = XMVectorMin(vecMin, XMLoadFloat3(&part.bounds.vMin));
+		vecMax = XMVectorMax(vecMax, XMLoadFloat3(&part.bounds.vMax));
+	}
+	XMStoreFloat3(&vMax, vecMax);
+	XMStoreFloat3(&vMin, vecMin);
+
+	return true;
+}
+
+bool ObjReader::ReadMbo(const wchar_t * mboFileName)
+{
+	MboView view;
+	return view.Open(mboFileName) && CopyFrom(view);
+}
+
+bool ObjReader::ReadMboFromMemory(const char * data, size_t size)
+{
+	MboView view;
+	return view.Parse(data, size) && CopyFrom(view);
+}
+
+bool ObjReader::CopyFrom(const MboView & view)
+{
+	vMin = view.vMin;
+	vMax = view.vMax;
+	sourceHash = view.sourceHash;
+
+	objParts.resize(view.parts.size());
+	for (size_t i = 0; i < view.parts.size(); ++i)
+	{
+		const MboView::PartView& src = view.parts[i];
+		ObjPart& part = objParts[i];
+		part.material = src.material;
+		part.texStrDiffuse = src.texStrDiffuse;
+
+		// v1文件中的数组不一定对齐，统一使用memcpy拷贝
+		part.vertices.resize(src.vertexCount);
+		if (src.vertexCount)
+			memcpy(part.vertices.data(), src.vertices, src.vertexCount * sizeof(VertexPosNormalTex));
+
+		part.indices16.clear();
+		part.indices32.clear();
+		if (src.indexSize == sizeof(WORD))
+		{
+			part.indices16.resize(src.indexCount);
+			if (src.indexCount)
+				memcpy(part.indices16.data(), src.indices, src.indexCount * sizeof(WORD));
+		}
+		else
+		{
+			part.indices32.resize(src.indexCount);
+			if (src.indexCount)
+				memcpy(part.indices32.data(), src.indices, src.indexCount * sizeof(DWORD));
+		}
+
+		part.lods.resize(src.lods.size());
+		for (size_t j = 0; j < src.lods.size(); ++j)
+		{
+			const MboView::LodView& srcLod = src.lods[j];
+			ObjLod& lod = part.lods[j];
+			lod.error = srcLod.error;
+			lod.indices16.clear();
+			lod.indices32.clear();
+			if (src.indexSize == sizeof(WORD))
+				lod.indices16.assign(static_cast<const WORD*>(srcLod.indices), static_cast<const WORD*>(srcLod.indices) + srcLod.indexCount);
+			else
+				lod.indices32.assign(static_cast<const DWORD*>(srcLod.indices), static_cast<const DWORD*>(srcLod.indices) + srcLod.indexCount);
+		}
+		part.meshlets = src.meshlets;
+		part.bounds = src.bounds;
+	}
+
+	return true;
+}
+
+bool ObjReader::WriteMbo(const wchar_t * mboFileName, bool compressed)
+{
+	// 以v2格式写入，布局见MboFormat.h
+	auto align = [](uint64_t offset) { return (offset + Mbo::kAlignment - 1) & ~(uint64_t)(Mbo::kAlignment - 1); };
+	auto indexData = [](const std::vector<WORD>& indices16, const std::vector<DWORD>& indices32, bool use32)
+	{
+		return use32 ? static_cast<const void*>(indices32.data()) : static_cast<const void*>(indices16.data());
+	};
+
+	// 构建字符串表，相同的纹理文件名只保存一份
+	std::string strings;
+	std::map<std::wstring, uint32_t> stringOffsets;
+	std::vector<Mbo::PartDesc> descs(objParts.size());
+	// 各部分的LOD按部分顺序排列，lodSources为对应的索引数据
+	std::vector<Mbo::LodDesc> lodDescs;
+	std::vector<const void*> lodSources;
+	// 压缩时各部分(及其LOD)编码后的顶点与索引，原始格式时为空
+	std::vector<std::vector<Mbo::QuantizedVertex>> quantizedVertices(compressed ? objParts.size() : 0);
+	std::vector<std::vector<uint8_t>> encodedIndices(compressed ? objParts.size() : 0);
+	std::vector<std::vector<uint8_t>> encodedLodIndices;
+	std::vector<Mbo::MeshletDesc> meshletDescs;
+	std::vector<Mbo::BoundsDesc> boundsDescs(objParts.size());
+	// 量化顶点的位置误差不超过AABB盒各轴量化步长的一半，包围盒与簇及部分的包围球需要相应放大
+	XMVECTOR halfStep = g_XMZero;
+	float quantizationError = 0.0f;
+	if (compressed)
+	{
+		halfStep = (XMLoadFloat3(&vMax) - XMLoadFloat3(&vMin)) / 65535.0f * 0.5f;
+		quantizationError = XMVectorGetX(XMVector3Length(halfStep));
+	}
+	for (size_t i = 0; i < objParts.size(); ++i)
+	{
+		const ObjPart& part = objParts[i];
+		Mbo::PartDesc& desc = descs[i];
+		desc.material = part.material;
+		desc.texDiffuse = Mbo::kNoString;
+		if (!part.texStrDiffuse.empty())
+		{
+			auto it = stringOffsets.find(part.texStrDiffuse);
+			if (it == stringOffsets.end())
+			{
+				it = stringOffsets.emplace(part.texStrDiffuse, (uint32_t)strings.size()).first;
+				strings += EncodeString(part.texStrDiffuse);
+				strings.push_back('\0');
+			}
+			desc.texDiffuse = it->second;
+		}
+		desc.vertexCount = (uint32_t)part.vertices.size();
+		desc.vertexStride = compressed ? sizeof(Mbo::QuantizedVertex) : sizeof(VertexPosNormalTex);
+		// 索引宽度由实际存储决定
+		bool use32 = !part.indices32.empty();
+		desc.indexCount = (uint32_t)(use32 ? part.indices32.size() : part.indices16.size());
+		desc.indexSize = use32 ? sizeof(DWORD) : sizeof(WORD);
+		desc.encoding = compressed ? Mbo::EncodingQuantizedVertices | Mbo::EncodingVarintIndices : 0;
+
+		if (compressed)
+		{
+			quantizedVertices[i].resize(desc.vertexCount);
+			Mbo::EncodeVertices(part.vertices.data(), desc.vertexCount, vMin, vMax, quantizedVertices[i].data());
+			Mbo::EncodeIndices(indexData(part.indices16, part.indices32, use32), desc.indexCount, desc.indexSize, encodedIndices[i]);
+		}
+
+		for (const ObjLod& lod : part.lods)
+		{
+			Mbo::LodDesc lodDesc = {};
+			lodDesc.partIndex = (uint32_t)i;
+			lodDesc.indexCount = (uint32_t)(use32 ? lod.indices32.size() : lod.indices16.size());
+			lodDesc.error = lod.error;
+			lodDescs.push_back(lodDesc);
+			lodSources.push_back(indexData(lod.indices16, lod.indices32, use32));
+			if (compressed)
+			{
+				encodedLodIndices.emplace_back();
+				Mbo::EncodeIndices(lodSources.back(), lodDesc.indexCount, desc.indexSize, encodedLodIndices.back());
+			}
+		}
+
+		for (const ObjMeshlet& meshlet : part.meshlets)
+		{
+			Mbo::MeshletDesc meshletDesc = {};
+			meshletDesc.partIndex = (uint32_t)i;
+			meshletDesc.startIndex = meshlet.startIndex;
+			meshletDesc.indexCount = meshlet.indexCount;
+			meshletDesc.center = meshlet.center;
+			meshletDesc.radius = meshlet.radius + quantizationError;
+			meshletDesc.coneAxis = meshlet.coneAxis;
+			meshletDesc.coneCutoff = meshlet.coneCutoff;
+			meshletDescs.push_back(meshletDesc);
+		}
+
+		Mbo::BoundsDesc& boundsDesc = boundsDescs[i];
+		XMStoreFloat3(&boundsDesc.vMin, XMLoadFloat3(&part.bounds.vMin) - halfStep);
+		XMStoreFloat3(&boundsDesc.vMax, XMLoadFloat3(&part.bounds.vMax) + halfStep);
+		boundsDesc.center = part.bounds.center;
+		boundsDesc.radius = part.bounds.radius + quantizationError;
+	}
+
+	// 源数据信息只在已知源文件哈希时写入，LOD节、簇节与包围体节只在存在相应数据时写入
+	const uint32_t sectionCount = 4 + (sourceHash ? 1 : 0) + (lodDescs.empty() ? 0 : 1) + (meshletDescs.empty() ? 0 : 1) +
+		(boundsDescs.empty() ? 0 : 1);
+
+	// 计算各节及各部分数据的偏移
+	Mbo::SectionEntry sections[8] = {};
+	uint64_t offset = align(sizeof(Mbo::FileHeader) + sectionCount * sizeof(Mbo::SectionEntry));
+	sections[0] = { Mbo::SectionParts, 0, offset, descs.size() * sizeof(Mbo::PartDesc) };
+	offset = align(offset + sections[0].size);
+	sections[1] = { Mbo::SectionStrings, 0, offset, strings.size() };
+	offset = align(offset + sections[1].size);
+	sections[2] = { Mbo::SectionVertices, 0, offset, 0 };
+	for (auto& desc : descs)
+	{
+		desc.vertexOffset = offset;
+		offset = align(offset + (uint64_t)desc.vertexCount * desc.vertexStride);
+	}
+	sections[2].size = offset - sections[2].offset;
+	sections[3] = { Mbo::SectionIndices, 0, offset, 0 };
+	for (size_t i = 0, lod = 0; i < descs.size(); ++i)
+	{
+		// 各级LOD的索引紧随所属部分的索引，未压缩时不对齐，使原始网格与LOD的索引成为一段连续的数组
+		descs[i].indexOffset = offset;
+		offset += compressed ? encodedIndices[i].size() : (uint64_t)descs[i].indexCount * descs[i].indexSize;
+		for (; lod < lodDescs.size() && lodDescs[lod].partIndex == i; ++lod)
+		{
+			lodDescs[lod].indexOffset = compressed ? align(offset) : offset;
+			offset = lodDescs[lod].indexOffset +
+				(compressed ? encodedLodIndices[lod].size() : (uint64_t)lodDescs[lod].indexCount * descs[i].indexSize);
+		}
+		offset = align(offset);
+	}
+	sections[3].size = offset - sections[3].offset;
+	uint32_t sectionIndex = 4;
+	Mbo::SourceInfo source = { sourceHash, MboCache::importerVersion, 0 };
+	const Mbo::SectionEntry* sourceSection = nullptr;
+	if (sourceHash)
+	{
+		sections[sectionIndex] = { Mbo::SectionSource, 0, offset, sizeof(source) };
+		sourceSection = &sections[sectionIndex++];
+		offset = align(offset + sizeof(source));
+	}
+	const Mbo::SectionEntry* lodSection = nullptr;
+	if (!lodDescs.empty())
+	{
+		sections[sectionIndex] = { Mbo::SectionLods, 0, offset, lodDescs.size() * sizeof(Mbo::LodDesc) };
+		lodSection = &sections[sectionIndex++];
+		offset = align(offset + lodSection->size);
+	}
+	const Mbo::SectionEntry* meshletSection = nullptr;
+	if (!meshletDescs.empty())
+	{
+		sections[sectionIndex] = { Mbo::SectionMeshlets, 0, offset, meshletDescs.size() * sizeof(Mbo::MeshletDesc) };
+		meshletSection = &sections[sectionIndex++];
+		offset = align(offset + meshletSection->size);
+	}
+	const Mbo::SectionEntry* boundsSection = nullptr;
+	if (!boundsDescs.empty())
+	{
+		sections[sectionIndex] = { Mbo::SectionBounds, 0, offset, boundsDescs.size() * sizeof(Mbo::BoundsDesc) };
+		boundsSection = &sections[sectionIndex++];
+		offset = align(offset + boundsSection->size);
+	}
+
+	Mbo::FileHeader header;
+	header.magic = Mbo::kMagic;
+	header.version = Mbo::kVersion;
+	header.headerSize = sizeof(header);
+	header.sectionCount = sectionCount;
+	header.vMin = vMin;
+	header.vMax = vMax;
+	header.fileSize = offset;
+
+	// 在内存中组装完整的文件，填充字节为0
+	std::vector<char> bytes((size_t)header.fileSize);
+	memcpy(bytes.data(), &header, sizeof(header));
+	memcpy(bytes.data() + sizeof(header), sections, sectionCount * sizeof(Mbo::SectionEntry));
+	if (sourceSection)
+		memcpy(bytes.data() + sourceSection->offset, &source, sizeof(source));
+	if (lodSection)
+		memcpy(bytes.data() + lodSection->offset, lodDescs.data(), (size_t)lodSection->size);
+	if (meshletSection)
+		memcpy(bytes.data() + meshletSection->offset, meshletDescs.data(), (size_t)meshletSection->size);
+	if (boundsSection)
+		memcpy(bytes.data() + boundsSection->offset, boundsDescs.data(), (size_t)boundsSection->size);
+	if (!descs.empty())
+		memcpy(bytes.data() + sections[0].offset, descs.data(), (size_t)sections[0].size);
+	if (!strings.empty())
+		memcpy(bytes.data() + sections[1].offset, strings.data(), strings.size());
+	for (size_t i = 0; i < objParts.size(); ++i)
+	{
+		const ObjPart& part = objParts[i];
+		const Mbo::PartDesc& desc = descs[i];
+		if (compressed)
+		{
+			if (desc.vertexCount)
+				memcpy(bytes.data() + desc.vertexOffset, quantizedVertices[i].data(), (size_t)desc.vertexCount * desc.vertexStride);
+			if (!encodedIndices[i].empty())
+				memcpy(bytes.data() + desc.indexOffset, encodedIndices[i].data(), encodedIndices[i].size());
+			continue;
+		}
+		if (desc.vertexCount)
+			memcpy(bytes.data() + desc.vertexOffset, part.vertices.data(), (size_t)desc.vertexCount * desc.vertexStride);
+		if (desc.indexCount)
+			memcpy(bytes.data() + desc.indexOffset, indexData(part.indices16, part.indices32, desc.indexSize == sizeof(DWORD)),
+				(size_t)desc.indexCount * desc.indexSize);
+	}
+	for (size_t lod = 0; lod < lodDescs.size(); ++lod)
+	{
+		const Mbo::LodDesc& lodDesc = lodDescs[lod];
+		if (compressed)
+		{
+			if (!encodedLodIndices[lod].empty())
+				memcpy(bytes.data() + lodDesc.indexOffset, encodedLodIndices[lod].data(), encodedLodIndices[lod].size());
+		}
+		else if (lodDesc.indexCount)
+		{
+			memcpy(bytes.data() + lodDesc.indexOffset, lodSources[lod], (size_t)lodDesc.indexCount * descs[lodDesc.partIndex].indexSize);
+		}
+	}
+
+	return WriteFileBytes(mboFileName, bytes.data(), bytes.size());
+}
+
+void ObjReader::AddDefaultPart()
+{
+	objParts.emplace_back(DefaultPart());
+}
+
+ObjReader::ObjPart ObjReader::DefaultPart()
+{
+	ObjPart part;
+	// 提供默认材质
+	part.material.ambient = XMFLOAT4(0.2f, 0.2f, 0.2f, 1.0f);
+	part.material.diffuse = XMFLOAT4(0.8f, 0.8f, 0.8f, 1.0f);
+	part.material.specular = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+	return part;
+}
+
+ObjReader::ObjBounds ObjReader::ComputeBounds(const void * vertices, size_t vertexCount, size_t vertexStride)
+{
+	ObjBounds bounds;
+	if (vertexCount == 0)
+		return bounds;
+
+	// 顶点数据不一定对齐(如v1文件)，通过memcpy读取位置
+	const char* base = static_cast<const char*>(vertices);
+	auto load = [base, vertexStride](size_t i)
+	{
+		XMFLOAT3 pos;
+		memcpy(&pos, base + i * vertexStride, sizeof(pos));
+		return XMLoadFloat3(&pos);
+	};
+
+	// 每次处理4个顶点：p为各顶点的位置，x、y、z为转置后的分量，便于同时求4个距离
+	// 末尾不足4个时重复最后一个顶点，重复的顶点不会改变下面任何一步的结果
+	struct Batch
+	{
+		XMVECTOR p[4];
+		XMVECTOR x, y, z;
+	};
+	auto loadBatch = [&](size_t i, Batch& batch)
+	{
+		for (size_t k = 0; k < 4; ++k)
+			batch.p[k] = load((std::min)(i + k, vertexCount - 1));
+		XMVECTOR t0 = XMVectorMergeXY(batch.p[0], batch.p[2]);
+		XMVECTOR t1 = XMVectorMergeXY(batch.p[1], batch.p[3]);
+		XMVECTOR t2 = XMVectorMergeZW(batch.p[0], batch.p[2]);
+		XMVECTOR t3 = XMVectorMergeZW(batch.p[1], batch.p[3]);
+		batch.x = XMVectorMergeXY(t0, t1);
+		batch.y = XMVectorMergeZW(t0, t1);
+		batch.z = XMVectorMergeXY(t2, t3);
+	};
+	// 4个顶点到c的距离的平方
+	auto distSq = [](const Batch& batch, FXMVECTOR c)
+	{
+		XMVECTOR dx = batch.x - XMVectorSplatX(c);
+		XMVECTOR dy = batch.y - XMVectorSplatY(c);
+		XMVECTOR dz = batch.z - XMVectorSplatZ(c);
+		return dx * dx + dy * dy + dz * dz;
+	};
+	// 有更远的顶点时按顺序更新，与逐个比较的结果相同
+	auto updateFarthest = [](const Batch& batch, FXMVECTOR distSqs, float& maxDistSq, XMVECTOR& result)
+	{
+		if (XMVector4LessOrEqual(distSqs, XMVectorReplicate(maxDistSq)))
+			return;
+		XMFLOAT4 d;
+		XMStoreFloat4(&d, distSqs);
+		const float* ds = &d.x;
+		for (size_t k = 0; k < 4; ++k)
+		{
+			if (ds[k] > maxDistSq)
+			{
+				maxDistSq = ds[k];
+				result = batch.p[k];
+			}
+		}
+	};
+	Batch batch;
+
+	// AABB盒，同时求出距第一个顶点最远的顶点p0
+	XMVECTOR vecMin = g_XMInfinity, vecMax = g_XMNegInfinity;
+	XMVECTOR first = load(0), p0 = first;
+	float maxDistSq = 0.0f;
+	for (size_t i = 0; i < vertexCount; i += 4)
+	{
+		loadBatch(i, batch);
+		vecMin = XMVectorMin(vecMin, XMVectorMin(XMVectorMin(batch.p[0], batch.p[1]), XMVectorMin(batch.p[2], batch.p[3])));
+		vecMax = XMVectorMax(vecMax, XMVectorMax(XMVectorMax(batch.p[0], batch.p[1]), XMVectorMax(batch.p[2], batch.p[3])));
+		updateFarthest(batch, distSq(batch, first), maxDistSq, p0);
+	}
+
+	// Ritter：以近似的最远点对为直径作初始球，再逐个扩大以包含落在球外的顶点
+	XMVECTOR p1 = p0;
+	maxDistSq = 0.0f;
+	for (size_t i = 0; i < vertexCount; i += 4)
 	{
-		return true;
+		loadBatch(i, batch);
+		updateFarthest(batch, distSq(batch, p0), maxDistSq, p1);
 	}
-	else if (objFileName)
+	XMVECTOR center = (p0 + p1) * 0.5f;
+	float radius = XMVectorGetX(XMVector3Length(p1 - p0)) * 0.5f;
+	for (size_t i = 0; i < vertexCount; i += 4)
 	{
-		bool status = ReadObj(objFileName);
-		if (status && mboFileName)
-			return WriteMbo(mboFileName);
-		return status;
+		loadBatch(i, batch);
+		// 绝大多数顶点已在球内，整批跳过
+		if (XMVector4LessOrEqual(distSq(batch, center), XMVectorReplicate(radius * radius)))
+			continue;
+		for (size_t k = 0; k < 4; ++k)
+		{
+			XMVECTOR offset = batch.p[k] - center;
+			float dist = XMVectorGetX(XMVector3Length(offset));
+			if (dist > radius)
+			{
+				float newRadius = (radius + dist) * 0.5f;
+				center += offset * ((newRadius - radius) / dist);
+				radius = newRadius;
+			}
+		}
 	}
 
-	return false;
+	// 分别以Ritter球心与AABB盒中心求出包含全部顶点的半径，取较小的球
+	XMVECTOR boxCenter = (vecMin + vecMax) * 0.5f;
+	XMVECTOR maxDistSqs = g_XMZero, maxBoxDistSqs = g_XMZero;
+	for (size_t i = 0; i < vertexCount; i += 4)
+	{
+		loadBatch(i, batch);
+		maxDistSqs = XMVectorMax(maxDistSqs, distSq(batch, center));
+		maxBoxDistSqs = XMVectorMax(maxBoxDistSqs, distSq(batch, boxCenter));
+	}
+	auto horizontalMax = [](FXMVECTOR v)
+	{
+		XMFLOAT4 f;
+		XMStoreFloat4(&f, v);
+		return (std::max)((std::max)(f.x, f.y), (std::max)(f.z, f.w));
+	};
+	maxDistSq = horizontalMax(maxDistSqs);
+	float maxBoxDistSq = horizontalMax(maxBoxDistSqs);
+	if (maxBoxDistSq < maxDistSq)
+	{
+		center = boxCenter;
+		maxDistSq = maxBoxDistSq;
+	}
+
+	// 补偿距离计算中的舍入误差，保证每个顶点都在球内
+	XMVECTOR magnitude = XMVectorMax(XMVectorAbs(vecMin), XMVectorAbs(vecMax));
+	float maxCoord = (std::max)((std::max)(XMVectorGetX(magnitude), XMVectorGetY(magnitude)), XMVectorGetZ(magnitude));
+	XMStoreFloat3(&bounds.vMin, vecMin);
+	XMStoreFloat3(&bounds.vMax, vecMax);
+	XMStoreFloat3(&bounds.center, center);
+	bounds.radius = sqrtf(maxDistSq) * (1.0f + 4.0f * FLT_EPSILON) + maxCoord * 4.0f * FLT_EPSILON;
+	return bounds;
 }
 
-bool ObjReader::ReadObj(const wchar_t * objFileName)
+void ObjReader::ReleaseGeometry()
 {
-	objParts.clear();
-	vertexCache.clear();
+	// clear不会归还容量，需要与空对象交换
+	std::vector<ObjPart>().swap(objParts);
+	vertexCache = VertexCache();
+}
 
-	MtlReader mtlReader;
+size_t ObjReader::GetGeometryByteSize() const
+{
+	size_t byteSize = objParts.capacity() * sizeof(ObjPart);
+	for (auto& part : objParts)
+	{
+		byteSize += part.vertices.capacity() * sizeof(VertexPosNormalTex);
+		byteSize += part.indices16.capacity() * sizeof(WORD);
+		byteSize += part.indices32.capacity() * sizeof(DWORD);
+		byteSize += part.lods.capacity() * sizeof(ObjLod);
+		for (auto& lod : part.lods)
+			byteSize += lod.indices16.capacity() * sizeof(WORD) + lod.indices32.capacity() * sizeof(DWORD);
+		byteSize += part.meshlets.capacity() * sizeof(ObjMeshlet);
+	}
+	return byteSize;
+}
 
-	std::vector<XMFLOAT3>   positions;
-	std::vector<XMFLOAT3>   normals;
-	std::vector<XMFLOAT2>   texCoords;
+float ObjReader::GetVertexCacheHitRate() const
+{
+	return vertexLookups ? (float)vertexCacheHits / vertexLookups : 0.0f;
+}
 
-	XMVECTOR vecMin = g_XMInfinity, vecMax = g_XMNegInfinity;
+bool ObjReader::AddVertex(ObjPart& part, VertexCache& cache, const VertexPosNormalTex& vertex, DWORD vpi, DWORD vti, DWORD vni)
+{
+	// 寻找是否有重复顶点
+	DWORD newPos = (DWORD)part.vertices.size();
+	DWORD pos = cache.FindOrInsert(vpi, vti, vni, newPos);
+	part.indices32.push_back(pos);
+	if (pos != newPos)
+		return true;
 
-	std::wifstream wfin(objFileName);
-	if (!wfin.is_open())
-		return false;
+	part.vertices.push_back(vertex);
+	return false;
+}
 
-	// 切换中文
-	std::locale china("chs");
-	china = wfin.imbue(china);
-	for (;;)
+bool ObjReader::AddFaces(ObjPart& part, VertexCache& cache, const DWORD* faces, size_t faceCount,
+	const std::vector<XMFLOAT3>& positions, const std::vector<XMFLOAT3>& normals,
+	const std::vector<XMFLOAT2>& texCoords, size_t& hits)
+{
+	VertexPosNormalTex vertex;
+	const DWORD* facesEnd = faces + faceCount * 9;
+	for (; faces < facesEnd; faces += 3)
 	{
-		std::wstring wstr;
-		if (!(wfin >> wstr))
-			break;
+		DWORD vpi = faces[0], vti = faces[1], vni = faces[2];
+		if (vpi - 1 >= positions.size() || vti - 1 >= texCoords.size() || vni - 1 >= normals.size())
+			return false;
+		vertex.pos = positions[vpi - 1];
+		vertex.normal = normals[vni - 1];
+		vertex.tex = texCoords[vti - 1];
+		hits += AddVertex(part, cache, vertex, vpi, vti, vni);
+	}
+	return true;
+}
 
-		if (wstr[0] == '#')
-		{
-			//
-			// 忽略注释所在行
-			//
-			while (!wfin.eof() && wfin.get() != '\n')
-				continue;
-		}
-		else if (wstr == L"o" || wstr == L"g")
-		{
-			// 
-			// 对象名(组名)
-			//
-			objParts.emplace_back(ObjPart());
-			// 提供默认材质
-			objParts.back().material.ambient = XMFLOAT4(0.2f, 0.2f, 0.2f, 1.0f);
-			objParts.back().material.diffuse = XMFLOAT4(0.8f, 0.8f, 0.8f, 1.0f);
-			objParts.back().material.specular = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+void ObjReader::FinishPart(ObjPart& part)
+{
+	// 顶点数不超过WORD的最大值的话就使用16位WORD存储
+	if (part.vertices.size() < 65535)
+	{
+		part.indices16.assign(part.indices32.begin(), part.indices32.end());
+		std::vector<DWORD>().swap(part.indices32);
+	}
+	part.bounds = ComputeBounds(part.vertices.data(), part.vertices.size());
+}
 
-			vertexCache.clear();
-		}
-		else if (wstr == L"v")
-		{
-			//
-			// 顶点位置
-			//
+void ObjReader::VertexCache::Reset(size_t expectedCount)
+{
+	// 保持装载因子不超过0.5
+	size_t capacity = 16;
+	while (capacity < expectedCount * 2)
+		capacity <<= 1;
 
-			// 注意obj使用的是右手坐标系，而不是左手坐标系
-			// 需要将z值反转
-			XMFLOAT3 pos;
-			wfin >> pos.x >> pos.y >> pos.z;
-			pos.z = -pos.z;
-			positions.push_back(pos);
-			XMVECTOR vecPos = XMLoadFloat3(&pos);
-			vecMax = XMVectorMax(vecMax, vecPos);
-			vecMin = XMVectorMin(vecMin, vecPos);
-		}
-		else if (wstr == L"vt")
-		{
-			//
-			// 顶点纹理坐标
-			//
+	m_Entries.assign(capacity, Entry{});
+	m_Mask = capacity - 1;
+	m_Count = 0;
+}
 
-			// 注意obj使用的是笛卡尔坐标系，而不是纹理坐标系
-			float u, v;
-			wfin >> u >> v;
-			v = 1.0f - v;
-			texCoords.emplace_back(XMFLOAT2(u, v));
-		}
-		else if (wstr == L"vn")
-		{
-			//
-			// 顶点法向量
-			//
+DWORD ObjReader::VertexCache::FindOrInsert(DWORD vpi, DWORD vti, DWORD vni, DWORD value)
+{
+	if (m_Entries.empty() || (m_Count + 1) * 4 > m_Entries.size() * 3)
+		Grow();
 
-			// 注意obj使用的是右手坐标系，而不是左手坐标系
-			// 需要将z值反转
-			float x, y, z;
-			wfin >> x >> y >> z;
-			z = -z;
-			normals.emplace_back(XMFLOAT3(x, y, z));
-		}
-		else if (wstr == L"mtllib")
-		{
-			//
-			// 指定某一文件的材质
-			//
-			std::wstring mtlFile;
-			wfin >> mtlFile;
-			// 去掉前后空格
-			size_t beg = 0, ed = mtlFile.size();
-			while (iswspace(mtlFile[beg]))
-				beg++;
-			while (ed > beg && iswspace(mtlFile[ed - 1]))
-				ed--;
-			mtlFile = mtlFile.substr(beg, ed - beg);
-			// 获取路径
-			std::wstring dir = objFileName;
-			size_t pos;
-			if ((pos = dir.find_last_of('/')) == std::wstring::npos &&
-				(pos = dir.find_last_of('\\')) == std::wstring::npos)
-			{
-				pos = 0;
-			}
-			else
-			{
-				pos += 1;
-			}
-				
+	// 混合三个索引，再用MurmurHash3的收尾步骤打散
+	unsigned int h = vpi * 0x9E3779B1u ^ vti * 0x85EBCA77u ^ vni * 0xC2B2AE3Du;
+	h ^= h >> 16;
+	h *= 0x85EBCA6Bu;
+	h ^= h >> 13;
+	h *= 0xC2B2AE35u;
+	h ^= h >> 16;
 
-			mtlReader.ReadMtl((dir.erase(pos) + mtlFile).c_str());
-		}
-		else if (wstr == L"usemtl")
+	for (size_t i = h & m_Mask; ; i = (i + 1) & m_Mask)
+	{
+		Entry& entry = m_Entries[i];
+		if (entry.vpi == 0)
 		{
-			//
-			// 使用之前指定文件内部的某一材质
-			//
-			std::wstring mtlName;
-			std::getline(wfin, mtlName);
-			// 去掉前后空格
-			size_t beg = 0, ed = mtlName.size();
-			while (iswspace(mtlName[beg]))
-				beg++;
-			while (ed > beg && iswspace(mtlName[ed - 1]))
-				ed--;
-			mtlName = mtlName.substr(beg, ed - beg);
-
-			objParts.back().material = mtlReader.materials[mtlName];
-			objParts.back().texStrDiffuse = mtlReader.mapKdStrs[mtlName];
+			entry = Entry{ vpi, vti, vni, value };
+			++m_Count;
+			return value;
 		}
-		else if (wstr == L"f")
-		{
-			//
-			// 几何面
-			//
-			VertexPosNormalTex vertex;
-			DWORD vpi[3], vni[3], vti[3];
-			wchar_t ignore;
+		if (entry.vpi == vpi && entry.vti == vti && entry.vni == vni)
+			return entry.value;
+	}
+}
 
-			// 顶点位置索引/纹理坐标索引/法向量索引
-			// 原来右手坐标系下顶点顺序是逆时针排布
-			// 现在需要转变为左手坐标系就需要将三角形顶点反过来输入
-			for (int i = 2; i >= 0; --i)
-			{
-				wfin >> vpi[i] >> ignore >> vti[i] >> ignore >> vni[i];
-			}
+void ObjReader::VertexCache::Grow()
+{
+	std::vector<Entry> oldEntries;
+	oldEntries.swap(m_Entries);
+	Reset(oldEntries.empty() ? 0 : oldEntries.size());
+	for (auto& entry : oldEntries)
+	{
+		if (entry.vpi != 0)
+			FindOrInsert(entry.vpi, entry.vti, entry.vni, entry.value);
+	}
+}
 
-			for (int i = 0; i < 3; ++i)
-			{
-				vertex.pos = positions[vpi[i] - 1];
-				vertex.normal = normals[vni[i] - 1];
-				vertex.tex = texCoords[vti[i] - 1];
-				AddVertex(vertex, vpi[i], vti[i], vni[i]);
-			}
-			
 
-			while (iswblank(wfin.peek()))
-				wfin.get();
-			// 几何面顶点数可能超过了3，不支持该格式
-			if (wfin.peek() != '\n')
-				return false;
-		}
-	}
 
-	// 顶点数不超过WORD的最大值的话就使用16位WORD存储
-	for (auto& part : objParts)
+bool MboView::Open(const wchar_t * mboFileName)
+{
+	Close();
+	if (!mappedFile.Open(mboFileName))
+		return false;
+	if (!Parse(mappedFile.GetData(), mappedFile.GetSize()))
 	{
-		if (part.vertices.size() < 65535)
-		{
-			for (auto& i : part.indices32)
-			{
-				part.indices16.push_back((WORD)i);
-			}
-			part.indices32.clear();
-		}
+		Close();
+		return false;
 	}
+	return true;
+}
 
-	XMStoreFloat3(&vMax, vecMax);
-	XMStoreFloat3(&vMin, vecMin);
+bool MboView::Parse(const char * data, size_t size)
+{
+	parts.clear();
+	decodedData.clear();
+	sourceHash = 0;
 
-	return true;
+	uint32_t magic = 0;
+	if (size >= sizeof(magic))
+		memcpy(&magic, data, sizeof(magic));
+
+	if (magic == Mbo::kMagic)
+		return ParseV2(data, size);
+	return ParseV1(data, size);
 }
 
-bool ObjReader::ReadMbo(const wchar_t * mboFileName)
+void MboView::Close()
+{
+	parts.clear();
+	decodedData.clear();
+	mappedFile.Close();
+}
+
+bool MboView::ParseV1(const char * data, size_t size)
 {
 	// [Part数目] 4字节
 	// [AABB盒顶点vMax] 12字节
@@ -221,140 +2452,421 @@ bool ObjReader::ReadMbo(const wchar_t * mboFileName)
 	//   [索引]2(或4)*索引数 字节，取决于顶点数是否不超过65535
 	// ]
 	// ...
-	std::ifstream fin(mboFileName, std::ios::in | std::ios::binary);
-	if (!fin.is_open())
-		return false;
+	const char* p = data;
+	const char* end = data + size;
+	auto read = [&](void* dst, size_t byteWidth)
+	{
+		if ((size_t)(end - p) < byteWidth)
+			return false;
+		memcpy(dst, p, byteWidth);
+		p += byteWidth;
+		return true;
+	};
 
-	UINT parts = (UINT)objParts.size();
+	UINT partCount = 0;
 	// [Part数目] 4字节
-	fin.read(reinterpret_cast<char*>(&parts), sizeof(UINT));
-	objParts.resize(parts);
-
 	// [AABB盒顶点vMax] 12字节
-	fin.read(reinterpret_cast<char*>(&vMax), sizeof(XMFLOAT3));
 	// [AABB盒顶点vMin] 12字节
-	fin.read(reinterpret_cast<char*>(&vMin), sizeof(XMFLOAT3));
-
+	if (!read(&partCount, sizeof(UINT)) || !read(&vMax, sizeof(XMFLOAT3)) || !read(&vMin, sizeof(XMFLOAT3)))
+		return false;
+	// 每个部分至少占用592字节，据此排除损坏的文件
+	if (partCount > (size_t)(end - p) / (MAX_PATH * sizeof(uint16_t) + sizeof(Material) + 2 * sizeof(UINT)))
+		return false;
+	parts.resize(partCount);
 
-	for (UINT i = 0; i < parts; ++i)
+	for (UINT i = 0; i < partCount; ++i)
 	{
-		wchar_t filePath[MAX_PATH];
+		PartView& part = parts[i];
 		// [漫射光材质文件名]520字节
-		fin.read(reinterpret_cast<char*>(filePath), MAX_PATH * sizeof(wchar_t));
-		objParts[i].texStrDiffuse = filePath;
+		// 文件中保存的是Windows下2字节的wchar_t
+		uint16_t filePath[MAX_PATH];
+		if (!read(filePath, sizeof(filePath)))
+			return false;
+		part.texStrDiffuse.clear();
+		part.lods.clear();
+		part.meshlets.clear();
+		for (UINT j = 0; j < MAX_PATH && filePath[j]; ++j)
+			part.texStrDiffuse.push_back((wchar_t)filePath[j]);
 		// [材质]64字节
-		fin.read(reinterpret_cast<char*>(&objParts[i].material), sizeof(Material));
-		UINT vertexCount, indexCount;
 		// [顶点数]4字节
-		fin.read(reinterpret_cast<char*>(&vertexCount), sizeof(UINT));
 		// [索引数]4字节
-		fin.read(reinterpret_cast<char*>(&indexCount), sizeof(UINT));
+		if (!read(&part.material, sizeof(Material)) ||
+			!read(&part.vertexCount, sizeof(UINT)) || !read(&part.indexCount, sizeof(UINT)))
+			return false;
+		part.indexSize = part.vertexCount > 65535 ? sizeof(DWORD) : sizeof(WORD);
+		if ((size_t)(end - p) / sizeof(VertexPosNormalTex) < part.vertexCount ||
+			(size_t)(end - p - part.vertexCount * sizeof(VertexPosNormalTex)) / part.indexSize < part.indexCount)
+			return false;
+
 		// [顶点]32*顶点数 字节
-		objParts[i].vertices.resize(vertexCount);
-		fin.read(reinterpret_cast<char*>(objParts[i].vertices.data()), vertexCount * sizeof(VertexPosNormalTex));
+		part.vertices = reinterpret_cast<const VertexPosNormalTex*>(p);
+		p += part.vertexCount * sizeof(VertexPosNormalTex);
+		// [索引]2(或4)*索引数 字节
+		part.indices = p;
+		p += part.indexCount * part.indexSize;
+		if (!IndicesInRange(part.indices, part.indexCount, part.indexSize, part.vertexCount))
+			return false;
+		// v1文件没有记录包围体
+		part.bounds = ObjReader::ComputeBounds(part.vertices, part.vertexCount);
+	}
+
+	return true;
+}
+
+bool MboView::ParseV2(const char * data, size_t size)
+{
+	// 布局见MboFormat.h
+	Mbo::FileHeader header;
+	if (size < sizeof(header))
+		return false;
+	memcpy(&header, data, sizeof(header));
+	if (header.version != Mbo::kVersion || header.headerSize != sizeof(header) || header.fileSize != size ||
+		header.sectionCount > (size - sizeof(header)) / sizeof(Mbo::SectionEntry))
+		return false;
+
+	// 检查数据范围[offset, offset + byteWidth)是否位于文件内
+	auto inRange = [size](uint64_t offset, uint64_t byteWidth)
+	{
+		return offset <= size && byteWidth <= size - offset;
+	};
+
+	const char* partData = nullptr;
+	const char* strings = nullptr;
+	const char* lodData = nullptr;
+	const char* meshletData = nullptr;
+	const char* boundsData = nullptr;
+	uint64_t partBytes = 0, stringBytes = 0, lodBytes = 0, meshletBytes = 0, boundsBytes = 0;
+	for (uint32_t i = 0; i < header.sectionCount; ++i)
+	{
+		Mbo::SectionEntry section;
+		memcpy(&section, data + sizeof(header) + i * sizeof(section), sizeof(section));
+		if (!inRange(section.offset, section.size))
+			return false;
+		if (section.type == Mbo::SectionParts)
+		{
+			partData = data + section.offset;
+			partBytes = section.size;
+		}
+		else if (section.type == Mbo::SectionStrings)
+		{
+			strings = data + section.offset;
+			stringBytes = section.size;
+		}
+		else if (section.type == Mbo::SectionLods)
+		{
+			lodData = data + section.offset;
+			lodBytes = section.size;
+		}
+		else if (section.type == Mbo::SectionMeshlets)
+		{
+			meshletData = data + section.offset;
+			meshletBytes = section.size;
+		}
+		else if (section.type == Mbo::SectionBounds)
+		{
+			boundsData = data + section.offset;
+			boundsBytes = section.size;
+		}
+		else if (section.type == Mbo::SectionSource && section.size >= sizeof(Mbo::SourceInfo))
+		{
+			Mbo::SourceInfo source;
+			memcpy(&source, data + section.offset, sizeof(source));
+			sourceHash = source.contentHash;
+		}
+		// 顶点与索引节通过PartDesc中的偏移直接访问，未知的节忽略
+	}
+	// 包围体节存在时需要与部分一一对应
+	if (!partData || partBytes % sizeof(Mbo::PartDesc) != 0 || lodBytes % sizeof(Mbo::LodDesc) != 0 ||
+		meshletBytes % sizeof(Mbo::MeshletDesc) != 0 ||
+		(boundsData && boundsBytes / sizeof(Mbo::BoundsDesc) * sizeof(Mbo::PartDesc) != partBytes) ||
+		boundsBytes % sizeof(Mbo::BoundsDesc) != 0)
+		return false;
+
+	vMin = header.vMin;
+	vMax = header.vMax;
+
+	size_t partCount = (size_t)(partBytes / sizeof(Mbo::PartDesc));
+	parts.resize(partCount);
+	// varint索引解码到每个部分一段连续的内存中，原始网格在前，各级LOD依次紧随其后，
+	// 与未压缩的文件一样可以整段创建索引缓冲区；lodCursors为下一级LOD解码的位置
+	size_t lodCount = (size_t)(lodBytes / sizeof(Mbo::LodDesc));
+	std::vector<uint64_t> lodIndexCounts(partCount, 0);
+	std::vector<uint8_t*> lodCursors(partCount, nullptr);
+	for (size_t i = 0; i < lodCount; ++i)
+	{
+		Mbo::LodDesc lodDesc;
+		memcpy(&lodDesc, lodData + i * sizeof(lodDesc), sizeof(lodDesc));
+		if (lodDesc.partIndex >= partCount)
+			return false;
+		lodIndexCounts[lodDesc.partIndex] += lodDesc.indexCount;
+	}
+	for (size_t i = 0; i < partCount; ++i)
+	{
+		Mbo::PartDesc desc;
+		memcpy(&desc, partData + i * sizeof(desc), sizeof(desc));
+		bool quantized = (desc.encoding & Mbo::EncodingQuantizedVertices) != 0;
+		bool varint = (desc.encoding & Mbo::EncodingVarintIndices) != 0;
+		// varint索引的长度不固定，解码时以文件末尾为界
+		if ((desc.encoding & ~(uint32_t)(Mbo::EncodingQuantizedVertices | Mbo::EncodingVarintIndices)) ||
+			desc.vertexStride != (quantized ? sizeof(Mbo::QuantizedVertex) : sizeof(VertexPosNormalTex)) ||
+			(desc.indexSize != sizeof(WORD) && desc.indexSize != sizeof(DWORD)) ||
+			!inRange(desc.vertexOffset, (uint64_t)desc.vertexCount * desc.vertexStride) ||
+			!inRange(desc.indexOffset, varint ? 0 : (uint64_t)desc.indexCount * desc.indexSize))
+			return false;
+
+		PartView& part = parts[i];
+		part.material = desc.material;
+		part.texStrDiffuse.clear();
+		part.lods.clear();
+		part.meshlets.clear();
+		if (desc.texDiffuse != Mbo::kNoString)
+		{
+			if (!strings || desc.texDiffuse >= stringBytes)
+				return false;
+			const char* str = strings + desc.texDiffuse;
+			const char* strEnd = static_cast<const char*>(memchr(str, '\0', (size_t)(stringBytes - desc.texDiffuse)));
+			if (!strEnd)
+				return false;
+			part.texStrDiffuse = DecodeString(str, strEnd);
+		}
+
+		part.vertices = reinterpret_cast<const VertexPosNormalTex*>(data + desc.vertexOffset);
+		part.vertexCount = desc.vertexCount;
+		part.indices = data + desc.indexOffset;
+		part.indexCount = desc.indexCount;
+		part.indexSize = desc.indexSize;
+
+		if (quantized)
+		{
+			decodedData.emplace_back((size_t)desc.vertexCount * sizeof(VertexPosNormalTex));
+			VertexPosNormalTex* vertices = reinterpret_cast<VertexPosNormalTex*>(decodedData.back().data());
+			Mbo::DecodeVertices(reinterpret_cast<const Mbo::QuantizedVertex*>(data + desc.vertexOffset),
+				desc.vertexCount, vMin, vMax, vertices);
+			part.vertices = vertices;
+		}
+		if (varint)
+		{
+			// 每个索引至少占1字节，据此排除损坏的文件，避免分配过大的内存
+			if (desc.indexCount + lodIndexCounts[i] > size)
+				return false;
+			decodedData.emplace_back((size_t)(desc.indexCount + lodIndexCounts[i]) * desc.indexSize);
+			if (!Mbo::DecodeIndices(reinterpret_cast<const uint8_t*>(data + desc.indexOffset), (size_t)(size - desc.indexOffset),
+				desc.indexCount, desc.indexSize, decodedData.back().data()))
+				return false;
+			part.indices = decodedData.back().data();
+			lodCursors[i] = decodedData.back().data() + (size_t)desc.indexCount * desc.indexSize;
+		}
+		// varint解码得到的索引可以是任意值，与未压缩的索引一样检查
+		if (!IndicesInRange(part.indices, part.indexCount, part.indexSize, part.vertexCount))
+			return false;
 
-		if (vertexCount > 65535)
+		if (boundsData)
 		{
-			// [索引]4*索引数 字节
-			objParts[i].indices32.resize(indexCount);
-			fin.read(reinterpret_cast<char*>(objParts[i].indices32.data()), indexCount * sizeof(DWORD));
+			Mbo::BoundsDesc boundsDesc;
+			memcpy(&boundsDesc, boundsData + i * sizeof(boundsDesc), sizeof(boundsDesc));
+			part.bounds.vMin = boundsDesc.vMin;
+			part.bounds.vMax = boundsDesc.vMax;
+			part.bounds.center = boundsDesc.center;
+			part.bounds.radius = boundsDesc.radius;
 		}
 		else
 		{
-			// [索引]2*索引数 字节
-			objParts[i].indices16.resize(indexCount);
-			fin.read(reinterpret_cast<char*>(objParts[i].indices16.data()), indexCount * sizeof(WORD));
+			// 旧文件没有记录包围体，由(解码后的)顶点计算
+			part.bounds = ObjReader::ComputeBounds(part.vertices, part.vertexCount);
+		}
+	}
+
+	// LOD索引的宽度与编码方式与所属部分相同
+	for (size_t i = 0; i < lodCount; ++i)
+	{
+		Mbo::LodDesc lodDesc;
+		memcpy(&lodDesc, lodData + i * sizeof(lodDesc), sizeof(lodDesc));
+		Mbo::PartDesc desc;
+		memcpy(&desc, partData + lodDesc.partIndex * sizeof(desc), sizeof(desc));
+		bool varint = (desc.encoding & Mbo::EncodingVarintIndices) != 0;
+		if (!inRange(lodDesc.indexOffset, varint ? 0 : (uint64_t)lodDesc.indexCount * desc.indexSize))
+			return false;
+
+		LodView lod;
+		lod.indices = data + lodDesc.indexOffset;
+		lod.indexCount = lodDesc.indexCount;
+		lod.error = lodDesc.error;
+		if (varint)
+		{
+			uint8_t*& cursor = lodCursors[lodDesc.partIndex];
+			if (!Mbo::DecodeIndices(reinterpret_cast<const uint8_t*>(data + lodDesc.indexOffset), (size_t)(size - lodDesc.indexOffset),
+				lodDesc.indexCount, desc.indexSize, cursor))
+				return false;
+			lod.indices = cursor;
+			cursor += (size_t)lodDesc.indexCount * desc.indexSize;
 		}
+		if (!IndicesInRange(lod.indices, lod.indexCount, desc.indexSize, desc.vertexCount))
+			return false;
+		parts[lodDesc.partIndex].lods.push_back(lod);
 	}
 
-	fin.close();
+	// 簇引用所属部分原始网格中的一段三角形
+	for (size_t i = 0; i < (size_t)(meshletBytes / sizeof(Mbo::MeshletDesc)); ++i)
+	{
+		Mbo::MeshletDesc meshletDesc;
+		memcpy(&meshletDesc, meshletData + i * sizeof(meshletDesc), sizeof(meshletDesc));
+		if (meshletDesc.partIndex >= partCount || meshletDesc.indexCount % 3 != 0 ||
+			meshletDesc.startIndex > parts[meshletDesc.partIndex].indexCount ||
+			meshletDesc.indexCount > parts[meshletDesc.partIndex].indexCount - meshletDesc.startIndex)
+			return false;
+
+		ObjReader::ObjMeshlet meshlet;
+		meshlet.startIndex = meshletDesc.startIndex;
+		meshlet.indexCount = meshletDesc.indexCount;
+		meshlet.center = meshletDesc.center;
+		meshlet.radius = meshletDesc.radius;
+		meshlet.coneAxis = meshletDesc.coneAxis;
+		meshlet.coneCutoff = meshletDesc.coneCutoff;
+		parts[meshletDesc.partIndex].meshlets.push_back(meshlet);
+	}
 
 	return true;
 }
 
-bool ObjReader::WriteMbo(const wchar_t * mboFileName)
+
+
+const float MboCache::lodRatios[3] = { 0.5f, 0.25f, 0.1f };
+
+bool MboCache::Open(const wchar_t * objFileName, MboView & view, UINT threadCount)
 {
-	// [Part数目] 4字节
-	// [AABB盒顶点vMax] 12字节
-	// [AABB盒顶点vMin] 12字节
-	// [Part
-	//   [环境光材质文件名]520字节
-	//   [漫射光材质文件名]520字节
-	//   [材质]64字节
-	//   [顶点数]4字节
-	//   [索引数]4字节
-	//   [顶点]32*顶点数 字节
-	//   [索引]2(或4)*索引数 字节，取决于顶点数是否不超过65535
-	// ]
-	// ...
-	std::ofstream fout(mboFileName, std::ios::out | std::ios::binary);
-	UINT parts = (UINT)objParts.size();
-	// [Part数目] 4字节
-	fout.write(reinterpret_cast<const char*>(&parts), sizeof(UINT));
+	std::vector<char> objBytes;
+	if (!ReadFileBytes(objFileName, objBytes))
+		return false;
+	uint64_t key = HashSource(objBytes.data(), objBytes.size(), objFileName);
+	std::wstring cachePath = GetCachePath(key);
 
-	// [AABB盒顶点vMax] 12字节
-	fout.write(reinterpret_cast<const char*>(&vMax), sizeof(XMFLOAT3));
-	// [AABB盒顶点vMin] 12字节
-	fout.write(reinterpret_cast<const char*>(&vMin), sizeof(XMFLOAT3));
+	if (!view.Open(cachePath.c_str()) || view.sourceHash != key)
+	{
+		ObjReader reader;
+		bool parsed = IsGlbFile(objFileName) ?
+			reader.ReadGlbFromMemory(objBytes.data(), objBytes.size(), objFileName) :
+			reader.ReadObjFromMemory(objBytes.data(), objBytes.size(), objFileName, threadCount);
+		if (!parsed || !Store(reader, objFileName, key) || !view.Open(cachePath.c_str()))
+			return false;
+	}
 
-	// [Part
-	for (UINT i = 0; i < parts; ++i)
+	std::wstring dir = GetDirectory(objFileName);
+	for (auto& part : view.parts)
 	{
-		wchar_t filePath[MAX_PATH];
-		wcscpy_s(filePath, objParts[i].texStrDiffuse.c_str());
-		// [漫射光材质文件名]520字节
-		fout.write(reinterpret_cast<const char*>(filePath), MAX_PATH * sizeof(wchar_t));
-		// [材质]64字节
-		fout.write(reinterpret_cast<const char*>(&objParts[i].material), sizeof(Material));
-		UINT vertexCount = (UINT)objParts[i].vertices.size();
-		// [顶点数]4字节
-		fout.write(reinterpret_cast<const char*>(&vertexCount), sizeof(UINT));
+		if (!part.texStrDiffuse.empty())
+			part.texStrDiffuse = dir + part.texStrDiffuse;
+	}
+	return true;
+}
 
-		UINT indexCount;
-		if (vertexCount > 65535)
-		{
-			indexCount = (UINT)objParts[i].indices32.size();
-			// [索引数]4字节
-			fout.write(reinterpret_cast<const char*>(&indexCount), sizeof(UINT));
-			// [顶点]32*顶点数 字节
-			fout.write(reinterpret_cast<const char*>(objParts[i].vertices.data()), vertexCount * sizeof(VertexPosNormalTex));
-			// [索引]4*索引数 字节
-			fout.write(reinterpret_cast<const char*>(objParts[i].indices32.data()), indexCount * sizeof(DWORD));
-		}
-		else
+bool MboCache::Read(const wchar_t * objFileName, ObjReader & reader, UINT threadCount)
+{
+	std::vector<char> objBytes;
+	if (!ReadFileBytes(objFileName, objBytes))
+		return false;
+	uint64_t key = HashSource(objBytes.data(), objBytes.size(), objFileName);
+	std::wstring cachePath = GetCachePath(key);
+
+	if (reader.ReadMbo(cachePath.c_str()) && reader.sourceHash == key)
+	{
+		std::wstring dir = GetDirectory(objFileName);
+		for (auto& part : reader.objParts)
 		{
-			indexCount = (UINT)objParts[i].indices16.size();
-			// [索引数]4字节
-			fout.write(reinterpret_cast<const char*>(&indexCount), sizeof(UINT));
-			// [顶点]32*顶点数 字节
-			fout.write(reinterpret_cast<const char*>(objParts[i].vertices.data()), vertexCount * sizeof(VertexPosNormalTex));
-			// [索引]2*索引数 字节
-			fout.write(reinterpret_cast<const char*>(objParts[i].indices16.data()), indexCount * sizeof(WORD));
+			if (!part.texStrDiffuse.empty())
+				part.texStrDiffuse = dir + part.texStrDiffuse;
 		}
+		return true;
 	}
-	// ]
-	fout.close();
 
+	bool parsed = IsGlbFile(objFileName) ?
+		reader.ReadGlbFromMemory(objBytes.data(), objBytes.size(), objFileName) :
+		reader.ReadObjFromMemory(objBytes.data(), objBytes.size(), objFileName, threadCount);
+	if (!parsed)
+		return false;
+	// 即使缓存写入失败，解析结果依然可用
+	Store(reader, objFileName, key);
 	return true;
 }
 
-void ObjReader::AddVertex(const VertexPosNormalTex& vertex, DWORD vpi, DWORD vti, DWORD vni)
+uint64_t MboCache::HashSource(const char * objData, size_t objSize, const wchar_t * objFileName)
 {
-	std::wstring idxStr = std::to_wstring(vpi) + L"/" + std::to_wstring(vti) + L"/" + std::to_wstring(vni);
+	uint64_t hash = HashBytes(objData, objSize, importerVersion);
+	// .glb文件不引用.mtl
+	if (IsGlbFile(objFileName))
+		return hash;
 
-	// 寻找是否有重复顶点
-	auto it = vertexCache.find(idxStr);
-	if (it != vertexCache.end())
+	// 依次混入.obj引用的.mtl文件名与内容，.mtl不存在时只混入文件名
+	std::wstring dir = GetDirectory(objFileName);
+	const char* p = objData;
+	const char* end = objData + objSize;
+	if (objSize >= 3 && memcmp(p, "\xEF\xBB\xBF", 3) == 0)
+		p += 3;
+	for (; p < end; p = SkipLine(p, end))
 	{
-		objParts.back().indices32.push_back(it->second);
+		const char* keyBeg = SkipBlank(p, end);
+		const char* keyEnd = TokenEnd(keyBeg, end);
+		if (!TokenEquals(keyBeg, keyEnd, "mtllib"))
+			continue;
+
+		const char* nameBeg;
+		const char* nameEnd = TrimmedLine(keyEnd, end, nameBeg);
+		hash = HashBytes(nameBeg, nameEnd - nameBeg, hash);
+		std::vector<char> mtlBytes;
+		if (ReadFileBytes((dir + DecodeString(nameBeg, nameEnd)).c_str(), mtlBytes))
+			hash = HashBytes(mtlBytes.data(), mtlBytes.size(), hash);
 	}
-	else
+	return hash;
+}
+
+std::wstring MboCache::GetCachePath(uint64_t key) const
+{
+	wchar_t name[17];
+	for (int i = 0; i < 16; ++i)
+		name[i] = L"0123456789abcdef"[(key >> (60 - i * 4)) & 0xF];
+	name[16] = L'\0';
+
+	std::wstring path = cacheDir;
+	// '/'在Windows下同样可以作为路径分隔符
+	if (!path.empty() && path.back() != L'/' && path.back() != L'\\')
+		path += L'/';
+	return path + name + L".mbo";
+}
+
+bool MboCache::Store(ObjReader & reader, const wchar_t * objFileName, uint64_t key) const
+{
+	if (!cacheDir.empty() && !CreateDirectoryIfMissing(cacheDir))
+		return false;
+
+	// 缓存中的网格总是带有LOD链与三角形簇，并经过顶点缓存与顶点读取优化
+	for (auto& part : reader.objParts)
+	{
+		MeshOptimizer::GenerateLods(part, lodRatios, ARRAYSIZE(lodRatios));
+		MeshOptimizer::BuildMeshlets(part);
+		MeshOptimizer::OptimizePart(part);
+	}
+
+	// 解析得到的纹理路径都以.obj所在目录开头，写入前将其去掉
+	std::wstring dir = GetDirectory(objFileName);
+	for (auto& part : reader.objParts)
+	{
+		if (part.texStrDiffuse.compare(0, dir.size(), dir) == 0)
+			part.texStrDiffuse.erase(0, dir.size());
+	}
+	reader.sourceHash = key;
+
+	// 多个进程可能同时生成同一个缓存，临时文件名需要互不相同
+	std::wstring cachePath = GetCachePath(key);
+	std::wstring tempPath = cachePath + L"." + std::to_wstring(std::random_device()()) + L".tmp";
+	bool succeeded = reader.WriteMbo(tempPath.c_str()) && RenameFile(tempPath, cachePath);
+	if (!succeeded)
+		RemoveFile(tempPath);
+
+	for (auto& part : reader.objParts)
 	{
-		objParts.back().vertices.push_back(vertex);
-		DWORD pos = (DWORD)objParts.back().vertices.size() - 1;
-		vertexCache[idxStr] = pos;
-		objParts.back().indices32.push_back(pos);
+		if (!part.texStrDiffuse.empty())
+			part.texStrDiffuse = dir + part.texStrDiffuse;
 	}
+	return succeeded;
 }
 
 
@@ -365,12 +2877,8 @@ bool MtlReader::ReadMtl(const wchar_t * mtlFileName)
 	mapKdStrs.clear();
 
 
-	std::wifstream wfin(mtlFileName);
-	std::locale china("chs");
-	china = wfin.imbue(china);
-
-
-	if (!wfin.is_open())
+	std::wifstream wfin;
+	if (!OpenTextFile(wfin, mtlFileName))
 		return false;
 
 	std::wstring wstr;
@@ -8,14 +8,23 @@
 // 
 // - ObjReader支持通过.obj文件引用.mtl(材质)，并且.mtl(材质)支持引用纹理。
 // - 不支持使用/将下一行的内容连接在一起表示一行
+// - .obj文件按UTF-8字节流解析(非法UTF-8的名称按系统代码页转换)
 // - 不支持索引为负数
 // - 不支持使用类似1//2这样的顶点（即不包含纹理坐标的顶点）
 // - 对.mtl文件和纹理的引用必须以相对路径的形式提供，且没有支持.和..两种路径格式。
 // - 若.mtl材质文件不存在，则内部会使用默认材质值
 // - 若.mtl内部没有指定纹理文件引用，需要另外自行加载纹理
 // - 要求网格只能以三角形构造
-// - .mbo文件是一种二进制文件，用于加快模型加载的速度，内部格式是自定义的
-// - .mbo文件已经生成不能随意改变文件位置，若要迁移相关文件需要重新生成.mbo文件
+// - .mbo文件是一种二进制文件，用于加快模型加载的速度，内部格式见MboFormat.h
+//   写入时总是使用v2格式，可选择量化顶点与压缩索引，读取时兼容v1格式
+//   v2格式可以保存各部分的LOD链(见MeshOptimizer::GenerateLods)与三角形簇(见MeshOptimizer::BuildMeshlets)
+// - ReadObjStreaming在解析的同时逐个交出已完成的部分，便于与缓冲区的创建重叠
+// - 导入时为每个部分计算包围盒与包围球，并保存在.mbo文件中，便于逐部分剔除
+// - ReadGlb可读取二进制glTF(.glb)文件，每个三角形图元成为一个部分，节点变换烘焙进顶点
+//   需要提供法向量，只读取第一套纹理坐标、基础色材质与外部纹理文件，
+//   不支持稀疏访问器、外部缓冲区、蒙皮与变形目标
+// - 通过Read生成的.mbo文件不能随意改变文件位置，若要迁移相关文件需要重新生成.mbo文件
+//   MboCache生成的缓存没有该限制，且源文件修改后会自动重新生成
 //
 // Created By X_Jun(MKXJun)
 // 2018/9/9 v1.0
@@ -26,20 +35,57 @@
 
 #include <iostream>
 #include <fstream>
+#include <vector>
 #include <unordered_map>
 #include <map>
 #include <string>
 #include <algorithm>
 #include <locale>
+#include <functional>
 #include "Vertex.h"
 #include "LightHelper.h"
+#include "MappedFile.h"
 
 
 class MtlReader;
+class MboView;
 
 class ObjReader
 {
 public:
+	// 简化后的细节级别，索引引用所属部分的顶点，宽度与所属部分相同
+	struct ObjLod
+	{
+		ObjLod() : error() {}
+
+		std::vector<WORD> indices16;
+		std::vector<DWORD> indices32;
+		float error;								// 相对原始网格的近似最大偏差(模型空间)
+	};
+
+	// 原始网格中连续的一段三角形，附带用于剔除的包围球与法线锥(模型空间)
+	struct ObjMeshlet
+	{
+		ObjMeshlet() : startIndex(), indexCount(), center(), radius(), coneAxis(), coneCutoff() {}
+
+		UINT startIndex;							// 在所属部分索引中的起始位置
+		UINT indexCount;
+		DirectX::XMFLOAT3 center;
+		float radius;
+		DirectX::XMFLOAT3 coneAxis;
+		float coneCutoff;							// 三角形法向量与coneAxis夹角余弦的最小值，不大于0表示无法按朝向剔除
+	};
+
+	// 部分的包围盒与包围球(模型空间)，见ComputeBounds
+	struct ObjBounds
+	{
+		ObjBounds() : vMin(), vMax(), center(), radius() {}
+
+		DirectX::XMFLOAT3 vMin, vMax;				// AABB盒双顶点
+		DirectX::XMFLOAT3 center;
+		float radius;
+	};
+
 	struct ObjPart
 	{
 		ObjPart() : material() {}
@@ -49,28 +95,199 @@ public:
 		std::vector<VertexPosNormalTex> vertices;	// 顶点集合
 		std::vector<WORD> indices16;				// 顶点数不超过65535时使用
 		std::vector<DWORD> indices32;				// 顶点数超过65535时使用
-		std::wstring texStrDiffuse;					// 漫射光纹理文件名，需为相对路径，在mbo必须占260字节
+		std::wstring texStrDiffuse;					// 漫射光纹理文件名，需为相对路径
+		std::vector<ObjLod> lods;					// 由细到粗的简化网格，不含原始网格，见MeshOptimizer::GenerateLods
+		std::vector<ObjMeshlet> meshlets;			// 按索引顺序覆盖原始网格的三角形簇，见MeshOptimizer::BuildMeshlets
+		ObjBounds bounds;							// 包含全部顶点，修改顶点后需要重新计算
 	};
 
-	ObjReader() : vMin(), vMax() {}
+	// 流式读取时每组装完一个部分调用一次，partIndex为该部分在.obj中的序号
+	// 回调可以取走part中的数据，返回false时中止读取
+	using PartCallback = std::function<bool(size_t partIndex, ObjPart& part)>;
+
+	ObjReader() : vMin(), vMax(), sourceHash(), vertexLookups(), vertexCacheHits() {}
 	~ObjReader() = default;
 
 	// 指定.mbo文件的情况下，若.mbo文件存在，优先读取该文件
-	// 否则会读取.obj文件
+	// 否则会读取.obj文件(扩展名为.glb时按.glb文件读取)
 	// 若.obj文件被读取，且提供了.mbo文件的路径，则会根据已经读取的数据创建.mbo文件
-	bool Read(const wchar_t* mboFileName, const wchar_t* objFileName);
+	// threadCount为解析.obj时使用的线程数，0表示使用全部硬件线程
+	bool Read(const wchar_t* mboFileName, const wchar_t* objFileName, UINT threadCount = 1);
 	
-	bool ReadObj(const wchar_t* objFileName);
+	// 将.obj文件整体读入内存后按字节解析，不依赖locale
+	// threadCount > 1时按行边界将文本切分成块并行解析，再按原顺序合并，结果与单线程一致
+	bool ReadObj(const wchar_t* objFileName, UINT threadCount = 1);
+	// 解析内存中的.obj文本(UTF-8)，objFileName仅用于定位.mtl文件的相对路径
+	bool ReadObjFromMemory(const char* data, size_t size, const wchar_t* objFileName, UINT threadCount = 1);
+	// 流式读取.obj：后台线程逐段解析，每当一个部分结束(遇到下一个o/g或文件末尾)就组装其顶点与索引，
+	// 调用线程按顺序对已完成的部分调用onPart，回调中的优化与缓冲区创建因此可以与后续部分的解析重叠
+	// 完成后objParts为空，vMin/vMax与顶点去重统计有效，各部分的内容与ReadObj一致
+	// 面引用了之后才出现的顶点属性时，从该部分起推迟到文件末尾再交出
+	// 面在解析后立即组装进所属部分，不保留原始的面；等待回调的部分最多4个；
+	// 从文件读取时已解析的文本随即移出工作集，全局的顶点属性在最后一个部分组装完毕后释放
+	bool ReadObjStreaming(const wchar_t* objFileName, const PartCallback& onPart);
+	bool ReadObjStreamingFromMemory(const char* data, size_t size, const wchar_t* objFileName, const PartCallback& onPart);
+	// 读取.glb文件，不经过文本解析与顶点去重(glTF的顶点本身已带索引)
+	// 缓冲区视图按VertexPosNormalTex的布局交错存储且节点没有变换时，顶点从映射的内存整块拷贝，
+	// 16位索引同样整块拷贝，之后只需就地反转z值与三角形的顶点顺序
+	bool ReadGlb(const wchar_t* glbFileName);
+	// 解析内存中的.glb数据，glbFileName仅用于定位外部纹理的相对路径
+	bool ReadGlbFromMemory(const char* data, size_t size, const wchar_t* glbFileName);
+	// 可读取v1与v2格式的.mbo文件，若只需创建缓冲区，可使用MboView避免拷贝
 	bool ReadMbo(const wchar_t* mboFileName);
-	bool WriteMbo(const wchar_t* mboFileName);
+	bool ReadMboFromMemory(const char* data, size_t size);
+	// 总是写出v2格式的.mbo文件
+	// compressed为true时顶点被量化为16字节、索引经varint压缩，位置、法向量与纹理坐标会有少量精度损失
+	bool WriteMbo(const wchar_t* mboFileName, bool compressed = false);
+
+	// 计算顶点位置的包围盒与包围球，顶点结构需以XMFLOAT3位置开头，vertexStride为顶点字节数
+	// 包围球以Ritter算法求出，再与以AABB盒中心为球心的球比较取较小者，半径已补偿浮点舍入
+	static ObjBounds ComputeBounds(const void* vertices, size_t vertexCount, size_t vertexStride = sizeof(VertexPosNormalTex));
+
+	// 释放CPU端的几何数据(各部分及去重缓存)，通常在创建完缓冲区后调用
+	void ReleaseGeometry();
+	// CPU端几何数据当前占用的字节数(按容量计算)
+	size_t GetGeometryByteSize() const;
 public:
 	std::vector<ObjPart> objParts;
 	DirectX::XMFLOAT3 vMin, vMax;					// AABB盒双顶点
+	uint64_t sourceHash;							// 源文件的内容哈希，见MboCache，0表示未知
+	// 顶点去重统计：最近一次解析.obj时的查找次数与命中次数
+	size_t vertexLookups, vertexCacheHits;
+	float GetVertexCacheHitRate() const;
+
+private:
+	// 以v/vt/vn索引三元组为键的开放寻址哈希表(线性探测)
+	// 索引从1开始，因此vpi为0的槽位表示空位
+	class VertexCache
+	{
+	public:
+		VertexCache() : m_Mask(), m_Count() {}
+
+		// 清空并根据预计的不重复顶点数预留空间
+		void Reset(size_t expectedCount);
+		// 若键已存在，返回对应的顶点位置，否则插入value并返回value
+		DWORD FindOrInsert(DWORD vpi, DWORD vti, DWORD vni, DWORD value);
+
+	private:
+		struct Entry
+		{
+			DWORD vpi, vti, vni;
+			DWORD value;
+		};
+
+		void Grow();
+
+		std::vector<Entry> m_Entries;
+		size_t m_Mask;
+		size_t m_Count;
+	};
+
+	bool CopyFrom(const MboView& view);
+	// file非空时data指向其映射，已解析完的文本随解析进度移出工作集
+	bool ReadObjStreamingFromMemory(const char* data, size_t size, const wchar_t* objFileName,
+		const PartCallback& onPart, const MappedFile* file);
+
+	void AddDefaultPart();
+	static ObjPart DefaultPart();
+	// 返回该顶点是否命中缓存
+	static bool AddVertex(ObjPart& part, VertexCache& cache, const VertexPosNormalTex& vertex, DWORD vpi, DWORD vti, DWORD vni);
+	// 将faceCount个面(每个面9个索引)的顶点加入part，hits累加命中缓存的次数，索引越界时返回false
+	static bool AddFaces(ObjPart& part, VertexCache& cache, const DWORD* faces, size_t faceCount,
+		const std::vector<DirectX::XMFLOAT3>& positions, const std::vector<DirectX::XMFLOAT3>& normals,
+		const std::vector<DirectX::XMFLOAT2>& texCoords, size_t& hits);
+	// 顶点数不超过WORD的最大值时改用16位索引，并计算包围体
+	static void FinishPart(ObjPart& part);
+
+	VertexCache vertexCache;
+};
+
+// .mbo文件的只读视图
+// 各部分的顶点与索引直接指向文件映射(或调用者提供)的内存，不产生拷贝，
+// 可直接作为创建缓冲区的初始数据，视图在Close或析构之前有效
+// 压缩编码的部分在解析时解码到视图自身持有的内存中
+class MboView
+{
+public:
+	// 简化后的细节级别，索引宽度与所属部分相同
+	struct LodView
+	{
+		const void* indices;
+		UINT indexCount;
+		float error;							// 相对原始网格的近似最大偏差(模型空间)
+	};
+
+	struct PartView
+	{
+		Material material;
+		std::wstring texStrDiffuse;
+		const VertexPosNormalTex* vertices;
+		UINT vertexCount;
+		const void* indices;
+		UINT indexCount;
+		UINT indexSize;							// 2或4
+		std::vector<LodView> lods;				// 由细到粗的简化网格，不含原始网格
+		std::vector<ObjReader::ObjMeshlet> meshlets;	// 原始网格的三角形簇，没有时为空
+		ObjReader::ObjBounds bounds;			// 文件中没有记录时由顶点计算
+	};
+
+	MboView() : vMin(), vMax(), sourceHash() {}
+
+	// 映射.mbo文件并解析，可读取v1与v2格式
+	// 偏移或长度超出文件、索引不小于所属部分顶点数的文件视为损坏，返回false
+	bool Open(const wchar_t* mboFileName);
+	// 解析内存中的.mbo数据，数据需要在视图使用期间保持有效
+	bool Parse(const char* data, size_t size);
+	void Close();
+
+public:
+	std::vector<PartView> parts;
+	DirectX::XMFLOAT3 vMin, vMax;				// AABB盒双顶点
+	uint64_t sourceHash;						// 源文件的内容哈希，没有记录时为0
+private:
+	bool ParseV1(const char* data, size_t size);
+	bool ParseV2(const char* data, size_t size);
+
+	MappedFile mappedFile;
+	std::vector<std::vector<uint8_t>> decodedData;	// 压缩部分解码后的顶点与索引
+};
+
+// .mbo缓存目录
+// 以.obj及其引用的.mtl文件的内容哈希(混入导入器版本)为键，缓存文件以键命名，
+// 源文件修改后键随之改变，不会读到过期的数据；缓存记录的键与文件名不符时重新生成
+// 缓存中的纹理路径相对于.obj所在目录保存，读取时再补全，因此模型目录与缓存目录都可以移动
+class MboCache
+{
+public:
+	// 解析结果或.mbo的写出方式发生变化时需要递增，使已有的缓存全部失效
+	// 2: 写入前执行MeshOptimizer::OptimizePart
+	// 3: 写入前按lodRatios生成LOD链
+	// 4: 写入前将原始网格划分为三角形簇
+	// 5: 写入各部分的包围体
+	// 6: LOD的索引紧接所属部分的索引写入，不再对齐
+	static const uint32_t importerVersion = 6;
+	// 缓存中各级LOD相对原始网格的目标三角形比例
+	static const float lodRatios[3];
+
+	explicit MboCache(const wchar_t* cacheDir) : cacheDir(cacheDir) {}
+
+	// 打开.obj对应的缓存，缓存缺失或失效时先解析.obj、优化网格并写入缓存
+	// 扩展名为.glb时源文件按.glb读取
+	// 命中时只读取.obj与.mtl的字节计算哈希，不解析文本
+	// threadCount为缓存失效时解析.obj使用的线程数，0表示使用全部硬件线程
+	bool Open(const wchar_t* objFileName, MboView& view, UINT threadCount = 1);
+	// 同上，但将数据读入ObjReader
+	bool Read(const wchar_t* objFileName, ObjReader& reader, UINT threadCount = 1);
+
+	// 计算.obj及其引用的.mtl文件的内容哈希，objFileName用于定位.mtl文件
+	static uint64_t HashSource(const char* objData, size_t objSize, const wchar_t* objFileName);
+	std::wstring GetCachePath(uint64_t key) const;
+
 private:
-	void AddVertex(const VertexPosNormalTex& vertex, DWORD vpi, DWORD vti, DWORD vni);
+	// 以纹理路径相对于.obj所在目录的形式写入缓存，先写临时文件再替换，避免读到不完整的缓存
+	bool Store(ObjReader& reader, const wchar_t* objFileName, uint64_t key) const;
 
-	// 缓存有v/vt/vn字符串信息
-	std::unordered_map<std::wstring, DWORD> vertexCache;
+	std::wstring cacheDir;
 };
 
 class MtlReader
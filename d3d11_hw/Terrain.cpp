@@ -0,0 +1,103 @@
+#include "Terrain.h"
+#include "Camera.h"
+#include "d3dUtil.h"
+#include "DXTrace.h"
+
+using namespace DirectX;
+
+
+Terrain::Terrain()
+	: m_material()
+{
+}
+
+Terrain::~Terrain()
+{
+}
+
+bool Terrain::Init(ID3D11Device* device, float width, float depth, UINT tileCount, UINT tileQuads,
+	const float* heights, float texU, float texV, IndexBufferCache* indexCache, ThreadPool* pool)
+{
+	if (!m_QuadTree.Build(width, depth, tileCount, tileQuads, heights, texU, texV, pool))
+		return false;
+
+	const auto& vertices = m_QuadTree.GetVertices();
+	D3D11_BUFFER_DESC vbd;
+	ZeroMemory(&vbd, sizeof(vbd));
+	vbd.Usage = D3D11_USAGE_IMMUTABLE;
+	vbd.ByteWidth = (UINT)(vertices.size() * sizeof(VertexPosNormalTex));
+	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	D3D11_SUBRESOURCE_DATA InitData;
+	ZeroMemory(&InitData, sizeof(InitData));
+	InitData.pSysMem = vertices.data();
+	HR(device->CreateBuffer(&vbd, &InitData, m_pVertexBuffer.ReleaseAndGetAddressOf()));
+
+	if (indexCache) {
+		m_pIndexBuffer = indexCache->GetOrCreate<WORD>(device, IndexBufferCache::Topology::TerrainStitch, tileQuads, 0,
+			[tileQuads]() { return TerrainQuadTree::CreateStitchIndices(tileQuads); }).buffer;
+	}
+	else {
+		std::vector<WORD> indices = TerrainQuadTree::CreateStitchIndices(tileQuads);
+		m_pIndexBuffer = IndexBufferCache::CreateIndexBuffer(device, indices.data(), (UINT)indices.size(), DXGI_FORMAT_R16_UINT);
+	}
+
+	// Only the tile bounds are needed for selection from now on
+	m_QuadTree.ReleaseGeometry();
+	return true;
+}
+
+void Terrain::SetMaterial(const Material& material)
+{
+	m_material = material;
+}
+
+void Terrain::SetTexture(ID3D11ShaderResourceView* texture)
+{
+	m_pTexture = texture;
+}
+
+void Terrain::Update(const Camera& camera, float errorPerDistance)
+{
+	// The terrain is drawn with an identity world matrix, so the planes of view * proj are in world space
+	XMVECTOR planes[6];
+	ExtractFrustumPlanes(camera.GetViewProjXM(), planes);
+
+	m_QuadTree.Select(camera.GetPositionXM(), errorPerDistance, planes);
+}
+
+const TerrainQuadTree::Stats& Terrain::GetStats() const
+{
+	return m_QuadTree.GetStats();
+}
+
+DirectX::BoundingBox Terrain::GetBoundingBox() const
+{
+	return m_QuadTree.GetBoundingBox();
+}
+
+void Terrain::Draw(ID3D11DeviceContext* deviceContext, BasicEffect& effect)
+{
+	if (!m_pVertexBuffer) {
+		return;
+	}
+
+	UINT strides = sizeof(VertexPosNormalTex);
+	UINT offsets = 0;
+	deviceContext->IASetVertexBuffers(0, 1, m_pVertexBuffer.GetAddressOf(), &strides, &offsets);
+	deviceContext->IASetIndexBuffer(m_pIndexBuffer.Get(), DXGI_FORMAT_R16_UINT, 0);
+
+	effect.SetWorldMatrix(XMMatrixIdentity());
+	effect.SetTexture(m_pTexture.Get());
+	effect.SetMaterial(m_material);
+	effect.Apply(deviceContext);
+
+	// Every tile shares the effect state, only the node's vertices and the stitch variant differ
+	const auto& nodes = m_QuadTree.GetNodes();
+	for (const auto& tile : m_QuadTree.GetSelectedTiles()) {
+		if (!tile.visible) {
+			continue;
+		}
+		const TerrainQuadTree::IndexRange& range = m_QuadTree.GetIndexRange(tile.stitchMask);
+		deviceContext->DrawIndexed(range.indexCount, range.startIndex, (INT)nodes[tile.node].baseVertex);
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <wrl/client.h>
+#include "Effects.h"
+#include "IndexBufferCache.h"
+#include "TerrainQuadTree.h"
+
+class Camera;
+
+
+class Terrain {
+public:
+	template <class T>
+	using ComPtr = Microsoft::WRL::ComPtr<T>;
+
+public:
+	Terrain();
+	~Terrain();
+
+public:
+	// Build the quadtree from a row-major heightmap of (tileCount * tileQuads + 1)^2 samples
+	// (see Geometry::SampleHeightmap) and upload every level's tiles into one vertex buffer.
+	// tileCount and tileQuads must be powers of two, 2 <= tileQuads <= 128.
+	// The stitched tile indices only depend on tileQuads and come from indexCache when given
+	bool Init(ID3D11Device* device, float width, float depth, UINT tileCount, UINT tileQuads,
+		const float* heights, float texU, float texV, IndexBufferCache* indexCache = nullptr, ThreadPool* pool = nullptr);
+
+	void SetMaterial(const Material& material);                // Set Material
+	void SetTexture(ID3D11ShaderResourceView* texture);        // Set Texture
+
+	// Pick each region's level of detail from its distance to the camera and cull tiles outside the frustum.
+	// errorPerDistance is the world space error allowed at distance 1 (e.g. one pixel's footprint)
+	void Update(const Camera& camera, float errorPerDistance);
+
+	// Tiles and triangles submitted by Draw for the last Update
+	const TerrainQuadTree::Stats& GetStats() const;
+	DirectX::BoundingBox GetBoundingBox() const;
+
+public:
+	void Draw(ID3D11DeviceContext* deviceContext, BasicEffect& effect);
+
+private:
+	TerrainQuadTree m_QuadTree;                    // Tile levels, bounds and selection
+	Material m_material;                           // Material
+	ComPtr<ID3D11ShaderResourceView> m_pTexture;   // Texture
+	ComPtr<ID3D11Buffer> m_pVertexBuffer;          // Vertices of every node, addressed with base vertex
+	ComPtr<ID3D11Buffer> m_pIndexBuffer;           // Stitch variants shared by all tiles
+};
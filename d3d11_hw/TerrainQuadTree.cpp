@@ -0,0 +1,301 @@
+#include "TerrainQuadTree.h"
+#include "Geometry.h"
+#include "d3dUtil.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <functional>
+
+using namespace DirectX;
+
+namespace
+{
+	bool IsPowerOfTwo(UINT value)
+	{
+		return value && !(value & (value - 1));
+	}
+
+	// 观察点到包围盒的距离，在包围盒内为0
+	float XM_CALLCONV DistanceToBox(FXMVECTOR point, const BoundingBox& box)
+	{
+		XMVECTOR offset = XMVectorAbs(point - XMLoadFloat3(&box.Center)) - XMLoadFloat3(&box.Extents);
+		return XMVectorGetX(XMVector3Length(XMVectorMax(offset, XMVectorZero())));
+	}
+}
+
+TerrainQuadTree::TerrainQuadTree()
+	: m_TileCount(), m_TileQuads(), m_IndexRanges(), m_Stats()
+{
+}
+
+bool TerrainQuadTree::Build(float width, float depth, UINT tileCount, UINT tileQuads, const float* heights,
+	float texU, float texV, ThreadPool* pool)
+{
+	if (!heights || !IsPowerOfTwo(tileCount) || !IsPowerOfTwo(tileQuads) || tileQuads < 2 || tileQuads > 128)
+		return false;
+
+	m_TileCount = tileCount;
+	m_TileQuads = tileQuads;
+	UINT slices = tileCount * tileQuads;
+	UINT pitch = slices + 1;
+
+	// 最高精度的完整网格，各层节点的顶点都从中取样，使相邻图块共享的顶点完全一致
+	auto meshData = Geometry::CreateTerrainFromHeightmap<VertexPosNormalTex, DWORD>(width, depth, slices, slices,
+		heights, texU, texV, XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), pool);
+
+	m_LevelOffsets.clear();
+	UINT nodeCount = 0;
+	for (UINT count = tileCount; count; count >>= 1)
+	{
+		m_LevelOffsets.push_back(nodeCount);
+		nodeCount += count * count;
+	}
+	m_Nodes.assign(nodeCount, Node());
+
+	UINT nodeVertexCount = (tileQuads + 1) * (tileQuads + 1);
+	m_Vertices.resize((size_t)nodeCount * nodeVertexCount);
+
+	auto forEach = [pool](size_t count, const std::function<void(size_t)>& func)
+	{
+		if (pool)
+			pool->ParallelFor(count, func);
+		else
+			for (size_t i = 0; i < count; ++i)
+				func(i);
+	};
+
+	float sliceWidth = width / slices;
+	float sliceDepth = depth / slices;
+	UINT levelCount = GetLevelCount();
+	for (UINT level = 0; level < levelCount; ++level)
+	{
+		UINT levelTiles = tileCount >> level;
+		UINT step = 1u << level;
+		UINT nodeQuads = tileQuads << level;	// 节点在完整网格中跨越的网格数
+		forEach(levelTiles * levelTiles, [&](size_t i)
+		{
+			UINT x = (UINT)i % levelTiles;
+			UINT z = (UINT)i / levelTiles;
+			UINT nodeIndex = m_LevelOffsets[level] + (UINT)i;
+			Node& node = m_Nodes[nodeIndex];
+			node.baseVertex = nodeIndex * nodeVertexCount;
+
+			UINT gx0 = x * nodeQuads, gz0 = z * nodeQuads;
+			VertexPosNormalTex* vertices = m_Vertices.data() + node.baseVertex;
+			for (UINT j = 0; j <= tileQuads; ++j)
+			{
+				const VertexPosNormalTex* src = meshData.vertexVec.data() + (size_t)(gz0 + j * step) * pitch + gx0;
+				for (UINT k = 0; k <= tileQuads; ++k)
+					*vertices++ = src[k * step];
+			}
+
+			// 以该级别的三角形插值完整高度图中的每个点，取最大偏差；三角形的对角线与索引一致
+			float minHeight = FLT_MAX, maxHeight = -FLT_MAX;
+			float error = 0.0f;
+			float invStep = 1.0f / step;
+			for (UINT j = 0; j < tileQuads; ++j)
+			{
+				for (UINT k = 0; k < tileQuads; ++k)
+				{
+					const float* h0 = heights + (size_t)(gz0 + j * step) * pitch + gx0 + k * step;
+					const float* h1 = h0 + step * pitch;
+					float h00 = h0[0], h10 = h0[step], h01 = h1[0], h11 = h1[step];
+					for (UINT dz = 0; dz <= step; ++dz)
+					{
+						const float* row = h0 + dz * pitch;
+						float v = dz * invStep;
+						for (UINT dx = 0; dx <= step; ++dx)
+						{
+							float u = dx * invStep;
+							float h = row[dx];
+							float interpolated = v >= u ? h00 + v * (h01 - h00) + u * (h11 - h01) :
+								h00 + u * (h10 - h00) + v * (h11 - h10);
+							error = (std::max)(error, std::fabs(h - interpolated));
+							minHeight = (std::min)(minHeight, h);
+							maxHeight = (std::max)(maxHeight, h);
+						}
+					}
+				}
+			}
+			node.error = error;
+
+			float minX = -width / 2 + gx0 * sliceWidth, minZ = -depth / 2 + gz0 * sliceDepth;
+			BoundingBox::CreateFromPoints(node.boundingBox,
+				XMVectorSet(minX, minHeight, minZ, 0.0f),
+				XMVectorSet(minX + nodeQuads * sliceWidth, maxHeight, minZ + nodeQuads * sliceDepth, 0.0f));
+		});
+
+		// 父节点的误差不小于子节点，保证距离越近选择的级别越精细
+		if (level > 0)
+		{
+			for (UINT z = 0; z < levelTiles; ++z)
+			{
+				for (UINT x = 0; x < levelTiles; ++x)
+				{
+					Node& node = m_Nodes[NodeIndex(level, x, z)];
+					for (UINT c = 0; c < 4; ++c)
+						node.error = (std::max)(node.error, m_Nodes[NodeIndex(level - 1, 2 * x + (c & 1), 2 * z + (c >> 1))].error);
+				}
+			}
+		}
+	}
+
+	ComputeIndexRanges();
+
+	m_ForceSplit.assign(nodeCount, 0);
+	m_LevelMap.assign(tileCount * tileCount, 0);
+	m_Tiles.clear();
+	m_Stats = Stats();
+	return true;
+}
+
+std::vector<WORD> TerrainQuadTree::CreateStitchIndices(UINT tileQuads)
+{
+	UINT q = tileQuads;
+	std::vector<WORD> indices;
+	indices.reserve(kStitchVariantCount * 6 * q * q);
+	for (UINT mask = 0; mask < kStitchVariantCount; ++mask)
+	{
+		// 缝合的边上奇数位置的顶点并入前一个顶点，退化的三角形被丢弃，边上只剩与较粗图块相同的顶点
+		auto vertexIndex = [q, mask](UINT k, UINT j)
+		{
+			if (((mask & StitchLeft) && k == 0) || ((mask & StitchRight) && k == q))
+				j &= ~1u;
+			if (((mask & StitchBottom) && j == 0) || ((mask & StitchTop) && j == q))
+				k &= ~1u;
+			return (WORD)(j * (q + 1) + k);
+		};
+		auto addTriangle = [&indices](WORD i0, WORD i1, WORD i2)
+		{
+			if (i0 == i1 || i1 == i2 || i2 == i0)
+				return;
+			indices.push_back(i0);
+			indices.push_back(i1);
+			indices.push_back(i2);
+		};
+
+		for (UINT j = 0; j < q; ++j)
+		{
+			for (UINT k = 0; k < q; ++k)
+			{
+				// 与Geometry::CreateTerrain相同的三角形划分
+				addTriangle(vertexIndex(k, j), vertexIndex(k, j + 1), vertexIndex(k + 1, j + 1));
+				addTriangle(vertexIndex(k + 1, j + 1), vertexIndex(k + 1, j), vertexIndex(k, j));
+			}
+		}
+	}
+	return indices;
+}
+
+void TerrainQuadTree::ComputeIndexRanges()
+{
+	// 每条缝合的边上每两格网格退化一个三角形，各边退化的三角形互不相同
+	UINT startIndex = 0;
+	for (UINT mask = 0; mask < kStitchVariantCount; ++mask)
+	{
+		UINT stitchedEdges = (mask & 1) + (mask >> 1 & 1) + (mask >> 2 & 1) + (mask >> 3 & 1);
+		UINT triangleCount = 2 * m_TileQuads * m_TileQuads - stitchedEdges * m_TileQuads / 2;
+		m_IndexRanges[mask].startIndex = startIndex;
+		m_IndexRanges[mask].indexCount = 3 * triangleCount;
+		startIndex += 3 * triangleCount;
+	}
+}
+
+UINT TerrainQuadTree::NodeIndex(UINT level, UINT x, UINT z) const
+{
+	return m_LevelOffsets[level] + z * (m_TileCount >> level) + x;
+}
+
+void XM_CALLCONV TerrainQuadTree::Select(FXMVECTOR eyePos, float errorPerDistance, const XMVECTOR planes[6])
+{
+	m_Stats = Stats();
+	if (m_Nodes.empty())
+		return;
+
+	// 按距离选择级别后，若相邻图块级别相差超过1，强制细分较粗的一侧并重新选择，直到全部满足
+	std::fill(m_ForceSplit.begin(), m_ForceSplit.end(), (BYTE)0);
+	UINT rootLevel = GetLevelCount() - 1;
+	do
+	{
+		m_Tiles.clear();
+		SelectNode(rootLevel, 0, 0, eyePos, errorPerDistance);
+	} while (UpdateStitching());
+
+	UINT fullDetailTriangles = 2 * m_TileQuads * m_TileQuads * m_TileCount * m_TileCount;
+	m_Stats.selectedTiles = (UINT)m_Tiles.size();
+	m_Stats.fullDetailTriangles = fullDetailTriangles;
+	for (Tile& tile : m_Tiles)
+	{
+		const BoundingBox& box = m_Nodes[tile.node].boundingBox;
+		tile.visible = !planes || BoxIntersectsFrustum(XMLoadFloat3(&box.Center), XMLoadFloat3(&box.Extents), planes);
+		if (!tile.visible)
+			continue;
+		++m_Stats.drawnTiles;
+		m_Stats.drawnTriangles += m_IndexRanges[tile.stitchMask].indexCount / 3;
+	}
+}
+
+void XM_CALLCONV TerrainQuadTree::SelectNode(UINT level, UINT x, UINT z, FXMVECTOR eyePos, float errorPerDistance)
+{
+	UINT nodeIndex = NodeIndex(level, x, z);
+	const Node& node = m_Nodes[nodeIndex];
+	bool split = level > 0 && (m_ForceSplit[nodeIndex] ||
+		node.error > DistanceToBox(eyePos, node.boundingBox) * errorPerDistance);
+	if (!split)
+	{
+		m_Tiles.push_back(Tile{ nodeIndex, level, x, z, 0, true });
+		return;
+	}
+	for (UINT c = 0; c < 4; ++c)
+		SelectNode(level - 1, 2 * x + (c & 1), 2 * z + (c >> 1), eyePos, errorPerDistance);
+}
+
+bool TerrainQuadTree::UpdateStitching()
+{
+	UINT tileCount = m_TileCount;
+	for (const Tile& tile : m_Tiles)
+	{
+		UINT size = 1u << tile.level;
+		for (UINT j = 0; j < size; ++j)
+			std::fill_n(m_LevelMap.begin() + (tile.z * size + j) * tileCount + tile.x * size, size, (BYTE)tile.level);
+	}
+
+	// 比当前图块粗的相邻图块覆盖了整条边，只需检查边外侧的一个最精细图块
+	bool changed = false;
+	for (Tile& tile : m_Tiles)
+	{
+		UINT size = 1u << tile.level;
+		UINT x0 = tile.x * size, z0 = tile.z * size;
+		struct { bool valid; UINT x, z; UINT edge; } neighbors[4] = {
+			{ x0 > 0, x0 - 1, z0, StitchLeft },
+			{ x0 + size < tileCount, x0 + size, z0, StitchRight },
+			{ z0 > 0, x0, z0 - 1, StitchBottom },
+			{ z0 + size < tileCount, x0, z0 + size, StitchTop }
+		};
+		tile.stitchMask = 0;
+		for (const auto& neighbor : neighbors)
+		{
+			if (!neighbor.valid)
+				continue;
+			UINT neighborLevel = m_LevelMap[neighbor.z * tileCount + neighbor.x];
+			if (neighborLevel == tile.level + 1)
+				tile.stitchMask |= neighbor.edge;
+			else if (neighborLevel > tile.level + 1)
+			{
+				m_ForceSplit[NodeIndex(neighborLevel, neighbor.x >> neighborLevel, neighbor.z >> neighborLevel)] = 1;
+				changed = true;
+			}
+		}
+	}
+	return changed;
+}
+
+BoundingBox TerrainQuadTree::GetBoundingBox() const
+{
+	return m_Nodes.empty() ? BoundingBox() : m_Nodes.back().boundingBox;
+}
+
+void TerrainQuadTree::ReleaseGeometry()
+{
+	std::vector<VertexPosNormalTex>().swap(m_Vertices);
+}
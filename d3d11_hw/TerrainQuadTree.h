@@ -0,0 +1,119 @@
+//***************************************************************************************
+// TerrainQuadTree.h
+// Licensed under the MIT License.
+//
+// 分块地形的四叉树：按与观察点的距离为每个区域选择细节级别，相邻图块通过共享的缝合索引避免裂缝
+// Chunked terrain quadtree with distance-based LOD selection and stitched tile indices.
+//***************************************************************************************
+
+#ifndef TERRAINQUADTREE_H
+#define TERRAINQUADTREE_H
+
+#include <vector>
+#include <DirectXCollision.h>
+#include "Vertex.h"
+#include "ThreadPool.h"
+
+// 地形被划分为tileCount * tileCount个最精细的图块，每个图块为tileQuads * tileQuads个网格
+// 四叉树第L层(0为最精细)的节点覆盖2^L * 2^L个最精细图块，同样用tileQuads * tileQuads个网格表示，网格间距为2^L倍
+// 所有节点的顶点依次存放在同一个顶点数组中，并共用同一套索引(绘制时以baseVertex区分)
+// 选择时保证相邻图块的级别最多相差1，较精细的图块在与较粗图块相接的边上跳过奇数位置的顶点，
+// 使两侧的边完全重合；4条边是否需要缝合的16种组合各有一段索引
+// 索引只取决于tileQuads，由CreateStitchIndices单独生成，可在多个地形之间共享
+class TerrainQuadTree
+{
+public:
+	// 需要与较粗的相邻图块缝合的边
+	enum StitchEdge
+	{
+		StitchLeft = 1,		// -x
+		StitchRight = 2,	// +x
+		StitchBottom = 4,	// -z
+		StitchTop = 8		// +z
+	};
+	static const UINT kStitchVariantCount = 16;
+
+	struct Node
+	{
+		DirectX::BoundingBox boundingBox;	// 覆盖区域内完整高度图的包围盒
+		float error;			// 以该节点的分辨率绘制时相对完整高度图的最大高度偏差，不小于其子节点的误差
+		UINT baseVertex;		// 该节点的顶点在顶点数组中的起始位置
+	};
+
+	// 选中的图块
+	struct Tile
+	{
+		UINT node;				// 节点下标
+		UINT level;
+		UINT x, z;				// 在所在层中的位置
+		UINT stitchMask;		// StitchEdge的组合
+		bool visible;			// 是否与视锥相交
+	};
+
+	// 索引数组中的一段
+	struct IndexRange
+	{
+		UINT startIndex;
+		UINT indexCount;
+	};
+
+	// 最近一次选择的统计
+	struct Stats
+	{
+		UINT selectedTiles;			// 选中的图块数(级别互不重叠地覆盖整个地形)
+		UINT drawnTiles;			// 其中与视锥相交的图块数
+		UINT drawnTriangles;		// 绘制的三角形数
+		UINT fullDetailTriangles;	// 全部以最高精度绘制时的三角形数
+	};
+
+	TerrainQuadTree();
+
+	// heights需按行(z从小到大)存放(tileCount * tileQuads + 1)^2个高度值，地形以原点为中心
+	// tileCount与tileQuads都需为2的幂，且2 <= tileQuads <= 128，否则返回false
+	// 顶点位置、法向量与纹理坐标同Geometry::CreateTerrainFromHeightmap
+	bool Build(float width, float depth, UINT tileCount, UINT tileQuads, const float* heights,
+		float texU = 1.0f, float texV = 1.0f, ThreadPool* pool = nullptr);
+
+	// 选择各区域的细节级别并做视锥剔除
+	// errorPerDistance为距离为1处允许的误差(如一个像素覆盖的世界空间大小)，为0时不允许任何误差
+	// planes为ExtractFrustumPlanes(见d3dUtil.h)得到的视锥平面；为nullptr时不做剔除
+	void XM_CALLCONV Select(DirectX::FXMVECTOR eyePos, float errorPerDistance, const DirectX::XMVECTOR planes[6]);
+
+	// 16种缝合方式的索引依次存放，stitchMask对应的一段见GetIndexRange
+	static std::vector<WORD> CreateStitchIndices(UINT tileQuads);
+
+	const std::vector<VertexPosNormalTex>& GetVertices() const { return m_Vertices; }
+	const IndexRange& GetIndexRange(UINT stitchMask) const { return m_IndexRanges[stitchMask]; }
+	UINT GetTileQuads() const { return m_TileQuads; }
+	const std::vector<Node>& GetNodes() const { return m_Nodes; }
+	const std::vector<Tile>& GetSelectedTiles() const { return m_Tiles; }
+	const Stats& GetStats() const { return m_Stats; }
+	UINT GetLevelCount() const { return (UINT)m_LevelOffsets.size(); }
+	DirectX::BoundingBox GetBoundingBox() const;
+
+	// 顶点上传到GPU后可以释放，不影响选择
+	void ReleaseGeometry();
+
+private:
+	UINT NodeIndex(UINT level, UINT x, UINT z) const;
+	void XM_CALLCONV SelectNode(UINT level, UINT x, UINT z, DirectX::FXMVECTOR eyePos, float errorPerDistance);
+	// 检查选中的图块与相邻图块的级别差，相差超过1时强制细分较粗的一侧，返回是否有新的强制细分
+	bool UpdateStitching();
+	// 按CreateStitchIndices的布局计算各缝合方式的索引范围，不需要生成索引
+	void ComputeIndexRanges();
+
+private:
+	UINT m_TileCount;
+	UINT m_TileQuads;
+	std::vector<Node> m_Nodes;
+	std::vector<UINT> m_LevelOffsets;		// 每层第一个节点的下标
+	std::vector<VertexPosNormalTex> m_Vertices;
+	IndexRange m_IndexRanges[kStitchVariantCount];
+
+	std::vector<Tile> m_Tiles;
+	std::vector<BYTE> m_ForceSplit;			// 每个节点是否因相邻级别差而必须细分
+	std::vector<BYTE> m_LevelMap;			// 每个最精细图块当前所属选中图块的级别
+	Stats m_Stats;
+};
+
+#endif
@@ -0,0 +1,46 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+	: m_Stop(false)
+{
+	if (threadCount == 0)
+		threadCount = HardwareThreadCount();
+
+	m_Workers.reserve(threadCount);
+	for (unsigned int i = 0; i < threadCount; ++i)
+		m_Workers.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stop = true;
+	}
+	m_Condition.notify_all();
+	for (auto& worker : m_Workers)
+		worker.join();
+}
+
+unsigned int ThreadPool::HardwareThreadCount()
+{
+	unsigned int count = std::thread::hardware_concurrency();
+	return count ? count : 1;
+}
+
+void ThreadPool::WorkerLoop()
+{
+	for (;;)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_Condition.wait(lock, [this]() { return m_Stop || !m_Tasks.empty(); });
+			if (m_Stop && m_Tasks.empty())
+				return;
+			task = std::move(m_Tasks.front());
+			m_Tasks.pop();
+		}
+		task();
+	}
+}
@@ -0,0 +1,127 @@
+//***************************************************************************************
+// ThreadPool.h
+// Licensed under the MIT License.
+//
+// 固定线程数的简易线程池，用于资源导入等可并行的CPU任务
+// Simple fixed-size thread pool for parallel CPU work such as asset import.
+//***************************************************************************************
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <atomic>
+#include <exception>
+
+class ThreadPool
+{
+public:
+	// threadCount为0时使用硬件线程数
+	explicit ThreadPool(unsigned int threadCount = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	unsigned int GetThreadCount() const { return (unsigned int)m_Workers.size(); }
+
+	// 提交一个任务，返回可获取结果的future
+	template<class Func>
+	auto Submit(Func&& func) -> std::future<decltype(func())>;
+
+	// 将[0, count)分配给各线程执行func(i)，阻塞直到全部完成
+	// 调用线程也会参与执行；不要在线程池的任务中嵌套调用
+	// func抛出异常时不再分配新的下标，等待所有线程结束后重新抛出第一个异常
+	template<class Func>
+	void ParallelFor(size_t count, Func&& func);
+
+	// 获取硬件线程数(至少为1)
+	static unsigned int HardwareThreadCount();
+
+private:
+	void WorkerLoop();
+
+	std::vector<std::thread> m_Workers;
+	std::queue<std::function<void()>> m_Tasks;
+	std::mutex m_Mutex;
+	std::condition_variable m_Condition;
+	bool m_Stop;
+};
+
+template<class Func>
+inline auto ThreadPool::Submit(Func&& func) -> std::future<decltype(func())>
+{
+	using ReturnType = decltype(func());
+
+	auto task = std::make_shared<std::packaged_task<ReturnType()>>(std::forward<Func>(func));
+	std::future<ReturnType> result = task->get_future();
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Tasks.emplace([task]() { (*task)(); });
+	}
+	m_Condition.notify_one();
+	return result;
+}
+
+template<class Func>
+inline void ThreadPool::ParallelFor(size_t count, Func&& func)
+{
+	if (count == 0)
+		return;
+
+	// 各线程通过原子计数领取下一个下标，负载不均时也能保持忙碌
+	std::atomic<size_t> next(0);
+	auto worker = [&]()
+	{
+		try
+		{
+			for (size_t i = next++; i < count; i = next++)
+				func(i);
+		}
+		catch (...)
+		{
+			next = count;
+			throw;
+		}
+	};
+
+	size_t helperCount = count - 1 < m_Workers.size() ? count - 1 : m_Workers.size();
+	std::vector<std::future<void>> helpers;
+	std::exception_ptr error;
+	try
+	{
+		helpers.reserve(helperCount);
+		for (size_t i = 0; i < helperCount; ++i)
+			helpers.push_back(Submit(worker));
+		worker();
+	}
+	catch (...)
+	{
+		error = std::current_exception();
+		next = count;
+	}
+	// 辅助任务引用了当前栈上的next、count与func，出现异常时也必须等它们全部结束
+	for (auto& helper : helpers)
+	{
+		try
+		{
+			helper.get();
+		}
+		catch (...)
+		{
+			if (!error)
+				error = std::current_exception();
+		}
+	}
+	if (error)
+		std::rethrow_exception(error);
+}
+
+#endif
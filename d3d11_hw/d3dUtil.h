@@ -166,6 +166,70 @@ inline void DXGISetDebugObjectName(_In_ IDXGIObject* object, _In_ std::nullptr_t
 #endif
 }
 
+//
+// 视锥剔除相关函数
+//
+
+// ------------------------------
+// ExtractFrustumPlanes函数
+// ------------------------------
+// 从变换矩阵中提取视锥的6个平面(Gribb & Hartmann)，依次为左、右、下、上、近、远
+// 平面的法向量指向视锥内侧且已归一化，平面位于矩阵变换之前的空间：
+// view * proj得到世界空间的平面，world * view * proj得到模型空间的平面
+// [In]transform			变换矩阵
+// [Out]planes				输出的6个平面
+inline void XM_CALLCONV ExtractFrustumPlanes(DirectX::FXMMATRIX transform, DirectX::XMVECTOR planes[6])
+{
+	using namespace DirectX;
+	XMMATRIX m = XMMatrixTranspose(transform);
+	planes[0] = m.r[3] + m.r[0];
+	planes[1] = m.r[3] - m.r[0];
+	planes[2] = m.r[3] + m.r[1];
+	planes[3] = m.r[3] - m.r[1];
+	planes[4] = m.r[2];
+	planes[5] = m.r[3] - m.r[2];
+	for (int i = 0; i < 6; ++i)
+		planes[i] = XMPlaneNormalize(planes[i]);
+}
+
+// ------------------------------
+// SphereIntersectsFrustum函数
+// ------------------------------
+// 包围球是否可能与视锥相交(完全位于某个平面外侧时返回false)
+// [In]center				球心
+// [In]radius				半径
+// [In]planes				ExtractFrustumPlanes得到的6个平面
+inline bool XM_CALLCONV SphereIntersectsFrustum(DirectX::FXMVECTOR center, float radius, const DirectX::XMVECTOR planes[6])
+{
+	using namespace DirectX;
+	for (int i = 0; i < 6; ++i)
+	{
+		if (XMVectorGetX(XMPlaneDotCoord(planes[i], center)) < -radius)
+			return false;
+	}
+	return true;
+}
+
+// ------------------------------
+// BoxIntersectsFrustum函数
+// ------------------------------
+// 轴对齐包围盒是否可能与视锥相交(完全位于某个平面外侧时返回false)
+// [In]center				包围盒中心
+// [In]extents				包围盒的半边长
+// [In]planes				ExtractFrustumPlanes得到的6个平面
+inline bool XM_CALLCONV BoxIntersectsFrustum(DirectX::FXMVECTOR center, DirectX::FXMVECTOR extents, const DirectX::XMVECTOR planes[6])
+{
+	using namespace DirectX;
+	for (int i = 0; i < 6; ++i)
+	{
+		// 包围盒在平面法向量上的投影半径
+		float extent = XMVectorGetX(XMVector3Dot(extents, XMVectorAbs(planes[i])));
+		if (XMVectorGetX(XMPlaneDotCoord(planes[i], center)) < -extent)
+			return false;
+	}
+	return true;
+}
+
 //
 // 着色器编译相关函数
 //